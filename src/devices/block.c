@@ -3,7 +3,10 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -17,8 +20,23 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_io_stats io[2];        /* Reads, writes. */
+    block_sector_t next_sector;         /* Sector after the last request. */
+  };
+
+/* A request being carried out, from the time it is submitted to
+   the block layer until it completes.
+
+   A request to a partition is served by a request to the disk
+   under it, made by the same thread, so each thread has a chain
+   of requests in progress, innermost first.  A driver that waits
+   for its device calls block_service_begin() when the wait is
+   over, which marks every request in the chain. */
+struct block_request
+  {
+    struct block_request *outer;        /* Request this one serves. */
+    uint64_t start;                     /* When submitted. */
+    uint64_t service_start;             /* When served, or 0. */
   };
 
 /* List of all block devices. */
@@ -28,6 +46,9 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void request_begin (struct block_request *);
+static void request_end (struct block *, struct block_request *, bool write,
+                         block_sector_t sector, block_sector_t cnt);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,9 +141,39 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
+  struct block_request r;
+
   check_sector (block, sector);
+  TRACE (TRACE_BLOCK_READ, block->type, sector, 1);
+  request_begin (&r);
   block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  request_end (block, &r, false, sector, 1);
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Uses a single driver request if the driver supports
+   it, otherwise reads one sector at a time. */
+void
+block_read_multiple (struct block *block, block_sector_t sector,
+                     block_sector_t cnt, void *buffer)
+{
+  struct block_request r;
+  uint8_t *p = buffer;
+  block_sector_t i;
+
+  if (cnt == 0)
+    return;
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  TRACE (TRACE_BLOCK_READ, block->type, sector, cnt);
+  request_begin (&r);
+  if (block->ops->read_multiple != NULL)
+    block->ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      block->ops->read (block->aux, sector + i, p + i * BLOCK_SECTOR_SIZE);
+  request_end (block, &r, false, sector, cnt);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +184,14 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
+  struct block_request r;
+
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
+  TRACE (TRACE_BLOCK_WRITE, block->type, sector, 1);
+  request_begin (&r);
   block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  request_end (block, &r, true, sector, 1);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,6 +215,115 @@ block_type (struct block *block)
   return block->type;
 }
 
+/* Stores the number of sectors read from and written to BLOCK
+   so far in *READ_CNT and *WRITE_CNT. */
+void
+block_get_stats (struct block *block, unsigned long long *read_cnt,
+                 unsigned long long *write_cnt)
+{
+  *read_cnt = block->io[0].sectors;
+  *write_cnt = block->io[1].sectors;
+}
+
+/* Copies BLOCK's statistics for writes, if WRITE is true, or for
+   reads otherwise, into *STATS. */
+void
+block_get_io_stats (struct block *block, bool write,
+                    struct block_io_stats *stats)
+{
+  *stats = block->io[write];
+}
+
+/* Called by a driver that may have to wait for its device, such
+   as for a controller shared with another disk, once the wait is
+   over and it starts serving the current thread's request.  The
+   time before this counts as queueing, the time after as
+   service.  Requests whose driver never calls this have no
+   queueing time. */
+void
+block_service_begin (void)
+{
+  struct block_request *r;
+  uint64_t now = timer_cycles ();
+
+  for (r = thread_current ()->block_request;
+       r != NULL && r->service_start == 0; r = r->outer)
+    r->service_start = now;
+}
+
+/* Starts timing request R on behalf of the current thread. */
+static void
+request_begin (struct block_request *r)
+{
+  struct thread *t = thread_current ();
+
+  r->outer = t->block_request;
+  r->start = timer_cycles ();
+  r->service_start = 0;
+  t->block_request = r;
+}
+
+/* Finishes request R, which transferred CNT sectors starting at
+   SECTOR to or from BLOCK, and adds it to BLOCK's statistics. */
+static void
+request_end (struct block *block, struct block_request *r, bool write,
+             block_sector_t sector, block_sector_t cnt)
+{
+  struct block_io_stats *io = &block->io[write];
+  uint64_t end = timer_cycles ();
+  uint64_t service_start = r->service_start != 0 ? r->service_start : r->start;
+  uint64_t us = timer_cycles_to_ns (end - r->start) / 1000;
+  int bucket = 0;
+
+  thread_current ()->block_request = r->outer;
+
+  while (us != 0 && bucket < BLOCK_LATENCY_BUCKETS - 1)
+    {
+      us >>= 1;
+      bucket++;
+    }
+
+  io->requests++;
+  io->sectors += cnt;
+  if (sector == block->next_sector)
+    io->sequential++;
+  io->queue_ns += timer_cycles_to_ns (service_start - r->start);
+  io->service_ns += timer_cycles_to_ns (end - service_start);
+  io->latency[bucket]++;
+  block->next_sector = sector + cnt;
+}
+
+/* Prints one direction of BLOCK's statistics, named NAME. */
+static void
+print_io_stats (const char *name, const struct block_io_stats *io)
+{
+  int i;
+
+  if (io->requests == 0)
+    return;
+
+  printf ("  %s: %llu requests, %llu%% sequential, %llu bytes/request, "
+          "avg queue %llu us, avg service %llu us\n",
+          name, io->requests, io->sequential * 100 / io->requests,
+          io->sectors * BLOCK_SECTOR_SIZE / io->requests,
+          io->queue_ns / io->requests / 1000,
+          io->service_ns / io->requests / 1000);
+
+  printf ("  %s latency:", name);
+  for (i = 0; i < BLOCK_LATENCY_BUCKETS; i++)
+    if (io->latency[i] != 0)
+      {
+        if (i == 0)
+          printf (" <1us");
+        else if (i == BLOCK_LATENCY_BUCKETS - 1)
+          printf (" >=%lluus", 1ULL << (i - 1));
+        else
+          printf (" %llu-%lluus", 1ULL << (i - 1), 1ULL << i);
+        printf (":%llu", io->latency[i]);
+      }
+  printf ("\n");
+}
+
 /* Prints statistics for each block device used for a Pintos role. */
 void
 block_print_stats (void)
@@ -173,7 +337,9 @@ block_print_stats (void)
         {
           printf ("%s (%s): %llu reads, %llu writes\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  block->io[0].sectors, block->io[1].sectors);
+          print_io_stats ("read", &block->io[0]);
+          print_io_stats ("write", &block->io[1]);
         }
     }
 }
@@ -198,8 +364,8 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (block->io, 0, sizeof block->io);
+  block->next_sector = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
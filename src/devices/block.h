@@ -1,6 +1,7 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <inttypes.h>
 
@@ -52,11 +53,35 @@ struct block *block_next (struct block *);
 /* Block device operations. */
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
+void block_read_multiple (struct block *, block_sector_t, block_sector_t cnt,
+                          void *);
 void block_write (struct block *, block_sector_t, const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
 /* Statistics. */
+
+/* Latency histogram buckets.  Bucket 0 counts requests that took
+   less than 1 us, bucket I > 0 those that took 2**(I-1) us up to
+   2**I us, and the last bucket everything slower. */
+#define BLOCK_LATENCY_BUCKETS 24
+
+/* Statistics for one direction (reads or writes) of a device. */
+struct block_io_stats
+  {
+    unsigned long long requests;        /* Requests completed. */
+    unsigned long long sectors;         /* Sectors transferred. */
+    unsigned long long sequential;      /* Requests that began where the
+                                           previous one ended. */
+    unsigned long long queue_ns;        /* Total time waiting for the
+                                           device. */
+    unsigned long long service_ns;      /* Total time being served. */
+    unsigned long long latency[BLOCK_LATENCY_BUCKETS]; /* Histogram. */
+  };
+
+void block_get_stats (struct block *, unsigned long long *read_cnt,
+                      unsigned long long *write_cnt);
+void block_get_io_stats (struct block *, bool write, struct block_io_stats *);
 void block_print_stats (void);
 
 /* Lower-level interface to block device drivers. */
@@ -65,8 +90,14 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Reads CNT consecutive sectors in one request. */
+    void (*read_multiple) (void *aux, block_sector_t, block_sector_t cnt,
+                           void *buffer);
   };
 
+void block_service_begin (void);
+
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
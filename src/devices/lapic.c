@@ -0,0 +1,180 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include <stdint.h>
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+/* Interface to the local Advanced Programmable Interrupt
+   Controller (APIC) that each CPU has.  Pintos still takes
+   device interrupts from the 8259A PICs, through the boot CPU's
+   local APIC in "virtual wire" mode, and uses the local APICs
+   only to start the other CPUs and to interrupt them.  Refer to
+   [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)" and [MP] for details. */
+
+/* Registers, as byte offsets from the base. */
+#define LAPIC_ID        0x020   /* Local APIC ID. */
+#define LAPIC_TPR       0x080   /* Task priority. */
+#define LAPIC_EOI       0x0b0   /* End of interrupt. */
+#define LAPIC_SVR       0x0f0   /* Spurious interrupt vector. */
+#define LAPIC_ESR       0x280   /* Error status. */
+#define LAPIC_ICR_LO    0x300   /* Interrupt command, bits 0...31. */
+#define LAPIC_ICR_HI    0x310   /* Interrupt command, bits 32...63. */
+#define LAPIC_TIMER     0x320   /* Local vector table: timer. */
+#define LAPIC_LINT0     0x350   /* Local vector table: LINT0 pin. */
+#define LAPIC_LINT1     0x360   /* Local vector table: LINT1 pin. */
+#define LAPIC_ERROR     0x370   /* Local vector table: error. */
+
+/* Spurious interrupt vector register bits. */
+#define SVR_ENABLE      0x100   /* APIC software enable. */
+
+/* Local vector table bits. */
+#define LVT_NMI         0x400   /* Deliver as NMI. */
+#define LVT_EXTINT      0x700   /* Deliver as from the 8259A. */
+#define LVT_MASKED      0x10000 /* Masked. */
+
+/* Interrupt command register bits. */
+#define ICR_INIT        0x500   /* INIT IPI. */
+#define ICR_STARTUP     0x600   /* Startup IPI. */
+#define ICR_PENDING     0x1000  /* Delivery status: send pending. */
+#define ICR_ASSERT      0x4000  /* Level: assert. */
+#define ICR_LEVEL       0x8000  /* Trigger mode: level. */
+
+/* Register window, or a null pointer if lapic_map() has not
+   been called. */
+static volatile uint32_t *lapic;
+
+/* Returns the value of register REG. */
+static inline uint32_t
+lapic_read (unsigned reg)
+{
+  return lapic[reg / sizeof *lapic];
+}
+
+/* Stores VALUE into register REG. */
+static inline void
+lapic_write (unsigned reg, uint32_t value)
+{
+  lapic[reg / sizeof *lapic] = value;
+}
+
+/* Waits for the previous interprocessor interrupt to be sent. */
+static void
+wait_icr (void)
+{
+  while (lapic_read (LAPIC_ICR_LO) & ICR_PENDING)
+    asm volatile ("pause");
+}
+
+/* Sends the interprocessor interrupt described by COMMAND to the
+   CPU whose local APIC ID is APIC_ID, and waits until it has
+   gone.  The command takes two register writes, so interrupts
+   are turned off in between, in case a handler sends one too. */
+static void
+send_icr (uint8_t apic_id, uint32_t command)
+{
+  enum intr_level old_level = intr_disable ();
+
+  wait_icr ();
+  lapic_write (LAPIC_ICR_HI, (uint32_t) apic_id << 24);
+  lapic_write (LAPIC_ICR_LO, command);
+  wait_icr ();
+  intr_set_level (old_level);
+}
+
+/* Maps the local APIC registers, which are at physical address
+   PADDR in every CPU, into the kernel page directory at the
+   same virtual address, with caching disabled.  Must be called
+   after paging_init() and before any process page directory is
+   created, since those copy the kernel's mappings. */
+void
+lapic_map (uintptr_t paddr)
+{
+  void *vaddr = (void *) paddr;
+  uint32_t *pde, *pt;
+
+  ASSERT (pg_ofs (vaddr) == 0);
+  ASSERT (vaddr >= ptov ((uintptr_t) init_ram_pages * PGSIZE));
+
+  pde = &init_page_dir[pd_no (vaddr)];
+  if (*pde == 0)
+    *pde = pde_create (palloc_get_page (PAL_ASSERT | PAL_ZERO));
+  pt = pde_get_pt (*pde);
+  pt[pt_no (vaddr)] = paddr | PTE_PCD | PTE_PWT | PTE_W | PTE_P;
+  lapic = vaddr;
+}
+
+/* Enables the running CPU's local APIC.  On the boot CPU,
+   BOOT_CPU is true and the 8259A's interrupts, which arrive on
+   pin LINT0, keep flowing; other CPUs ignore them. */
+void
+lapic_init (bool boot_cpu)
+{
+  ASSERT (lapic != NULL);
+
+  lapic_write (LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS);
+  lapic_write (LAPIC_TIMER, LVT_MASKED);
+  lapic_write (LAPIC_LINT0, boot_cpu ? LVT_EXTINT : LVT_MASKED);
+  lapic_write (LAPIC_LINT1, boot_cpu ? LVT_NMI : LVT_MASKED);
+  lapic_write (LAPIC_ERROR, LVT_MASKED);
+
+  /* Clear errors (the register must be written twice), any
+     interrupt left in service, and the priority threshold. */
+  lapic_write (LAPIC_ESR, 0);
+  lapic_write (LAPIC_ESR, 0);
+  lapic_write (LAPIC_EOI, 0);
+  lapic_write (LAPIC_TPR, 0);
+}
+
+/* Returns the running CPU's local APIC ID. */
+uint8_t
+lapic_id (void)
+{
+  ASSERT (lapic != NULL);
+  return lapic_read (LAPIC_ID) >> 24;
+}
+
+/* Acknowledges the interrupt being handled, which must have come
+   through the local APIC rather than the 8259A. */
+void
+lapic_eoi (void)
+{
+  lapic_write (LAPIC_EOI, 0);
+}
+
+/* Sends interrupt VEC to the CPU whose local APIC ID is
+   APIC_ID. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec)
+{
+  send_icr (apic_id, ICR_ASSERT | vec);
+}
+
+/* Starts the CPU whose local APIC ID is APIC_ID, which must be
+   waiting since reset, executing real-mode code at physical
+   address START_PADDR, which must be page-aligned and below
+   1 MB.  This is the INIT, startup, startup sequence from [MP]
+   appendix B.4; a CPU that is already running ignores the
+   second startup IPI.  Busy-waits for about 10 ms. */
+void
+lapic_start_ap (uint8_t apic_id, uintptr_t start_paddr)
+{
+  int i;
+
+  ASSERT (start_paddr % PGSIZE == 0 && start_paddr < 0x100000);
+
+  send_icr (apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+  timer_udelay (200);
+  send_icr (apic_id, ICR_INIT | ICR_LEVEL);
+  timer_mdelay (10);
+
+  for (i = 0; i < 2; i++)
+    {
+      send_icr (apic_id, ICR_STARTUP | (start_paddr >> 12));
+      timer_udelay (200);
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vector that the local APIC raises for spurious
+   interrupts.  These need no end-of-interrupt. */
+#define LAPIC_SPURIOUS 0xff
+
+void lapic_map (uintptr_t paddr);
+void lapic_init (bool boot_cpu);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+void lapic_start_ap (uint8_t apic_id, uintptr_t start_paddr);
+
+#endif /* devices/lapic.h */
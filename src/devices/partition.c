@@ -307,6 +307,17 @@ partition_read (void *p_, block_sector_t sector, void *buffer)
   block_read (p->block, p->start + sector, buffer);
 }
 
+/* Reads CNT sectors starting at SECTOR from partition P into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+partition_read_multiple (void *p_, block_sector_t sector, block_sector_t cnt,
+                         void *buffer)
+{
+  struct partition *p = p_;
+  block_read_multiple (p->block, p->start + sector, cnt, buffer);
+}
+
 /* Write sector SECTOR to partition P from BUFFER, which must
    contain BLOCK_SECTOR_SIZE bytes.  Returns after the block has
    acknowledged receiving the data. */
@@ -320,5 +331,6 @@ partition_write (void *p_, block_sector_t sector, const void *buffer)
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    partition_write,
+    partition_read_multiple
   };
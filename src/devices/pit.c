@@ -11,8 +11,11 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
+/* Channel 2 gate and output, in the speaker port. */
+#define PIT_PORT_GATE 0x61
+#define PIT_GATE2 0x01          /* Channel 2 counts while set. */
+#define PIT_SPEAKER 0x02        /* Channel 2 output drives the speaker. */
+#define PIT_OUT2 0x20           /* Channel 2 output (read-only). */
 
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
@@ -81,3 +84,29 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts channel 2 counting down COUNT PIT cycles, with the
+   speaker disconnected, so that pit_oneshot_done() becomes true
+   COUNT / PIT_HZ seconds from now.  This disturbs any tone
+   playing on the speaker.  Interrupts must be off. */
+void
+pit_oneshot_start (uint16_t count)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  outb (PIT_PORT_GATE,
+        (inb (PIT_PORT_GATE) & ~PIT_SPEAKER) | PIT_GATE2);
+
+  /* Mode 0: output goes low now and high when the count expires. */
+  outb (PIT_PORT_CONTROL, (2 << 6) | 0x30 | (0 << 1));
+  outb (PIT_PORT_COUNTER (2), count);
+  outb (PIT_PORT_COUNTER (2), count >> 8);
+}
+
+/* Returns true once the count started by pit_oneshot_start()
+   has expired. */
+bool
+pit_oneshot_done (void)
+{
+  return (inb (PIT_PORT_GATE) & PIT_OUT2) != 0;
+}
@@ -1,8 +1,14 @@
 #ifndef DEVICES_PIT_H
 #define DEVICES_PIT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
 void pit_configure_channel (int channel, int mode, int frequency);
+void pit_oneshot_start (uint16_t count);
+bool pit_oneshot_done (void);
 
 #endif /* devices/pit.h */
@@ -0,0 +1,149 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* RAM disk.
+
+   A block device whose sectors live in kernel pages, so that
+   requests to it finish in the time it takes to copy the data.
+   Using it for the file system takes disk I/O out of file system
+   benchmarks and leaves only the CPU cost of the file system
+   code.  Its contents are lost at power-off.
+
+   The pages are allocated when the disk is created, so a disk
+   too big for memory fails at boot rather than partway through
+   a run, and need not be contiguous: PAGES maps each page-sized
+   run of sectors to the page that holds it.
+
+   Requests are plain copies that never block, so no locking is
+   needed.  As with a real disk, callers must not read a sector
+   while another thread writes it. */
+
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    uint8_t **pages;                    /* Page holding each run of
+                                           SECTORS_PER_PAGE sectors. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+/* Returns the address of SECTOR in RD. */
+static inline uint8_t *
+sector_addr (const struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Creates a zero-filled RAM disk of SIZE sectors, rounded up to
+   a whole number of pages, and registers it as block device
+   "ram0".  Panics if there is not enough memory. */
+struct block *
+ramdisk_init (block_sector_t size)
+{
+  struct ramdisk *rd;
+  size_t page_cnt, i;
+
+  ASSERT (size > 0);
+
+  page_cnt = DIV_ROUND_UP (size, SECTORS_PER_PAGE);
+  rd = malloc (sizeof *rd);
+  if (rd != NULL)
+    rd->pages = malloc (page_cnt * sizeof *rd->pages);
+  if (rd == NULL || rd->pages == NULL)
+    PANIC ("ram0: out of memory");
+
+  for (i = 0; i < page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("ram0: out of memory after %zu of %zu kB",
+               i * PGSIZE / 1024, page_cnt * PGSIZE / 1024);
+    }
+
+  return block_register ("ram0", BLOCK_FILESYS, "RAM disk",
+                         page_cnt * SECTORS_PER_PAGE,
+                         &ramdisk_operations, rd);
+}
+
+/* Copies the contents of block device SOURCE into RAMDISK, up
+   to the size of the smaller of the two. */
+void
+ramdisk_load (struct block *ramdisk, struct block *source)
+{
+  block_sector_t size = block_size (ramdisk);
+  block_sector_t sector;
+  uint8_t *page = palloc_get_page (PAL_ASSERT);
+
+  if (size > block_size (source))
+    size = block_size (source);
+
+  printf ("%s: loading %'"PRDSNu" sectors from %s...",
+          block_name (ramdisk), size, block_name (source));
+  for (sector = 0; sector < size; sector += SECTORS_PER_PAGE)
+    {
+      block_sector_t cnt = size - sector;
+      block_sector_t i;
+
+      if (cnt > SECTORS_PER_PAGE)
+        cnt = SECTORS_PER_PAGE;
+      block_read_multiple (source, sector, cnt, page);
+      for (i = 0; i < cnt; i++)
+        block_write (ramdisk, sector + i, page + i * BLOCK_SECTOR_SIZE);
+    }
+  printf ("done.\n");
+  palloc_free_page (page);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD_ into
+   BUFFER. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector, block_sector_t cnt,
+                       void *buffer)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *p = buffer;
+
+  while (cnt > 0)
+    {
+      /* Copy up to the end of the page holding SECTOR. */
+      block_sector_t n = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (n > cnt)
+        n = cnt;
+      memcpy (p, sector_addr (rd, sector), n * BLOCK_SECTOR_SIZE);
+      p += n * BLOCK_SECTOR_SIZE;
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Reads SECTOR from RAM disk RD_ into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_read (void *rd_, block_sector_t sector, void *buffer)
+{
+  memcpy (buffer, sector_addr (rd_, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes SECTOR of RAM disk RD_ from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write (void *rd_, block_sector_t sector, const void *buffer)
+{
+  memcpy (sector_addr (rd_, sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+  };
@@ -0,0 +1,9 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include "devices/block.h"
+
+struct block *ramdisk_init (block_sector_t size);
+void ramdisk_load (struct block *ramdisk, struct block *source);
+
+#endif /* devices/ramdisk.h */
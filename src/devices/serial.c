@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,13 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable the FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear both FIFOs. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs enabled (16550A only). */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,11 +58,26 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted, in a circular buffer.  TXQ_SIZE must
+   be a power of 2.  txq_head and txq_tail count bytes added and
+   removed and are only reduced modulo TXQ_SIZE to index txq. */
+#define TXQ_SIZE 4096
+static uint8_t txq[TXQ_SIZE];
+static size_t txq_head, txq_tail;
+
+/* Thread waiting for room in txq, and a lock so that there is
+   only one at a time. */
+static struct thread *txq_waiter;
+static struct lock txq_lock;
+
+/* Bytes the transmitter accepts at once when its holding
+   register is empty: 16 for a 16550A, 1 for older UARTs. */
+static size_t tx_fifo_size = 1;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static size_t txq_used (void);
+static void txq_fill_fifo (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -71,7 +93,7 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  txq_head = txq_tail = 0;
   mode = POLL;
 } 
 
@@ -87,6 +109,13 @@ serial_init_queue (void)
     init_poll ();
   ASSERT (mode == POLL);
 
+  /* Turn on the FIFOs.  Only a 16550A reports them as enabled;
+     older UARTs ignore the request and keep one holding byte. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    tx_fifo_size = 16;
+  lock_init (&txq_lock);
+
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
@@ -98,32 +127,74 @@ serial_init_queue (void)
 void
 serial_putc (uint8_t byte) 
 {
+  serial_putbuf (&byte, 1);
+}
+
+/* Sends the N bytes in BUFFER to the serial port.  In queued
+   mode, copies as much as fits into the transmit queue at once
+   and starts the transmitter if it is idle.  If the queue fills,
+   waits for the interrupt handler to drain it, unless interrupts
+   were off on entry. */
+void
+serial_putbuf (const void *buffer, size_t n) 
+{
+  const uint8_t *p = buffer;
   enum intr_level old_level = intr_disable ();
 
   if (mode != QUEUE)
     {
       /* If we're not set up for interrupt-driven I/O yet,
-         use dumb polling to transmit a byte. */
+         use dumb polling to transmit. */
       if (mode == UNINIT)
         init_poll ();
-      putc_poll (byte); 
+      while (n-- > 0)
+        putc_poll (*p++);
     }
   else 
     {
-      /* Otherwise, queue a byte and update the interrupt enable
-         register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      while (n > 0)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          size_t room = TXQ_SIZE - txq_used ();
+          size_t ofs, chunk;
+
+          if (room == 0)
+            {
+              if (old_level == INTR_OFF || intr_context ())
+                {
+                  /* Interrupts are off and the transmit queue is
+                     full.  If we wanted to wait for the queue to
+                     empty, we'd have to reenable interrupts.
+                     That's impolite, so we'll send a character
+                     via polling instead. */
+                  putc_poll (txq[txq_tail++ % TXQ_SIZE]);
+                }
+              else
+                {
+                  lock_acquire (&txq_lock);
+                  if (txq_used () == TXQ_SIZE)
+                    {
+                      txq_waiter = thread_current ();
+                      thread_block ();
+                    }
+                  lock_release (&txq_lock);
+                }
+              continue;
+            }
+
+          /* Copy up to the end of the buffer in one piece. */
+          ofs = txq_head % TXQ_SIZE;
+          chunk = n < room ? n : room;
+          if (chunk > TXQ_SIZE - ofs)
+            chunk = TXQ_SIZE - ofs;
+          memcpy (txq + ofs, p, chunk);
+          txq_head += chunk;
+          p += chunk;
+          n -= chunk;
+
+          /* Keep the transmitter busy while we copy the rest. */
+          txq_fill_fifo ();
+          write_ier ();
         }
-
-      intq_putc (&txq, byte); 
-      write_ier ();
     }
   
   intr_set_level (old_level);
@@ -135,8 +206,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (txq_used () > 0)
+    putc_poll (txq[txq_tail++ % TXQ_SIZE]);
   intr_set_level (old_level);
 }
 
@@ -182,7 +253,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (txq_used () > 0)
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +276,36 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Returns the number of bytes waiting in the transmit queue. */
+static size_t
+txq_used (void) 
+{
+  return txq_head - txq_tail;
+}
+
+/* If the transmitter's holding register or FIFO is empty, refills
+   it from the transmit queue, up to tx_fifo_size bytes, without
+   checking the line status between bytes.  Wakes a thread waiting
+   for room in the queue. */
+static void
+txq_fill_fifo (void) 
+{
+  size_t i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (txq_used () == 0 || (inb (LSR_REG) & LSR_THRE) == 0)
+    return;
+  for (i = 0; i < tx_fifo_size && txq_used () > 0; i++)
+    outb (THR_REG, txq[txq_tail++ % TXQ_SIZE]);
+
+  if (txq_waiter != NULL)
+    {
+      thread_unblock (txq_waiter);
+      txq_waiter = NULL;
+    }
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +319,8 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmitter has drained, refill it. */
+  txq_fill_fifo ();
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -6,12 +6,16 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
+#include "userprog/syscall.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "filesys/filesys.h"
+#include "filesys/cache.h"
+#include "filesys/dedup.h"
 #endif
 
 /* Keyboard control register port. */
@@ -93,6 +97,7 @@ shutdown_power_off (void)
 #ifdef FILESYS
   filesys_done ();
 #endif
+  trace_dump ();
 
   print_stats ();
 
@@ -123,10 +128,13 @@ print_stats (void)
   thread_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  cache_print_stats ();
+  dedup_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  syscall_print_stats ();
 #endif
 }
@@ -4,6 +4,7 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
@@ -24,11 +25,30 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Does the CPU have a time-stamp counter?  If not, timer_cycles()
+   counts timer ticks instead. */
+static bool have_tsc;
+
+/* Rate of timer_cycles(), or 0 if not yet calibrated. */
+static uint64_t cycles_per_sec;
+
+/* Nanoseconds per cycle, as a fixed-point number with NS_SHIFT
+   fraction bits, for timer_cycles_to_ns(). */
+#define NS_SHIFT 20
+static uint64_t ns_per_cycle;
+
+/* timer_cycles() when timer_init() ran. */
+static uint64_t boot_cycles;
+
+/* PIT cycles per TSC calibration run: 10 ms. */
+#define TSC_CAL_COUNT (PIT_HZ / 100)
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static void calibrate_tsc (void);
 
 
 static struct list sleep_thread_list;
@@ -41,6 +61,14 @@ timer_init (void)
   list_init(&sleep_thread_list);
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
+
+  have_tsc = cpu_has (CPUID_TSC);
+  if (!have_tsc)
+    {
+      cycles_per_sec = TIMER_FREQ;
+      ns_per_cycle = ((uint64_t) 1000000000 << NS_SHIFT) / TIMER_FREQ;
+    }
+  boot_cycles = timer_cycles ();
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -67,7 +95,43 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  if (have_tsc)
+    {
+      calibrate_tsc ();
+      printf (", %'"PRIu64" kHz TSC", cycles_per_sec / 1000);
+    }
+  printf (".\n");
+}
+
+/* Measures the TSC rate against a 10 ms PIT countdown, taking the
+   fastest of a few runs so that a stray delay in the polling loop
+   does not inflate it. */
+static void
+calibrate_tsc (void) 
+{
+  uint64_t best = UINT64_MAX;
+  int i;
+
+  for (i = 0; i < 3; i++)
+    {
+      enum intr_level old_level = intr_disable ();
+      uint64_t start, elapsed;
+
+      pit_oneshot_start (TSC_CAL_COUNT);
+      start = rdtsc ();
+      while (!pit_oneshot_done ())
+        continue;
+      elapsed = rdtsc () - start;
+      intr_set_level (old_level);
+
+      if (elapsed < best)
+        best = elapsed;
+    }
+
+  cycles_per_sec = best * PIT_HZ / TSC_CAL_COUNT;
+  ns_per_cycle = ((uint64_t) 1000000000 << NS_SHIFT) / cycles_per_sec;
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -88,6 +152,43 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter, which counts at
+   timer_cycles_per_sec() cycles per second.  Reading it takes a
+   few dozen cycles and no locks, so it suits timing short
+   operations; convert differences with timer_cycles_to_ns(). */
+uint64_t
+timer_cycles (void) 
+{
+  return have_tsc ? rdtsc () : (uint64_t) timer_ticks ();
+}
+
+/* Converts a number of timer_cycles() into nanoseconds.
+   Returns 0 before timer_calibrate() has run. */
+uint64_t
+timer_cycles_to_ns (uint64_t cycles) 
+{
+  uint64_t low = cycles & ((1 << NS_SHIFT) - 1);
+
+  return ((cycles >> NS_SHIFT) * ns_per_cycle
+          + ((low * ns_per_cycle) >> NS_SHIFT));
+}
+
+/* Returns the number of nanoseconds since timer_init().
+   Returns 0 before timer_calibrate() has run. */
+uint64_t
+timer_ns (void) 
+{
+  return timer_cycles_to_ns (timer_cycles () - boot_cycles);
+}
+
+/* Returns the rate of timer_cycles() in cycles per second, or 0
+   before timer_calibrate() has run. */
+uint64_t
+timer_cycles_per_sec (void) 
+{
+  return cycles_per_sec;
+}
+
 // psw: this compare function is used in insert something in sleep thread list.
 
 static bool wakeupcomp(const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
@@ -5,27 +5,37 @@
    Intention is to stress virtual memory system.
  
    Ideally, we could read the unsorted array off of the file
-   system, and store the result back to the file system! */
+   system, and store the result back to the file system!
+
+   Usage: bubsort [SIZE] */
 #include <stdio.h>
+#include <stdlib.h>
 
-/* Size of array to sort. */
+/* Default size of array to sort. */
 #define SORT_SIZE 128
 
 int
-main (void)
+main (int argc, char *argv[])
 {
-  /* Array to sort.  Static to reduce stack usage. */
-  static int array[SORT_SIZE];
-
+  int sort_size = argc > 1 ? atoi (argv[1]) : SORT_SIZE;
+  int *array;
   int i, j, tmp;
 
+  /* Array to sort, on the heap so that its size is not fixed. */
+  array = sort_size > 0 ? malloc (sort_size * sizeof *array) : NULL;
+  if (array == NULL)
+    {
+      printf ("sort: can't allocate %d elements\n", sort_size);
+      return -1;
+    }
+
   /* First initialize the array in descending order. */
-  for (i = 0; i < SORT_SIZE; i++)
-    array[i] = SORT_SIZE - i - 1;
+  for (i = 0; i < sort_size; i++)
+    array[i] = sort_size - i - 1;
 
   /* Then sort in ascending order. */
-  for (i = 0; i < SORT_SIZE - 1; i++)
-    for (j = 0; j < SORT_SIZE - 1 - i; j++)
+  for (i = 0; i < sort_size - 1; i++)
+    for (j = 0; j < sort_size - 1 - i; j++)
       if (array[j] > array[j + 1])
 	{
 	  tmp = array[j];
@@ -0,0 +1,100 @@
+/* cachestat.c
+
+   Samples the buffer cache counters at a fixed interval and
+   prints what changed in each one, in the manner of vmstat.  The
+   first line covers everything since boot.
+
+   Usage: cachestat [INTERVAL_MS [COUNT [COMMAND...]]]
+   INTERVAL_MS defaults to 1000 and COUNT to 5.  If COMMAND is
+   given, it is started first and waited for after the last
+   sample, so that the samples show its cache behavior. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Waits until MS milliseconds after START, which is updated. */
+static void
+wait_until (uint64_t *start, int ms)
+{
+  *start += (uint64_t) ms * 1000000;
+  while (time_ns () < *start)
+    continue;
+}
+
+/* Prints the change from OLD to NEW as one line. */
+static void
+print_delta (const struct cachestat *old, const struct cachestat *new)
+{
+  unsigned long long hits = new->hits - old->hits;
+  unsigned long long misses = new->misses - old->misses;
+  unsigned long long total = hits + misses;
+
+  printf ("%8llu %8llu %4llu %8llu %6llu %6llu %6llu %8llu %6u\n",
+          hits, misses, total != 0 ? hits * 100 / total : 0,
+          new->evictions - old->evictions,
+          new->dirty_evictions - old->dirty_evictions,
+          new->readahead_hits - old->readahead_hits,
+          new->readahead_wasted - old->readahead_wasted,
+          new->writebacks - old->writebacks,
+          new->dirty);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static struct cachestat old, new;
+  int interval = argc > 1 ? atoi (argv[1]) : 1000;
+  int count = argc > 2 ? atoi (argv[2]) : 5;
+  pid_t pid = PID_ERROR;
+  uint64_t start;
+  int i;
+
+  if (interval <= 0)
+    interval = 1000;
+
+  /* Start COMMAND, if any. */
+  if (argc > 3)
+    {
+      char cmd_line[128];
+
+      cmd_line[0] = '\0';
+      for (i = 3; i < argc; i++)
+        {
+          if (i > 3)
+            strlcat (cmd_line, " ", sizeof cmd_line);
+          strlcat (cmd_line, argv[i], sizeof cmd_line);
+        }
+      pid = exec (cmd_line);
+      if (pid == PID_ERROR)
+        {
+          printf ("%s: exec failed\n", cmd_line);
+          return EXIT_FAILURE;
+        }
+    }
+
+  if (!cachestat (&new))
+    {
+      printf ("%s: no buffer cache statistics\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  printf ("%u cache entries\n", new.entries);
+  printf ("%8s %8s %4s %8s %6s %6s %6s %8s %6s\n",
+          "hits", "misses", "hit%", "evict", "dirty", "ra-use",
+          "ra-wst", "wback", "ndirty");
+  print_delta (&old, &new);
+
+  start = time_ns ();
+  for (i = 1; i < count; i++)
+    {
+      old = new;
+      wait_until (&start, interval);
+      cachestat (&new);
+      print_delta (&old, &new);
+    }
+
+  if (pid != PID_ERROR)
+    wait (pid);
+  return EXIT_SUCCESS;
+}
@@ -1,34 +1,45 @@
 /* cat.c
 
-   Prints files specified on command line to the console. */
+   Prints files specified on command line to the console, or, if
+   there are none, standard input, so that it can end a pipeline
+   such as "echo hello | cat". */
 
 #include <stdio.h>
 #include <syscall.h>
 
+/* Copies FILE to standard output until end of file. */
+static void
+copy (FILE *file)
+{
+  for (;;) 
+    {
+      static char buffer[BUFSIZ];
+      size_t bytes_read = fread (buffer, 1, sizeof buffer, file);
+      if (bytes_read == 0)
+        break;
+      fwrite (buffer, 1, bytes_read, stdout);
+    }
+}
+
 int
 main (int argc, char *argv[]) 
 {
   bool success = true;
   int i;
   
+  if (argc == 1)
+    copy (stdin);
   for (i = 1; i < argc; i++) 
     {
-      int fd = open (argv[i]);
-      if (fd < 0) 
+      FILE *file = fopen (argv[i], "r");
+      if (file == NULL) 
         {
           printf ("%s: open failed\n", argv[i]);
           success = false;
           continue;
         }
-      for (;;) 
-        {
-          char buffer[1024];
-          int bytes_read = read (fd, buffer, sizeof buffer);
-          if (bytes_read == 0)
-            break;
-          write (STDOUT_FILENO, buffer, bytes_read);
-        }
-      close (fd);
+      copy (file);
+      fclose (file);
     }
   return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
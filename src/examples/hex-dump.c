@@ -13,8 +13,9 @@ main (int argc, char *argv[])
   
   for (i = 1; i < argc; i++) 
     {
-      int fd = open (argv[i]);
-      if (fd < 0) 
+      FILE *file = fopen (argv[i], "r");
+      size_t pos = 0;
+      if (file == NULL) 
         {
           printf ("%s: open failed\n", argv[i]);
           success = false;
@@ -22,14 +23,14 @@ main (int argc, char *argv[])
         }
       for (;;) 
         {
-          char buffer[1024];
-          int pos = tell (fd);
-          int bytes_read = read (fd, buffer, sizeof buffer);
+          static char buffer[BUFSIZ];
+          size_t bytes_read = fread (buffer, 1, sizeof buffer, file);
           if (bytes_read == 0)
             break;
           hex_dump (pos, buffer, bytes_read, true);
+          pos += bytes_read;
         }
-      close (fd);
+      fclose (file);
     }
   return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,69 @@
+/* iostat.c
+
+   Prints the request statistics of a block device: how many
+   requests it served, how many were sequential, how long they
+   waited for the device and how long they took to serve, and a
+   histogram of their latencies.
+
+   Usage: iostat [ROLE]
+   where ROLE is 0 for the kernel device, 1 (the default) for the
+   file system, 2 for scratch, or 3 for swap. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+static const char *role_names[] = {"kernel", "filesys", "scratch", "swap"};
+
+/* Prints one direction of a device's statistics. */
+static void
+print_io (const char *name, const struct blockstat_io *io)
+{
+  int i;
+
+  if (io->requests == 0)
+    {
+      printf ("%s: no requests\n", name);
+      return;
+    }
+
+  printf ("%s: %llu requests, %llu sectors, %llu%% sequential, "
+          "%llu bytes/request\n",
+          name, io->requests, io->sectors,
+          io->sequential * 100 / io->requests,
+          io->sectors * 512 / io->requests);
+  printf ("  avg queue %llu us, avg service %llu us\n",
+          io->queue_ns / io->requests / 1000,
+          io->service_ns / io->requests / 1000);
+  for (i = 0; i < BLOCKSTAT_BUCKETS; i++)
+    if (io->latency[i] != 0)
+      {
+        if (i == 0)
+          printf ("  %15s", "< 1 us");
+        else if (i == BLOCKSTAT_BUCKETS - 1)
+          printf ("  >= %8llu us", 1ULL << (i - 1));
+        else
+          printf ("  %6llu-%6llu us", 1ULL << (i - 1), 1ULL << i);
+        printf (" %8llu (%llu%%)\n", io->latency[i],
+                io->latency[i] * 100 / io->requests);
+      }
+}
+
+int
+main (int argc, char *argv[])
+{
+  static struct blockstat st;
+  int role = argc > 1 ? atoi (argv[1]) : 1;
+
+  if (role < 0 || role > 3 || !blockstat (role, &st))
+    {
+      printf ("%s: no block device in role %d\n", argv[0], role);
+      return EXIT_FAILURE;
+    }
+
+  printf ("%s device: %llu sectors read, %llu sectors written\n",
+          role_names[role], st.read_cnt, st.write_cnt);
+  print_io ("read", &st.read);
+  print_io ("write", &st.write);
+  return EXIT_SUCCESS;
+}
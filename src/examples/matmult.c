@@ -6,13 +6,16 @@
    
    Ideally, we could read the matrices off of the file system,
    and store the result back to the file system!
+
+   Usage: matmult [DIM]
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <syscall.h>
 
-/* You should define DIM to be large enough that the arrays
-   don't fit in physical memory.
+/* You should pass a DIM large enough that the arrays don't fit
+   in physical memory.
 
     Dim       Memory
  ------     --------
@@ -28,30 +31,37 @@
  16,384 3,145,728 kB */
 #define DIM 128
 
-int A[DIM][DIM];
-int B[DIM][DIM];
-int C[DIM][DIM];
-
 int
-main (void)
+main (int argc, char *argv[])
 {
+  int dim = argc > 1 ? atoi (argv[1]) : DIM;
+  int *A, *B, *C;
   int i, j, k;
 
+  A = malloc (dim * dim * sizeof *A);
+  B = malloc (dim * dim * sizeof *B);
+  C = malloc (dim * dim * sizeof *C);
+  if (dim <= 0 || A == NULL || B == NULL || C == NULL)
+    {
+      printf ("matmult: can't allocate %d x %d matrices\n", dim, dim);
+      exit (-1);
+    }
+
   /* Initialize the matrices. */
-  for (i = 0; i < DIM; i++)
-    for (j = 0; j < DIM; j++)
+  for (i = 0; i < dim; i++)
+    for (j = 0; j < dim; j++)
       {
-	A[i][j] = i;
-	B[i][j] = j;
-	C[i][j] = 0;
+	A[i * dim + j] = i;
+	B[i * dim + j] = j;
+	C[i * dim + j] = 0;
       }
 
   /* Multiply matrices. */
-  for (i = 0; i < DIM; i++)	
-    for (j = 0; j < DIM; j++)
-      for (k = 0; k < DIM; k++)
-	C[i][j] += A[i][k] * B[k][j];
+  for (i = 0; i < dim; i++)	
+    for (j = 0; j < dim; j++)
+      for (k = 0; k < dim; k++)
+	C[i * dim + j] += A[i * dim + k] * B[k * dim + j];
 
   /* Done. */
-  exit (C[DIM - 1][DIM - 1]);
+  exit (C[(dim - 1) * dim + dim - 1]);
 }
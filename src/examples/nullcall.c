@@ -0,0 +1,81 @@
+/* nullcall.c
+
+   Measures the cost of entering and leaving the kernel through
+   "int $0x30" and through sysenter, using the cheapest system
+   call there is, ticks().
+
+   Usage: nullcall [ITERATIONS] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "../lib/syscall-nr.h"
+
+/* Default number of calls to time for each path. */
+#define ITERATIONS 100000
+
+/* Returns the time-stamp counter. */
+static inline unsigned long long
+rdtsc (void)
+{
+  unsigned long long tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+static inline void
+int_ticks (void)
+{
+  int retval;
+  asm volatile ("pushl %[number]; int $0x30; addl $4, %%esp"
+                : "=a" (retval) : [number] "i" (SYS_TICKS) : "memory");
+}
+
+static inline void
+sysenter_ticks (void)
+{
+  int retval;
+  asm volatile ("movl %%esp, %%ecx; movl $1f, %%edx; sysenter; 1:"
+                : "=a" (retval) : "a" (SYS_TICKS)
+                : "ecx", "edx", "memory");
+}
+
+int
+main (int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : ITERATIONS;
+  unsigned long long start, int_cycles, sysenter_cycles;
+  unsigned eax, ebx, ecx, edx;
+  int i;
+
+  if (iterations <= 0)
+    {
+      printf ("usage: nullcall [ITERATIONS]\n");
+      return EXIT_FAILURE;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    int_ticks ();
+  int_cycles = (rdtsc () - start) / iterations;
+  printf ("int $0x30: %llu cycles per call\n", int_cycles);
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if (!(edx & (1 << 11)))
+    {
+      printf ("sysenter: not supported by this CPU\n");
+      return EXIT_SUCCESS;
+    }
+
+  start = rdtsc ();
+  for (i = 0; i < iterations; i++)
+    sysenter_ticks ();
+  sysenter_cycles = (rdtsc () - start) / iterations;
+  printf ("sysenter:  %llu cycles per call\n", sysenter_cycles);
+
+  if (sysenter_cycles < int_cycles)
+    printf ("sysenter saves %llu cycles per call (%llu%%)\n",
+            int_cycles - sysenter_cycles,
+            (int_cycles - sysenter_cycles) * 100 / int_cycles);
+  return EXIT_SUCCESS;
+}
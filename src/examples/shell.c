@@ -3,7 +3,11 @@
 #include <string.h>
 #include <syscall.h>
 
+/* Most commands in a pipeline. */
+#define MAX_STAGES 8
+
 static void read_line (char line[], size_t);
+static void run_pipeline (char *command);
 static bool backspace (char **pos, char line[]);
 
 int
@@ -30,6 +34,8 @@ main (void)
         {
           /* Empty command. */
         }
+      else if (strchr (command, '|') != NULL)
+        run_pipeline (command);
       else
         {
           pid_t pid = exec (command);
@@ -44,6 +50,85 @@ main (void)
   return EXIT_SUCCESS;
 }
 
+/* Returns S without leading and trailing spaces, which are
+   removed from S in place. */
+static char *
+trim (char *s)
+{
+  char *end;
+
+  while (*s == ' ')
+    s++;
+  end = s + strlen (s);
+  while (end > s && end[-1] == ' ')
+    *--end = '\0';
+  return s;
+}
+
+/* Runs COMMAND, a pipeline of commands separated by `|', with
+   each command's standard output connected by a pipe to the
+   next one's standard input.  A child inherits the shell's fds 0
+   and 1, so the shell points them at the pipes around each
+   command while starting it, then puts the console back.  Waits
+   for every command and prints its exit code. */
+static void
+run_pipeline (char *command)
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int console_in, console_out;
+  bool pipe_failed = false;
+  char *stage, *save_ptr;
+  int i;
+
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr))
+    {
+      if (stage_cnt == MAX_STAGES)
+        {
+          printf ("pipeline too long\n");
+          return;
+        }
+      stages[stage_cnt++] = trim (stage);
+    }
+
+  console_in = dup (STDIN_FILENO);
+  console_out = dup (STDOUT_FILENO);
+  for (i = 0; i < stage_cnt; i++)
+    {
+      int fds[2];
+      bool last = i == stage_cnt - 1;
+
+      if (!last && pipe (fds) < 0)
+        {
+          pipe_failed = true;
+          stage_cnt = i;
+          break;
+        }
+      dup2 (last ? console_out : fds[1], STDOUT_FILENO);
+      pids[i] = exec (stages[i]);
+      if (!last)
+        {
+          close (fds[1]);
+          dup2 (fds[0], STDIN_FILENO);
+          close (fds[0]);
+        }
+    }
+  dup2 (console_in, STDIN_FILENO);
+  dup2 (console_out, STDOUT_FILENO);
+  close (console_in);
+  close (console_out);
+
+  if (pipe_failed)
+    printf ("pipe failed\n");
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("\"%s\": exec failed\n", stages[i]);
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -3,7 +3,13 @@
 #include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
+#include "threads/malloc.h"
+#include <debug.h>
+#include <hash.h>
 #include <list.h>
+#include <ohash.h>
+#include <stdio.h>
 #include <string.h>
 
 
@@ -11,7 +17,8 @@ enum buf_flag_t {
   B_VALID = 0x0, // 00
   B_BUSY = 0x1, // 01
   B_DIRTY = 0x2, // 10
-  B_LOADOK = 0x4
+  B_LOADOK = 0x4,
+  B_AHEAD = 0x8 // read ahead, not yet requested
 };
 
 
@@ -20,43 +27,122 @@ enum buf_flag_t {
 
 struct cache_e
 {
-  struct lock cache_lock; // lock
+  struct lock cache_lock; // lock; held while data is read or written
   block_sector_t sec;
-  enum buf_flag_t flag; // TODO: Valid? Invalid?
+  enum buf_flag_t flag; // B_VALID: holds no sector
   uint8_t data[BLOCK_SECTOR_SIZE];
-  struct list_elem elem;
+  struct list_elem elem; // in shard's lru
+  struct ohash_elem index_elem; // in shard's index, keyed by sec
 };
 
-static struct list cache;
+/* Cache Shard
+ *
+ * The cache is split into CACHE_SHARD_CNT shards by a hash of the
+ * sector number.  Each shard owns a fixed slice of the entries and
+ * has its own index, LRU list and lock, so requests for sectors in
+ * different shards never wait for the same shard lock.  The shard
+ * lock covers the index, the list, and which sector each entry
+ * holds; it is never held while waiting for an entry's cache_lock
+ * or for the disk.
+ *
+ * They still wait for each other, though: the shard locks are sleep
+ * locks, and the kernel lock (see threads/smp.c) runs every cache
+ * operation on one CPU at a time.  Sharding only shortens the lists
+ * each hit touches.  Hits on different CPUs will overlap once that
+ * lock is gone.
+ */
+#define CACHE_SHARD_CNT 4
+#define CACHE_SHARD_SIZE (MAX_CACHE_SIZE / CACHE_SHARD_CNT)
+
+struct cache_shard
+{
+  struct lock lock;
+  struct ohash index; // entries holding a sector, by sector
+  struct list lru; // all entries, most recently used first
+  struct cache_e entries[CACHE_SHARD_SIZE];
+};
 
-// Only used for element of cache
-static struct cache_e _cache_buffer[MAX_CACHE_SIZE];
+static struct cache_shard shards[CACHE_SHARD_CNT];
 
+// Writers write dirty entries back themselves once more than this
+// many are dirty, across all shards.
+#define CACHE_DIRTY_MAX (MAX_CACHE_SIZE / 2)
+static unsigned dirty_cnt;
+
+// Counters for cache_get_stats(), bumped without locking: a lost
+// update now and then is cheaper than a lock on every access.
+static struct cache_stats stats;
+
+
+/*
+ * cacheShard
+ *
+ * DESC | Get the shard that caches a sector.
+ *
+ * IN   | sec - given sector number
+ *
+ */
+static struct cache_shard*
+cacheShard(block_sector_t sec)
+{
+  return &shards[hash_int(sec) % CACHE_SHARD_CNT];
+}
+
+/*
+ * cacheMarkDirty / cacheWriteBack
+ *
+ * DESC | Set or clear B_DIRTY on a (LOCKED) entry, keeping dirty_cnt.
+ *      | cacheWriteBack writes the data first.
+ *
+ * RET  | cacheWriteBack: true if the entry was dirty
+ *
+ */
+static void
+cacheMarkDirty(struct cache_e* buffer)
+{
+  if(!(buffer->flag & B_DIRTY)){
+    buffer->flag |= B_DIRTY;
+    __sync_fetch_and_add(&dirty_cnt, 1);
+  }
+}
+
+static bool
+cacheWriteBack(struct cache_e* buffer)
+{
+  if(!(buffer->flag & B_DIRTY))
+    return false;
+  block_write(fs_device, buffer->sec, buffer->data);
+  buffer->flag -= B_DIRTY;
+  __sync_fetch_and_sub(&dirty_cnt, 1);
+  return true;
+}
 
 /*
  * cacheWriteBackThread
  *
- * DESC | Write all dirty data per interval. (Clock algorithm)
+ * DESC | Write all dirty data per interval.
  *
  * IN   | aux - Dummy NULL pointer
  *
  */
 static void cacheWriteBackThread(void* aux UNUSED)
 {
-  int i;
+  int i, j;
   while(true){
     timer_sleep(TIMER_FREQ * 10); // TODO: HOW MUCH?
     // since list_elem 'could' rearrange each time, we just use array.
     
-    for(i = 0 ; i < MAX_CACHE_SIZE ; i++)    
-      if(_cache_buffer[i].flag & B_DIRTY){ 
-        if(!lock_try_acquire(&_cache_buffer[i].cache_lock))
+    for(i = 0 ; i < CACHE_SHARD_CNT ; i++)
+      for(j = 0 ; j < CACHE_SHARD_SIZE ; j++){
+        struct cache_e* temp = &shards[i].entries[j];
+        if(!(temp->flag & B_DIRTY)
+            || !lock_try_acquire(&temp->cache_lock))
           continue; // is now working?
 
-        block_write(fs_device, _cache_buffer[i].sec, _cache_buffer[i].data);
-        _cache_buffer[i].flag -= B_DIRTY;
+        if(cacheWriteBack(temp))
+          stats.writebacks++;
 
-        lock_release(&_cache_buffer[i].cache_lock);
+        lock_release(&temp->cache_lock);
       }
   }
 }
@@ -69,84 +155,118 @@ static void cacheWriteBackThread(void* aux UNUSED)
  */
 void cache_init()
 {
-  int i;
-  list_init(&cache);
-  for(i = 0 ; i < MAX_CACHE_SIZE ; i++){
-    lock_init(&_cache_buffer[i].cache_lock);
-    list_push_back(&cache, &_cache_buffer[i].elem);
+  int i, j;
+  for(i = 0 ; i < CACHE_SHARD_CNT ; i++){
+    struct cache_shard* s = &shards[i];
+    lock_init(&s->lock);
+    if(!ohash_init(&s->index))
+      PANIC("cache index creation failed");
+    list_init(&s->lru);
+    for(j = 0 ; j < CACHE_SHARD_SIZE ; j++){
+      lock_init(&s->entries[j].cache_lock);
+      list_push_back(&s->lru, &s->entries[j].elem);
+    }
   }
   thread_create("cache_wb", PRI_DEFAULT, cacheWriteBackThread, NULL);
 }
 
 /*
- * cacheGetFree
+ * cacheGetVictim
+ *
+ * DESC | Get the least recently used entry of a shard that nobody
+ *      | is using.  Empty entries stay at the end of the list.
  *
- * DESC | Get B_VALID cache element
+ * IN   | s - (LOCKED) shard
  *
- * RET  | if cache is full, NULL
- *      | else last element of (LOCKED) cache mem
+ * RET  | if every entry is in use, NULL
+ *      | else (LOCKED) entry
  */
-static struct cache_e* 
-cacheGetFree(void)
+static struct cache_e*
+cacheGetVictim(struct cache_shard* s)
 {
-  int i;
-  for(i = 0 ; i < MAX_CACHE_SIZE ; i++){
-    if(_cache_buffer[i].flag
-        || !lock_try_acquire(&_cache_buffer[i].cache_lock)) continue;
-    _cache_buffer[i].flag |= B_BUSY;
-    return _cache_buffer + i;
+  struct list_elem* e;
+
+  for(e = list_rbegin(&s->lru); e != list_rend(&s->lru); e = list_prev(e)){
+    struct cache_e* temp = list_entry(e, struct cache_e, elem);
+    if(lock_try_acquire(&temp->cache_lock))
+      return temp;
   }
   return NULL;
 }
 
-/*
- * cacheUpdate
- *
- * DESC | Move MRU value to first slot.
- *
- * IN   | e - value that just updated (_ -> !B_VALID)
- *
- */
-static void
-cacheUpdate(struct list_elem* e)
-{
-  list_remove(e);
-  list_push_front(&cache, e);
-}
-
-
-
 /*
  * cacheGetIdx
  *
- * DESC | Get element which has same values with given
+ * DESC | Get the entry for a sector, claiming one for it on a miss.
+ *      | A dirty victim is written back before it leaves the index,
+ *      | so that nobody can read the sector from disk in between.
  *
  * IN   | sec - given sector number
+ *      | hit - set to whether the entry already held the sector
  *
- * RET  | If fail, NULL
- *      | else, list_elem* of found (LOCKED) value
+ * RET  | (LOCKED) entry.  On a miss its data is not loaded yet.
  */
 static struct cache_e*
-cacheGetIdx(block_sector_t sec)
+cacheGetIdx(block_sector_t sec, bool* hit)
 {
-  int i;
+  struct cache_shard* s = cacheShard(sec);
+  bool wrote_back = false;
+
+  while(true){
+    struct ohash_elem* found;
+    struct cache_e* temp;
 
-  for(i = 0 ; i < MAX_CACHE_SIZE ; i++){
-    struct cache_e* temp = _cache_buffer + i;
+    lock_acquire(&s->lock);
+    found = ohash_find(&s->index, sec);
+    if(found != NULL){
+      temp = ohash_entry(found, struct cache_e, index_elem);
+      list_remove(&temp->elem);
+      list_push_front(&s->lru, &temp->elem); // MRU
+      lock_release(&s->lock);
 
-    if(temp->sec == sec){
       lock_acquire(&temp->cache_lock);
-      if(temp->sec != sec){
-        lock_release(&temp->cache_lock);
-        return NULL;
-      }
-      else{
-        cacheUpdate(&temp->elem);
+      if(temp->flag != B_VALID && temp->sec == sec){
+        *hit = true;
         return temp;
       }
+      lock_release(&temp->cache_lock); // evicted meanwhile; retry
+      continue;
+    }
+
+    temp = cacheGetVictim(s);
+    if(temp == NULL){
+      // every entry is being read or written; let them finish
+      lock_release(&s->lock);
+      thread_yield();
+      continue;
     }
+    if(temp->flag & B_DIRTY){
+      lock_release(&s->lock);
+      cacheWriteBack(temp);
+      stats.dirty_evictions++;
+      wrote_back = true;
+      lock_release(&temp->cache_lock);
+      continue;
+    }
+
+    if(temp->flag != B_VALID){
+      TRACE(TRACE_CACHE_EVICT, temp->sec, wrote_back, 0);
+      stats.evictions++;
+      if(temp->flag & B_AHEAD)
+        stats.readahead_wasted++;
+      ohash_delete(&s->index, temp->sec);
+    }
+    temp->sec = sec;
+    temp->flag = B_BUSY;
+    temp->index_elem.key = sec;
+    ohash_insert(&s->index, &temp->index_elem);
+    list_remove(&temp->elem);
+    list_push_front(&s->lru, &temp->elem);
+    lock_release(&s->lock);
+
+    *hit = false;
+    return temp;
   }
-  return NULL;
 }
 
 struct ahead_set
@@ -156,37 +276,28 @@ struct ahead_set
 };
 
 
-static void cache_eviction(void);
-
-
 static void cacheLoadThread(void* aux)
 {
   struct ahead_set aheadWrap = *(struct ahead_set*)aux;
   free(aux);
 
   struct cache_e* ahead;
+  bool hit;
 
-
-  if(ahead = cacheGetIdx(aheadWrap.sec)){
+  ahead = cacheGetIdx(aheadWrap.sec, &hit);
+  if(hit){
     lock_release(&ahead->cache_lock);
     sema_up(aheadWrap.sema);
     thread_exit();
   }
-  
-  while((ahead = cacheGetFree()) == NULL)
-    cache_eviction();
 
-  // get lock by cacheGetFree
+  // get lock by cacheGetIdx
   //
-  ahead->sec = aheadWrap.sec;
+  ahead->flag |= B_AHEAD;
+  stats.readaheads++;
   sema_up(aheadWrap.sema);
-  
-//  if(ahead->flag & B_LOADOK) ahead->flag -= B_LOADOK;
 
   block_read(fs_device, aheadWrap.sec, ahead->data);
-  cacheUpdate(&ahead->elem); 
-
-//  ahead->flag |= B_LOADOK;
 
   lock_release(&ahead->cache_lock);
 
@@ -196,48 +307,88 @@ static void cacheLoadThread(void* aux)
 /* 
  * cacheLoadBlock
  *
- * DESC | Load 2 data (Read-Ahead) from sector if cache miss occur, 
- *      | and return list_elem* of sector
- *
- * IN   | sec - given sector number
+ * DESC | Load data for an entry claimed on a cache miss, and start
+ *      | reading the next sector ahead.
  *
- * RET  | list_elem* of given value
+ * IN   | ndata - (LOCKED) entry from cacheGetIdx
  *
  */
 
 
-static struct cache_e*
-cacheLoadBlock(block_sector_t sec)
+static void
+cacheLoadBlock(struct cache_e* ndata)
 {
   struct semaphore sema1;
   sema_init(&sema1, 0);
 
-  struct cache_e* ndata;
-  while((ndata = cacheGetFree()) == NULL)
-    cache_eviction(); 
-
-    // get lock by cacheGetFree
-  //
- 
-//  if(ndata->flag & B_LOADOK) ndata->flag -= B_LOADOK;
-  ndata->sec = sec;
-
-  block_read(fs_device, sec, ndata->data);
-//  ndata->flag |= B_LOADOK;
-  cacheUpdate(&ndata->elem);
+  block_read(fs_device, ndata->sec, ndata->data);
 
   struct ahead_set* aheadWrap = malloc(sizeof(struct ahead_set));
 
- // block_sector_t *ahead_sec = malloc(sizeof(block_sector_t));
   if(aheadWrap){
-    aheadWrap->sec = sec + 1;
+    aheadWrap->sec = ndata->sec + 1;
     aheadWrap->sema = &sema1;
     thread_create("ahead_reader", PRI_DEFAULT, cacheLoadThread, aheadWrap);
     sema_down(&sema1);
   }
  
   // still get lock
-  return ndata;
+}
+
+/*
+ * cacheCount
+ *
+ * DESC | Count a request as a hit or a miss, and a read-ahead entry
+ *      | as useful the first time it is hit.
+ *
+ * IN   | buffer - (LOCKED) entry found for the request
+ *      | hit - whether it already held the sector
+ *
+ */
+static void
+cacheCount(struct cache_e* buffer, bool hit)
+{
+  if(!hit){
+    stats.misses++;
+    return;
+  }
+  stats.hits++;
+  if(buffer->flag & B_AHEAD){
+    buffer->flag -= B_AHEAD;
+    stats.readahead_hits++;
+  }
+}
+
+/*
+ * cacheLimitDirty
+ *
+ * DESC | Write back dirty entries, starting from one shard, until
+ *      | no more than CACHE_DIRTY_MAX are dirty.  Entries in use are
+ *      | skipped.
+ *
+ * IN   | first - shard to start from
+ *
+ */
+static void
+cacheLimitDirty(struct cache_shard* first)
+{
+  int i, j;
+  int start = first - shards;
+
+  for(i = 0 ; i < CACHE_SHARD_CNT ; i++){
+    struct cache_shard* s = &shards[(start + i) % CACHE_SHARD_CNT];
+    for(j = 0 ; j < CACHE_SHARD_SIZE ; j++){
+      struct cache_e* temp = &s->entries[j];
+      if(dirty_cnt <= CACHE_DIRTY_MAX)
+        return;
+      if(!(temp->flag & B_DIRTY)
+          || !lock_try_acquire(&temp->cache_lock))
+        continue;
+      if(cacheWriteBack(temp))
+        stats.writebacks++;
+      lock_release(&temp->cache_lock);
+    }
+  }
 }
 
 /* NOTE:
@@ -259,15 +410,21 @@ cacheLoadBlock(block_sector_t sec)
  */
 void cache_write(block_sector_t sec, const void* from)
 {
-  struct cache_e* buffer = cacheGetIdx(sec);
-  if(buffer == NULL)
-    buffer = cacheLoadBlock(sec);
+  bool hit;
+  struct cache_e* buffer = cacheGetIdx(sec, &hit);
+  TRACE(hit ? TRACE_CACHE_HIT : TRACE_CACHE_MISS, sec, 1, 0);
+  cacheCount(buffer, hit);
+  if(!hit)
+    cacheLoadBlock(buffer);
 
-  // get lock by cacheGetIdx or cacheLoadBlock
+  // get lock by cacheGetIdx
 
   memcpy(buffer->data, from, BLOCK_SECTOR_SIZE);
-  buffer->flag |= B_DIRTY;
+  cacheMarkDirty(buffer);
   lock_release(&buffer->cache_lock);
+
+  if(dirty_cnt > CACHE_DIRTY_MAX)
+    cacheLimitDirty(cacheShard(sec));
 }
 
 
@@ -283,91 +440,77 @@ void cache_write(block_sector_t sec, const void* from)
  */
 void cache_read(block_sector_t sec, void* to)
 {
-  struct cache_e* buffer = cacheGetIdx(sec);
-  if(buffer == NULL)
-    buffer = cacheLoadBlock(sec);
-
-  // get lock by cacheGetIdx or cacheLoadBlock
+  bool hit;
+  struct cache_e* buffer = cacheGetIdx(sec, &hit);
+  TRACE(hit ? TRACE_CACHE_HIT : TRACE_CACHE_MISS, sec, 0, 0);
+  cacheCount(buffer, hit);
+  if(!hit)
+    cacheLoadBlock(buffer);
+
+  // get lock by cacheGetIdx
   
   memcpy(to, buffer->data, BLOCK_SECTOR_SIZE);
   lock_release(&buffer->cache_lock);
 }
 
 
-
 /*
- * oneblock_init
- *
- * DESC | Init buffer to empty
+ * cache_flush
  *
- * IN   | buffer - given buffer
+ * DESC | Write back every dirty entry, in every shard.  Entries stay
+ *      | cached.  Waits for entries that are in use.
  *
  */
-static void oneblock_release(struct cache_e* buffer)
+void cache_flush(void)
 {
-  buffer->sec = 0;
-  buffer->flag = B_VALID;
-//  memset(buffer->data, 0, BLOCK_SECTOR_SIZE); // Really have to do?
+  int i, j;
+  for(i = 0 ; i < CACHE_SHARD_CNT ; i++)
+    for(j = 0 ; j < CACHE_SHARD_SIZE ; j++){
+      struct cache_e* temp = &shards[i].entries[j];
+      if(!(temp->flag & B_DIRTY))
+        continue;
+      lock_acquire(&temp->cache_lock);
+      if(cacheWriteBack(temp))
+        stats.writebacks++;
+      lock_release(&temp->cache_lock);
+    }
 }
 
 
 /*
- * cache_force_one
+ * cache_get_stats
  *
- * DESC | force one sector of cache to write-back, and initialize.
- *      | "force clear"
+ * DESC | Copy the cache counters, and count the dirty entries now.
  *
- * IN   | pos - list_elem* of cache
+ * IN   | st - receives the counters
  *
  */
-static void cache_force_one(struct cache_e* buffer)
+void cache_get_stats(struct cache_stats* st)
 {
-  if(buffer->flag & B_DIRTY){
-    buffer->flag -= B_DIRTY;
-    block_write(fs_device, buffer->sec, buffer->data);
-  }
-  oneblock_release(buffer);
+  *st = stats;
+  st->entries = MAX_CACHE_SIZE;
+  st->dirty = dirty_cnt;
 }
 
 /*
- * cache_flush
- *
- * DESC | clear all cache (If dirty, write-back)
+ * cache_print_stats
  *
- */
-void cache_flush(void)
-{
-  int i;
-//  for(i = 0 ; i < MAX_CACHE_SIZE ; i++)
-//    cache_force_one(&_cache_buffer[i].elem);
-}
-
-
-/* 
- * cache_eviction 
- *
- * DESC | clear element of list by LRU algorithm
+ * DESC | Print the cache counters, for shutdown.
  *
  */
-static void cache_eviction(void)
+void cache_print_stats(void)
 {
-  int try_count = 2;
-  while(try_count){
-    struct list_elem* pos = list_rbegin(&cache);
-    struct cache_e* temp = list_entry(pos, struct cache_e, elem);
-
-    if(!lock_try_acquire(&temp->cache_lock))
-      continue;
-    if(temp->flag == B_VALID){
-      try_count--;
-      lock_release(&temp->cache_lock);
-      return;
-    }
-    else {
-      cache_force_one(temp); 
-      try_count--;
-      lock_release(&temp->cache_lock);
-      return;
-    }
-  }
+  struct cache_stats st;
+  unsigned long long requests;
+
+  cache_get_stats(&st);
+  requests = st.hits + st.misses;
+  if(requests == 0)
+    return;
+  printf("Cache: %llu hits, %llu misses (%llu%% hit rate), "
+         "%llu evictions (%llu dirty), %llu write-backs\n",
+         st.hits, st.misses, st.hits * 100 / requests,
+         st.evictions, st.dirty_evictions, st.writebacks);
+  printf("Cache: %llu read-ahead, %llu used, %llu wasted\n",
+         st.readaheads, st.readahead_hits, st.readahead_wasted);
 }
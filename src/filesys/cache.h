@@ -4,9 +4,27 @@
 #include "devices/block.h"
 #define MAX_CACHE_SIZE 64
 
+/* Buffer cache counters.  All but entries and dirty count events
+   since boot. */
+struct cache_stats
+{
+  unsigned long long hits;              /* Requests found in the cache. */
+  unsigned long long misses;            /* Requests that read the disk. */
+  unsigned long long evictions;         /* Entries reclaimed. */
+  unsigned long long dirty_evictions;   /* ...that had to be written first. */
+  unsigned long long writebacks;        /* Sectors written by cache_wb. */
+  unsigned long long readaheads;        /* Sectors prefetched. */
+  unsigned long long readahead_hits;    /* ...later requested. */
+  unsigned long long readahead_wasted;  /* ...evicted unrequested. */
+  unsigned entries;                     /* Size of the cache. */
+  unsigned dirty;                       /* Dirty entries now. */
+};
+
 void cache_init(void);
 void cache_write(block_sector_t, const void*);
 void cache_read(block_sector_t, void*);
 void cache_flush(void);
+void cache_get_stats(struct cache_stats*);
+void cache_print_stats(void);
 
 #endif
@@ -0,0 +1,556 @@
+#include "filesys/dedup.h"
+#include <debug.h>
+#include <hash.h>
+#include <ohash.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Block-level deduplication.
+
+   Every data sector that may be shared is described by a
+   dedup_entry.  Entries are found by sector number (to drop or
+   copy a reference) and, if their content hash is unique in the
+   table, by content hash (to find a sector that already holds
+   the data being written).  A hash match is always verified
+   against the cached sector contents before it is shared, so a
+   hash collision only costs a missed opportunity.
+
+   Sectors that no entry describes are owned by exactly one
+   inode and are freed straight into the free map.
+
+   The table file at DEDUP_SECTOR holds a header and one record
+   per entry, at a fixed slot.  Each change to an entry is
+   written through to its slot at once, so that the reference
+   counts on disk are as current as any other file system
+   metadata; a freed slot is zeroed and reused by the next new
+   entry.  A disk formatted without -dedup has no table, only
+   the reserved, zeroed sector, and gets one the first time it
+   is mounted with -dedup.  A table is loaded whenever one
+   exists, -dedup or not, so that shared sectors are still
+   copied before they are written. */
+
+/* Kernel command-line option "-dedup". */
+bool dedup_enabled;
+
+struct dedup_entry
+  {
+    struct ohash_elem sector_elem;      /* Element in by_sector. */
+    struct ohash_elem content_elem;     /* Element in by_content. */
+    block_sector_t sector;              /* Data sector. */
+    unsigned hash;                      /* Hash of the sector's data. */
+    unsigned ref_cnt;                   /* Number of block pointers. */
+    bool indexed;                       /* In by_content? */
+    uint32_t slot;                      /* Record number in the table. */
+    struct dedup_entry *next_free;      /* Next in free_entries. */
+  };
+
+/* On-disk form of a dedup_entry.  A free slot has REF_CNT 0. */
+struct dedup_disk
+  {
+    block_sector_t sector;
+    uint32_t hash;
+    uint32_t ref_cnt;
+  };
+
+/* Table file header. */
+struct dedup_header
+  {
+    uint32_t magic;                     /* DEDUP_MAGIC. */
+    uint32_t slot_cnt;                  /* Records that follow. */
+  };
+
+/* Identifies a dedup table. */
+#define DEDUP_MAGIC 0x44454450
+
+static struct ohash by_sector;          /* All entries, by sector. */
+static struct ohash by_content;         /* Indexed entries, by hash. */
+static struct file *dedup_file;         /* Persistent table. */
+static uint32_t slot_cnt;               /* Slots in the table file. */
+static struct dedup_entry *free_entries; /* Entries with free slots. */
+
+/* Protects everything above, and find_content()'s buffer. */
+static struct lock dedup_lock;
+
+/* Statistics. */
+static unsigned long long share_cnt;    /* Sectors shared instead of written. */
+static unsigned long long skip_cnt;     /* Rewrites of identical data. */
+static unsigned long long cow_cnt;      /* Copies made of shared sectors. */
+
+/*
+ * dedup_init
+ *
+ * DESC | Initialize the in-memory index.
+ *
+ */
+void
+dedup_init (void)
+{
+  if (!ohash_init (&by_sector) || !ohash_init (&by_content))
+    PANIC ("dedup index creation failed");
+  lock_init (&dedup_lock);
+}
+
+/*
+ * entry_store
+ *
+ * DESC | Write E's record to its slot in the table file, growing
+ *      | the header's slot count if E's slot is new.
+ *
+ */
+static void
+entry_store (struct dedup_entry *e)
+{
+  struct dedup_disk record;
+
+  if (dedup_file == NULL)
+    return;
+  record.sector = e->sector;
+  record.hash = e->hash;
+  record.ref_cnt = e->ref_cnt;
+  if (file_write_at (dedup_file, &record, sizeof record,
+                     sizeof (struct dedup_header)
+                     + e->slot * sizeof record) != sizeof record)
+    PANIC ("can't write dedup table");
+  if (e->slot >= slot_cnt)
+    {
+      struct dedup_header h = { DEDUP_MAGIC, e->slot + 1 };
+      slot_cnt = h.slot_cnt;
+      if (file_write_at (dedup_file, &h, sizeof h, 0) != sizeof h)
+        PANIC ("can't write dedup table");
+    }
+}
+
+/*
+ * entry_index
+ *
+ * DESC | Add E to by_sector, and to by_content unless another entry
+ *      | owns its hash.
+ *
+ * RET  | false, adding E to neither, if another entry already
+ *      | describes E's sector
+ */
+static bool
+entry_index (struct dedup_entry *e)
+{
+  e->sector_elem.key = e->sector;
+  e->content_elem.key = e->hash;
+  if (ohash_insert (&by_sector, &e->sector_elem) != NULL)
+    return false;
+  e->indexed = ohash_insert (&by_content, &e->content_elem) == NULL;
+  return true;
+}
+
+/*
+ * entry_add
+ *
+ * DESC | Create an entry for SECTOR holding data with hash HASH, and
+ *      | index it by content unless another entry owns that hash.
+ *
+ * RET  | new entry, or NULL if out of memory
+ */
+static struct dedup_entry *
+entry_add (block_sector_t sector, unsigned hash, unsigned ref_cnt)
+{
+  struct dedup_entry *e = free_entries;
+
+  if (e != NULL)
+    free_entries = e->next_free;
+  else
+    {
+      e = malloc (sizeof *e);
+      if (e == NULL)
+        return NULL;
+      e->slot = slot_cnt;
+    }
+  e->sector = sector;
+  e->hash = hash;
+  e->ref_cnt = ref_cnt;
+  if (!entry_index (e))
+    PANIC ("dedup: sector %"PRDSNu" tracked twice", sector);
+  entry_store (e);
+  return e;
+}
+
+/*
+ * entry_remove
+ *
+ * DESC | Drop E from both tables and free its slot.  E is kept
+ *      | for the next entry_add(), which reuses the slot.
+ *
+ */
+static void
+entry_remove (struct dedup_entry *e)
+{
+  if (e->indexed)
+    ohash_delete (&by_content, e->hash);
+  ohash_delete (&by_sector, e->sector);
+  e->ref_cnt = 0;
+  entry_store (e);
+  e->next_free = free_entries;
+  free_entries = e;
+}
+
+/*
+ * find_sector
+ *
+ * RET  | entry describing SECTOR, or NULL if SECTOR is unshared
+ */
+static struct dedup_entry *
+find_sector (block_sector_t sector)
+{
+  struct ohash_elem *e = ohash_find (&by_sector, sector);
+  return e != NULL ? ohash_entry (e, struct dedup_entry, sector_elem) : NULL;
+}
+
+/*
+ * find_content
+ *
+ * DESC | Look up a sector whose contents equal DATA.  The candidate
+ *      | picked by HASH is compared byte for byte.
+ *
+ * RET  | matching entry, or NULL
+ */
+static struct dedup_entry *
+find_content (unsigned hash, const void *data)
+{
+  static uint8_t buffer[BLOCK_SECTOR_SIZE];
+  struct ohash_elem *e = ohash_find (&by_content, hash);
+  struct dedup_entry *m;
+
+  if (e == NULL)
+    return NULL;
+  m = ohash_entry (e, struct dedup_entry, content_elem);
+  cache_read (m->sector, buffer);
+  return memcmp (buffer, data, BLOCK_SECTOR_SIZE) ? NULL : m;
+}
+
+/*
+ * dedup_allocate_zero
+ *
+ * DESC | Obtain a reference to a zero-filled data sector, sharing the
+ *      | one already on disk if there is one.
+ *
+ * IN   | sectorp - receives the sector
+ *
+ * RET  | false if the disk or memory is exhausted
+ */
+bool
+dedup_allocate_zero (block_sector_t *sectorp)
+{
+  static uint8_t zeros[BLOCK_SECTOR_SIZE];
+  unsigned hash = hash_bytes (zeros, BLOCK_SECTOR_SIZE);
+  struct dedup_entry *m;
+  bool success = true;
+
+  lock_acquire (&dedup_lock);
+  m = find_content (hash, zeros);
+  if (m != NULL)
+    {
+      m->ref_cnt++;
+      entry_store (m);
+      share_cnt++;
+      *sectorp = m->sector;
+    }
+  else if (free_map_allocate (1, sectorp))
+    {
+      cache_write (*sectorp, zeros);
+      entry_add (*sectorp, hash, 1);
+    }
+  else
+    success = false;
+  lock_release (&dedup_lock);
+  return success;
+}
+
+/*
+ * release
+ *
+ * DESC | dedup_release() with dedup_lock already held.
+ *
+ */
+static void
+release (block_sector_t sector)
+{
+  struct dedup_entry *e = find_sector (sector);
+
+  ASSERT (lock_held_by_current_thread (&dedup_lock));
+
+  if (e != NULL)
+    {
+      ASSERT (e->ref_cnt > 0);
+      if (--e->ref_cnt > 0)
+        {
+          entry_store (e);
+          return;
+        }
+      entry_remove (e);
+    }
+  free_map_release (sector, 1);
+}
+
+/*
+ * write_locked
+ *
+ * DESC | dedup_write() with dedup_lock already held.
+ *
+ */
+static block_sector_t
+write_locked (block_sector_t sector, const void *data)
+{
+  struct dedup_entry *e = find_sector (sector);
+  unsigned hash = 0;
+
+  if (dedup_enabled)
+    {
+      struct dedup_entry *m;
+
+      hash = hash_bytes (data, BLOCK_SECTOR_SIZE);
+      m = find_content (hash, data);
+      if (m == e && m != NULL)
+        {
+          skip_cnt++;
+          return sector;
+        }
+      if (m != NULL)
+        {
+          m->ref_cnt++;
+          entry_store (m);
+          share_cnt++;
+          release (sector);
+          return m->sector;
+        }
+    }
+  else if (e == NULL)
+    {
+      cache_write (sector, data);
+      return sector;
+    }
+
+  if (e != NULL && e->ref_cnt > 1)
+    {
+      /* Copy on write. */
+      block_sector_t copy;
+      if (!free_map_allocate (1, &copy))
+        return (block_sector_t) -1;
+      e->ref_cnt--;
+      entry_store (e);
+      cow_cnt++;
+      cache_write (copy, data);
+      if (dedup_enabled)
+        entry_add (copy, hash, 1);
+      return copy;
+    }
+
+  /* Sole owner: overwrite in place and re-index the new data. */
+  cache_write (sector, data);
+  if (e != NULL)
+    entry_remove (e);
+  if (dedup_enabled)
+    entry_add (sector, hash, 1);
+  return sector;
+}
+
+/*
+ * dedup_write
+ *
+ * DESC | Store DATA for a block pointer currently referring to SECTOR.
+ *      | Shares an identical sector if one exists, copies SECTOR
+ *      | first if it is shared, and otherwise writes it in place.
+ *
+ * IN   | sector - sector the block pointer refers to now
+ *      | data - BLOCK_SECTOR_SIZE bytes to store
+ *
+ * RET  | sector the block pointer must refer to afterward,
+ *      | or (block_sector_t) -1 if the disk is full
+ */
+block_sector_t
+dedup_write (block_sector_t sector, const void *data)
+{
+  block_sector_t result;
+
+  lock_acquire (&dedup_lock);
+  result = write_locked (sector, data);
+  lock_release (&dedup_lock);
+  return result;
+}
+
+/*
+ * dedup_release
+ *
+ * DESC | Drop one reference to data sector SECTOR, returning it to the
+ *      | free map with the last one.
+ *
+ */
+void
+dedup_release (block_sector_t sector)
+{
+  lock_acquire (&dedup_lock);
+  release (sector);
+  lock_release (&dedup_lock);
+}
+
+/*
+ * dedup_create
+ *
+ * DESC | Create an empty table file at DEDUP_SECTOR and open it.
+ *
+ */
+void
+dedup_create (void)
+{
+  struct dedup_header h = { DEDUP_MAGIC, 0 };
+
+  if (!inode_create (DEDUP_SECTOR, 0))
+    PANIC ("dedup table creation failed");
+  dedup_file = file_open (inode_open (DEDUP_SECTOR));
+  if (dedup_file == NULL)
+    PANIC ("can't open dedup table");
+  if (file_write_at (dedup_file, &h, sizeof h, 0) != sizeof h)
+    PANIC ("can't write dedup table");
+  slot_cnt = 0;
+}
+
+/*
+ * dedup_reserve
+ *
+ * DESC | Zero DEDUP_SECTOR when formatting without -dedup, so that
+ *      | a later mount with -dedup can tell that it is free for a
+ *      | table.
+ *
+ */
+void
+dedup_reserve (void)
+{
+  static uint8_t zeros[BLOCK_SECTOR_SIZE];
+
+  cache_write (DEDUP_SECTOR, zeros);
+}
+
+/*
+ * table_absent
+ *
+ * DESC | Handle a disk without a table: create one on a disk that
+ *      | reserved DEDUP_SECTOR for it, or turn -dedup off on a disk
+ *      | that predates it.  Without -dedup, there is nothing to do.
+ *
+ */
+static void
+table_absent (void)
+{
+  static uint8_t buffer[BLOCK_SECTOR_SIZE];
+  size_t i;
+
+  if (!dedup_enabled)
+    return;
+
+  cache_read (DEDUP_SECTOR, buffer);
+  for (i = 0; i < BLOCK_SECTOR_SIZE; i++)
+    if (buffer[i] != 0)
+      {
+        printf ("dedup: file system has no dedup table, "
+                "ignoring -dedup\n");
+        dedup_enabled = false;
+        return;
+      }
+  dedup_create ();
+}
+
+/*
+ * dedup_open
+ *
+ * DESC | Open the table file, if the disk has one, and load its
+ *      | entries into memory.  After formatting, the table is
+ *      | already open and memory already matches it, so loading it
+ *      | again would only add every entry a second time.
+ *
+ */
+void
+dedup_open (void)
+{
+  struct dedup_disk *records;
+  size_t per_page = PGSIZE / sizeof *records;
+  struct dedup_header h;
+  uint32_t i;
+  off_t ofs;
+
+  if (dedup_file != NULL)
+    return;
+  if (!inode_is_valid (DEDUP_SECTOR))
+    {
+      table_absent ();
+      return;
+    }
+  dedup_file = file_open (inode_open (DEDUP_SECTOR));
+  if (dedup_file == NULL)
+    PANIC ("can't open dedup table");
+  if (file_read_at (dedup_file, &h, sizeof h, 0) != sizeof h
+      || h.magic != DEDUP_MAGIC)
+    PANIC ("dedup table is corrupt, or from an older kernel");
+
+  records = palloc_get_page (PAL_ASSERT);
+  ofs = sizeof h;
+  for (i = 0; i < h.slot_cnt; i += per_page)
+    {
+      size_t n = h.slot_cnt - i < per_page ? h.slot_cnt - i : per_page;
+      size_t j;
+
+      if (file_read_at (dedup_file, records, n * sizeof *records, ofs)
+          != (off_t) (n * sizeof *records))
+        PANIC ("can't read dedup table");
+      ofs += n * sizeof *records;
+      for (j = 0; j < n; j++)
+        {
+          struct dedup_entry *e = malloc (sizeof *e);
+          if (e == NULL)
+            PANIC ("dedup table too large for memory");
+          e->sector = records[j].sector;
+          e->hash = records[j].hash;
+          e->ref_cnt = records[j].ref_cnt;
+          e->slot = i + j;
+          if (e->ref_cnt > 0)
+            {
+              if (!entry_index (e))
+                PANIC ("dedup table is corrupt");
+            }
+          else
+            {
+              e->next_free = free_entries;
+              free_entries = e;
+            }
+        }
+    }
+  palloc_free_page (records);
+  slot_cnt = h.slot_cnt;
+}
+
+/*
+ * dedup_close
+ *
+ * DESC | Close the table file.  Its records are already up to date.
+ *
+ */
+void
+dedup_close (void)
+{
+  file_close (dedup_file);
+  dedup_file = NULL;
+}
+
+/* Prints deduplication statistics. */
+void
+dedup_print_stats (void)
+{
+  if (dedup_enabled || !ohash_empty (&by_sector))
+    printf ("Dedup: %zu tracked sectors, %llu shared, %llu rewrites "
+            "skipped, %llu copies on write\n",
+            ohash_size (&by_sector), share_cnt, skip_cnt, cow_cnt);
+}
@@ -0,0 +1,24 @@
+#ifndef FILESYS_DEDUP_H
+#define FILESYS_DEDUP_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* If false (default), data sectors are never shared.
+   If true, identical data sectors are shared between files.
+   Controlled by kernel command-line option "-dedup". */
+extern bool dedup_enabled;
+
+void dedup_init (void);
+void dedup_create (void);
+void dedup_reserve (void);
+void dedup_open (void);
+void dedup_close (void);
+
+bool dedup_allocate_zero (block_sector_t *);
+block_sector_t dedup_write (block_sector_t, const void *);
+void dedup_release (block_sector_t);
+
+void dedup_print_stats (void);
+
+#endif /* filesys/dedup.h */
@@ -6,6 +6,7 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/dedup.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -23,11 +24,13 @@ filesys_init (bool format)
 
   inode_init ();
   free_map_init ();
+  dedup_init ();
 
   if (format) 
     do_format ();
 
   free_map_open ();
+  dedup_open ();
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -35,6 +38,7 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  dedup_close ();
   free_map_close ();
 }
 
@@ -96,8 +100,13 @@ do_format (void)
 {
   printf ("Formatting file system...");
   free_map_create ();
+  if (dedup_enabled)
+    dedup_create ();
+  else
+    dedup_reserve ();
   if (!dir_create (ROOT_DIR_SECTOR, 16))
     PANIC ("root directory creation failed");
+  /* The dedup table, if any, stays open for dedup_open(). */
   free_map_close ();
   printf ("done.\n");
 }
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <round.h>
 #include <ustar.h>
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -67,6 +68,12 @@ fsutil_rm (char **argv)
     PANIC ("%s: delete failed\n", file_name);
 }
 
+/* Pages in the buffer fsutil_extract() copies file data through.
+   Each file is read from the scratch device in runs of up to this
+   many pages, each with one multi-sector request. */
+#define EXTRACT_PAGES 16
+#define EXTRACT_RUN_SIZE (EXTRACT_PAGES * PGSIZE)
+
 /* Extracts a ustar-format tar archive from the scratch block
    device into the Pintos file system. */
 void
@@ -79,7 +86,7 @@ fsutil_extract (char **argv UNUSED)
 
   /* Allocate buffers. */
   header = malloc (BLOCK_SECTOR_SIZE);
-  data = malloc (BLOCK_SECTOR_SIZE);
+  data = palloc_get_multiple (0, EXTRACT_PAGES);
   if (header == NULL || data == NULL)
     PANIC ("couldn't allocate buffers");
 
@@ -117,20 +124,24 @@ fsutil_extract (char **argv UNUSED)
 
           printf ("Putting '%s' into the file system...\n", file_name);
 
-          /* Create destination file. */
+          /* Create destination file, preallocated to its full
+             size so that the writes below never grow it. */
           if (!filesys_create (file_name, size))
             PANIC ("%s: create failed", file_name);
           dst = filesys_open (file_name);
           if (dst == NULL)
             PANIC ("%s: open failed", file_name);
 
-          /* Do copy. */
+          /* Do copy, a run of sectors at a time. */
           while (size > 0)
             {
-              int chunk_size = (size > BLOCK_SECTOR_SIZE
-                                ? BLOCK_SECTOR_SIZE
+              int chunk_size = (size > EXTRACT_RUN_SIZE
+                                ? EXTRACT_RUN_SIZE
                                 : size);
-              block_read (src, sector++, data);
+              block_sector_t chunk_sectors = DIV_ROUND_UP (chunk_size,
+                                                           BLOCK_SECTOR_SIZE);
+              block_read_multiple (src, sector, chunk_sectors, data);
+              sector += chunk_sectors;
               if (file_write (dst, data, chunk_size) != chunk_size)
                 PANIC ("%s: write failed with %d bytes unwritten",
                        file_name, size);
@@ -151,7 +162,7 @@ fsutil_extract (char **argv UNUSED)
   block_write (src, 0, header);
   block_write (src, 1, header);
 
-  free (data);
+  palloc_free_multiple (data, EXTRACT_PAGES);
   free (header);
 }
 
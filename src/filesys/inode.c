@@ -7,6 +7,7 @@
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "filesys/cache.h"
+#include "filesys/dedup.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -176,16 +177,48 @@ init_blocks (block_sector_t* blocks, int num)
     blocks[i] = -1;
 }
 
+/*
+ * inode_is_shareable
+ *
+ * DESC | Data sectors of the free map and dedup table files are never
+ *      | shared, since dedup itself writes to both of them.
+ */
+static bool
+inode_is_shareable (block_sector_t sector)
+{
+  return sector != FREE_MAP_SECTOR && sector != DEDUP_SECTOR;
+}
+
+/*
+ * allocate_data_sector
+ *
+ * DESC | Allocate one zero-filled data sector into *SECTOR.  With
+ *      | dedup on, SHARE lets it refer to the common zero sector.
+ */
+static bool
+allocate_data_sector (block_sector_t *sector, bool share)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+
+  if (share && dedup_enabled)
+    return dedup_allocate_zero (sector);
+  if (!free_map_allocate (1, sector))
+    return false;
+  COND_block_write (fs_device, *sector, zeros);
+  return true;
+}
+
 /* 
  * allocate_inode_data
  * 
  * DSEC | Allocate inode data to inode_disk.
+ *      | SHARE is passed to allocate_data_sector.
  */
 bool
-allocate_inode_data (struct inode_disk* id, block_sector_t sectors, int start)
+allocate_inode_data (struct inode_disk* id, block_sector_t sectors, int start,
+                     bool share)
 {
   bool success = false;
-  static char zeros[BLOCK_SECTOR_SIZE];
   int i;
   struct inode_disk_indirect idi;
   if (start < 10)
@@ -221,8 +254,7 @@ allocate_inode_data (struct inode_disk* id, block_sector_t sectors, int start)
     {
       if (i < 10)
         {
-          if (!free_map_allocate (1, &id->d_blocks[i])) return false;
-          COND_block_write (fs_device, id->d_blocks[i], zeros);
+          if (!allocate_data_sector (&id->d_blocks[i], share)) return false;
         }
       else if (i < 1290)
         {
@@ -235,8 +267,7 @@ allocate_inode_data (struct inode_disk* id, block_sector_t sectors, int start)
               init_blocks (idi.d_blocks, 128);
             }
           ASSERT (idi.d_blocks[sec] == -1);
-          if (!free_map_allocate (1, &idi.d_blocks[sec])) return false;
-          COND_block_write (fs_device, idi.d_blocks[sec], zeros);
+          if (!allocate_data_sector (&idi.d_blocks[sec], share)) return false;
           if (sec == 127 || i == sectors - 1)
             COND_block_write (fs_device, id->ind_blocks[i_a / 128], &idi);
         }
@@ -256,8 +287,7 @@ allocate_inode_data (struct inode_disk* id, block_sector_t sectors, int start)
               init_blocks (idi.d_blocks, 128);
             }
           ASSERT (idi.d_blocks[sec] == -1);
-          if (!free_map_allocate (1, &idi.d_blocks[sec])) return false;
-          COND_block_write (fs_device, idi.d_blocks[sec], zeros);
+          if (!allocate_data_sector (&idi.d_blocks[sec], share)) return false;
           if (sec == 127 || i == sectors - 1)
             COND_block_write (fs_device, iddi.ind_blocks[i_a / 128], &idi); 
           if (i == sectors - 1)
@@ -299,13 +329,29 @@ inode_create (block_sector_t sector, off_t length)
       init_blocks (disk_inode->d_blocks, 10);
       init_blocks (disk_inode->ind_blocks, 10);
       disk_inode->d_ind_blocks = -1;
-      success = allocate_inode_data (disk_inode, sectors, 0);
+      success = allocate_inode_data (disk_inode, sectors, 0,
+                                     inode_is_shareable (sector));
       COND_block_write (fs_device, sector, disk_inode);
       free (disk_inode);
     }
   return success;
 }
 
+/*
+ * inode_is_valid
+ *
+ * DESC | Check whether SECTOR holds an inode, by its magic number,
+ *      | before trusting its block pointers.
+ */
+bool
+inode_is_valid (block_sector_t sector)
+{
+  struct inode_disk disk_inode;
+
+  COND_block_read (fs_device, sector, &disk_inode);
+  return disk_inode.magic == INODE_MAGIC;
+}
+
 /* Reads an inode from SECTOR
    and returns a `struct inode' that contains it.
    Returns a null pointer if memory allocation fails. */
@@ -392,7 +438,7 @@ inode_close (struct inode *inode)
             {
               if (inode->data.d_blocks[i] != -1)
                 {
-                  free_map_release (inode->data.d_blocks[i], 1);
+                  dedup_release (inode->data.d_blocks[i]);
                 }
               else
                 break;
@@ -409,7 +455,7 @@ inode_close (struct inode *inode)
                   for (j = 0; j < 128; j++)
                     {
                       if (idi.d_blocks[j] != -1)
-                        free_map_release (idi.d_blocks[j], 1);
+                        dedup_release (idi.d_blocks[j]);
                       else
                         {
                           flag = true;
@@ -440,7 +486,7 @@ inode_close (struct inode *inode)
                       for (n = 0; n < 128; n++)
                         {
                           if (idi.d_blocks[n] != -1)
-                            free_map_release (idi.d_blocks[n], 1);
+                            dedup_release (idi.d_blocks[n]);
                           else
                             {
                               flag = true;
@@ -527,6 +573,74 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   return bytes_read;
 }
 
+/*
+ * set_sector
+ *
+ * DESC | Point the block pointer covering byte offset POS of INODE at
+ *      | SECTOR, in the same (DIRECTS -> INDIRECTS -> DOUBLE) order
+ *      | byte_to_sector follows.
+ */
+static void
+set_sector (struct inode *inode, off_t pos, block_sector_t sector)
+{
+  struct inode_disk_indirect idi;
+  block_sector_t ind_idx;
+  off_t remaining;
+
+  if (pos < MAX_DIRECTS)
+    {
+      inode->data.d_blocks[pos / BLOCK_SECTOR_SIZE] = sector;
+      COND_block_write (fs_device, inode->sector, &inode->data);
+      return;
+    }
+  else if (pos < MAX_DIRECTS + MAX_INDIRECTS)
+    {
+      ind_idx = inode->data.ind_blocks[(pos - MAX_DIRECTS) /
+                                       (BLOCK_SECTOR_SIZE*128)];
+      remaining = (pos - MAX_DIRECTS) % (BLOCK_SECTOR_SIZE*128);
+    }
+  else
+    {
+      struct inode_disk_double_indirect iddi;
+      COND_block_read (fs_device, inode->data.d_ind_blocks, &iddi);
+      ind_idx = iddi.ind_blocks[(pos-MAX_DIRECTS-MAX_INDIRECTS) /
+                                (BLOCK_SECTOR_SIZE*128)];
+      remaining = (pos-MAX_DIRECTS-MAX_INDIRECTS) % (BLOCK_SECTOR_SIZE*128);
+    }
+  ASSERT (ind_idx != (block_sector_t) -1);
+  COND_block_read (fs_device, ind_idx, &idi);
+  idi.d_blocks[remaining / BLOCK_SECTOR_SIZE] = sector;
+  COND_block_write (fs_device, ind_idx, &idi);
+}
+
+/*
+ * write_data_sector
+ *
+ * DESC | Write DATA to SECTOR, the data sector holding byte offset POS
+ *      | of INODE.  Goes through dedup, which may hand back a
+ *      | different sector, in which case the block pointer follows.
+ *
+ * RET  | false if the disk is full
+ */
+static bool
+write_data_sector (struct inode *inode, off_t pos, block_sector_t sector,
+                   const void *data)
+{
+  block_sector_t new_sector;
+
+  if (!inode_is_shareable (inode->sector))
+    {
+      COND_block_write (fs_device, sector, data);
+      return true;
+    }
+  new_sector = dedup_write (sector, data);
+  if (new_sector == (block_sector_t) -1)
+    return false;
+  if (new_sector != sector)
+    set_sector (inode, pos, new_sector);
+  return true;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
@@ -554,7 +668,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     {
       int sectors = bytes_to_sectors (offset + size);
       int start = bytes_to_sectors (inode_length (inode));
-      if (!allocate_inode_data (&inode->data, sectors, start)) ASSERT (0);
+      if (!allocate_inode_data (&inode->data, sectors, start,
+                                inode_is_shareable (inode->sector)))
+        ASSERT (0);
       inode->data.length += offset - inode->data.length + size;
       COND_block_write (fs_device, inode->sector, &inode->data);
 //printf ("off+isze: %d, legnth: %d, start: %d, sectors: %d\n", offset+size, inode_length(inode), start, sectors);
@@ -581,7 +697,9 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* Write full sector directly to disk. */
-          COND_block_write (fs_device, sector_idx, buffer + bytes_written);
+          if (!write_data_sector (inode, offset, sector_idx,
+                                  buffer + bytes_written))
+            break;
         }
       else 
         {
@@ -601,7 +719,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          COND_block_write (fs_device, sector_idx, bounce);
+          if (!write_data_sector (inode, offset, sector_idx, bounce))
+            break;
         }
 
       /* Advance. */
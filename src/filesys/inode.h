@@ -9,6 +9,7 @@ struct bitmap;
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t);
+bool inode_is_valid (block_sector_t);
 struct inode *inode_open (block_sector_t);
 struct inode *inode_reopen (struct inode *);
 block_sector_t inode_get_inumber (const struct inode *);
@@ -18,6 +18,8 @@ static struct hash_elem *find_elem (struct hash *, struct list *,
 static void insert_elem (struct hash *, struct list *, struct hash_elem *);
 static void remove_elem (struct hash *, struct hash_elem *);
 static void rehash (struct hash *);
+static void migrate (struct hash *);
+static struct list *next_bucket (struct hash *, struct list *);
 
 /* Initializes hash table H to compute hash values using HASH and
    compare hash elements using LESS, given auxiliary data AUX. */
@@ -28,6 +30,9 @@ hash_init (struct hash *h,
   h->elem_cnt = 0;
   h->bucket_cnt = 4;
   h->buckets = malloc (sizeof *h->buckets * h->bucket_cnt);
+  h->old_buckets = NULL;
+  h->old_bucket_cnt = 0;
+  h->migrate_idx = 0;
   h->hash = hash;
   h->less = less;
   h->aux = aux;
@@ -53,12 +58,10 @@ hash_init (struct hash *h,
 void
 hash_clear (struct hash *h, hash_action_func *destructor) 
 {
-  size_t i;
+  struct list *bucket;
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (bucket = h->buckets; bucket != NULL; bucket = next_bucket (h, bucket))
     {
-      struct list *bucket = &h->buckets[i];
-
       if (destructor != NULL) 
         while (!list_empty (bucket)) 
           {
@@ -70,6 +73,9 @@ hash_clear (struct hash *h, hash_action_func *destructor)
       list_init (bucket); 
     }    
 
+  /* With every bucket empty, there is nothing left to move. */
+  free (h->old_buckets);
+  h->old_buckets = NULL;
   h->elem_cnt = 0;
 }
 
@@ -89,6 +95,7 @@ hash_destroy (struct hash *h, hash_action_func *destructor)
   if (destructor != NULL)
     hash_clear (h, destructor);
   free (h->buckets);
+  free (h->old_buckets);
 }
 
 /* Inserts NEW into hash table H and returns a null pointer, if
@@ -162,13 +169,12 @@ hash_delete (struct hash *h, struct hash_elem *e)
 void
 hash_apply (struct hash *h, hash_action_func *action) 
 {
-  size_t i;
+  struct list *bucket;
   
   ASSERT (action != NULL);
 
-  for (i = 0; i < h->bucket_cnt; i++) 
+  for (bucket = h->buckets; bucket != NULL; bucket = next_bucket (h, bucket))
     {
-      struct list *bucket = &h->buckets[i];
       struct list_elem *elem, *next;
 
       for (elem = list_begin (bucket); elem != list_end (bucket); elem = next) 
@@ -223,7 +229,8 @@ hash_next (struct hash_iterator *i)
   i->elem = list_elem_to_hash_elem (list_next (&i->elem->list_elem));
   while (i->elem == list_elem_to_hash_elem (list_end (i->bucket)))
     {
-      if (++i->bucket >= i->hash->buckets + i->hash->bucket_cnt)
+      i->bucket = next_bucket (i->hash, i->bucket);
+      if (i->bucket == NULL)
         {
           i->elem = NULL;
           break;
@@ -301,12 +308,38 @@ hash_int (int i)
   return hash_bytes (&i, sizeof i);
 }
 
-/* Returns the bucket in H that E belongs in. */
+/* Returns the bucket in H that E belongs in: its bucket in the
+   old bucket array, if that one has not been emptied yet, or
+   otherwise its bucket in the current array. */
 static struct list *
 find_bucket (struct hash *h, struct hash_elem *e) 
 {
-  size_t bucket_idx = h->hash (e, h->aux) & (h->bucket_cnt - 1);
-  return &h->buckets[bucket_idx];
+  unsigned hash = h->hash (e, h->aux);
+
+  if (h->old_buckets != NULL) 
+    {
+      size_t old_idx = hash & (h->old_bucket_cnt - 1);
+      if (old_idx >= h->migrate_idx)
+        return &h->old_buckets[old_idx];
+    }
+  return &h->buckets[hash & (h->bucket_cnt - 1)];
+}
+
+/* Returns the bucket in H that follows BUCKET in iteration
+   order, or a null pointer if BUCKET is the last one.  The
+   current buckets come first, then the old buckets that still
+   hold elements. */
+static struct list *
+next_bucket (struct hash *h, struct list *bucket) 
+{
+  if (bucket >= h->buckets && bucket < h->buckets + h->bucket_cnt)
+    {
+      if (bucket + 1 < h->buckets + h->bucket_cnt)
+        return bucket + 1;
+      return (h->old_buckets != NULL
+              ? &h->old_buckets[h->migrate_idx] : NULL);
+    }
+  return bucket + 1 < h->old_buckets + h->old_bucket_cnt ? bucket + 1 : NULL;
 }
 
 /* Searches BUCKET in H for a hash element equal to E.  Returns
@@ -344,35 +377,54 @@ is_power_of_2 (size_t x)
 #define BEST_ELEMS_PER_BUCKET 2 /* Ideal elems/bucket. */
 #define MAX_ELEMS_PER_BUCKET  4 /* Elems/bucket > 4: increase # of buckets. */
 
-/* Changes the number of buckets in hash table H to match the
-   ideal.  This function can fail because of an out-of-memory
+/* Old buckets emptied by each insertion or deletion.  A resize
+   leaves the table at BEST_ELEMS_PER_BUCKET, so at least half
+   as many insertions or deletions as there are old buckets
+   must come before the next one; this many per operation
+   finishes emptying the old buckets well before that. */
+#define MIGRATE_BUCKETS 4
+
+/* Moves the elements of a few more of H's old buckets into the
+   current ones, then, if the table's load is out of bounds,
+   starts changing the number of buckets to match the ideal.
+   This function can fail because of an out-of-memory
    condition, but that'll just make hash accesses less efficient;
    we can still continue. */
 static void
 rehash (struct hash *h) 
 {
-  size_t old_bucket_cnt, new_bucket_cnt;
-  struct list *new_buckets, *old_buckets;
+  size_t new_bucket_cnt;
+  struct list *new_buckets;
   size_t i;
 
   ASSERT (h != NULL);
 
-  /* Save old bucket info for later use. */
-  old_buckets = h->buckets;
-  old_bucket_cnt = h->bucket_cnt;
+  migrate (h);
+
+  /* Change the number of buckets only once the last change is
+     complete, and only if the load has strayed far enough from
+     the ideal that changing it will not be undone again soon. */
+  if (h->old_buckets != NULL
+      || (h->elem_cnt >= h->bucket_cnt * MIN_ELEMS_PER_BUCKET
+          && h->elem_cnt <= h->bucket_cnt * MAX_ELEMS_PER_BUCKET))
+    return;
 
   /* Calculate the number of buckets to use now.
      We want one bucket for about every BEST_ELEMS_PER_BUCKET.
      We must have at least four buckets, and the number of
-     buckets must be a power of 2. */
+     buckets must be a power of 2, so we round up. */
   new_bucket_cnt = h->elem_cnt / BEST_ELEMS_PER_BUCKET;
   if (new_bucket_cnt < 4)
     new_bucket_cnt = 4;
-  while (!is_power_of_2 (new_bucket_cnt))
-    new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
+  if (!is_power_of_2 (new_bucket_cnt))
+    {
+      while (!is_power_of_2 (new_bucket_cnt))
+        new_bucket_cnt = turn_off_least_1bit (new_bucket_cnt);
+      new_bucket_cnt <<= 1;
+    }
 
   /* Don't do anything if the bucket count wouldn't change. */
-  if (new_bucket_cnt == old_bucket_cnt)
+  if (new_bucket_cnt == h->bucket_cnt)
     return;
 
   /* Allocate new buckets and initialize them as empty. */
@@ -387,29 +439,41 @@ rehash (struct hash *h)
   for (i = 0; i < new_bucket_cnt; i++) 
     list_init (&new_buckets[i]);
 
-  /* Install new bucket info. */
+  /* Install new bucket info.  The elements move over a few
+     buckets at a time, starting with this operation. */
+  h->old_buckets = h->buckets;
+  h->old_bucket_cnt = h->bucket_cnt;
+  h->migrate_idx = 0;
   h->buckets = new_buckets;
   h->bucket_cnt = new_bucket_cnt;
+  migrate (h);
+}
+
+/* Moves the elements of up to MIGRATE_BUCKETS of H's old
+   buckets into the current ones, and frees the old buckets once
+   they are all empty. */
+static void
+migrate (struct hash *h) 
+{
+  size_t n;
 
-  /* Move each old element into the appropriate new bucket. */
-  for (i = 0; i < old_bucket_cnt; i++) 
+  for (n = 0; n < MIGRATE_BUCKETS && h->old_buckets != NULL; n++) 
     {
-      struct list *old_bucket;
-      struct list_elem *elem, *next;
+      struct list *old_bucket = &h->old_buckets[h->migrate_idx++];
 
-      old_bucket = &old_buckets[i];
-      for (elem = list_begin (old_bucket);
-           elem != list_end (old_bucket); elem = next) 
+      while (!list_empty (old_bucket)) 
         {
-          struct list *new_bucket
-            = find_bucket (h, list_elem_to_hash_elem (elem));
-          next = list_next (elem);
-          list_remove (elem);
-          list_push_front (new_bucket, elem);
+          struct list_elem *elem = list_pop_front (old_bucket);
+          unsigned hash = h->hash (list_elem_to_hash_elem (elem), h->aux);
+          list_push_front (&h->buckets[hash & (h->bucket_cnt - 1)], elem);
         }
-    }
 
-  free (old_buckets);
+      if (h->migrate_idx == h->old_bucket_cnt) 
+        {
+          free (h->old_buckets);
+          h->old_buckets = NULL;
+        }
+    }
 }
 
 /* Inserts E into BUCKET (in hash table H). */
@@ -0,0 +1,295 @@
+/* Open-addressed hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Initial number of slots. */
+#define MIN_SLOTS 16
+
+static bool resize (struct ohash *, size_t slot_cnt);
+static void place (struct ohash *, struct ohash_slot);
+
+/* Returns the home slot of KEY in H, the first slot a lookup of
+   KEY examines.  This is Fibonacci hashing: the multiplication
+   mixes every bit of KEY into the high bits of the product,
+   which select the slot. */
+static inline size_t
+home_slot (const struct ohash *h, uint32_t key) 
+{
+  return (uint32_t) (key * 2654435769u) >> h->shift;
+}
+
+/* Returns how far slot IDX in H, which holds KEY, is from KEY's
+   home slot. */
+static inline size_t
+probe_distance (const struct ohash *h, size_t idx, uint32_t key) 
+{
+  return (idx - home_slot (h, key)) & (h->slot_cnt - 1);
+}
+
+/* Returns the index of the slot in H that holds KEY, or
+   SIZE_MAX if none does. */
+static size_t
+find_slot (const struct ohash *h, uint32_t key) 
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t idx = home_slot (h, key);
+  size_t dist;
+
+  for (dist = 0; ; dist++, idx = (idx + 1) & mask) 
+    {
+      const struct ohash_slot *s = &h->slots[idx];
+
+      if (s->elem == NULL || probe_distance (h, idx, s->key) < dist)
+        return SIZE_MAX;
+      if (s->key == key)
+        return idx;
+    }
+}
+
+/* Initializes open hash table H.  Returns true if successful,
+   false if memory allocation failed. */
+bool
+ohash_init (struct ohash *h) 
+{
+  h->elem_cnt = 0;
+  h->slot_cnt = 0;
+  h->slots = NULL;
+  return resize (h, MIN_SLOTS);
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the table.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the element.  However, modifying H while
+   ohash_clear() is running, using any of the functions
+   ohash_clear(), ohash_destroy(), ohash_insert(), or
+   ohash_delete(), yields undefined behavior, whether done in
+   DESTRUCTOR or elsewhere. */
+void
+ohash_clear (struct ohash *h, ohash_action_func *destructor) 
+{
+  size_t i;
+
+  for (i = 0; i < h->slot_cnt; i++) 
+    {
+      struct ohash_elem *e = h->slots[i].elem;
+
+      h->slots[i].elem = NULL;
+      if (e != NULL && destructor != NULL)
+        destructor (e);
+    }
+  h->elem_cnt = 0;
+}
+
+/* Destroys open hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the table, with the same restrictions as in
+   ohash_clear(). */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *destructor) 
+{
+  if (destructor != NULL)
+    ohash_clear (h, destructor);
+  free (h->slots);
+}
+
+/* Inserts NEW, whose key must already be set, into H and
+   returns a null pointer, if no element with the same key is
+   already in the table.  If one is, returns it without
+   inserting NEW.
+
+   Panics if H is full and cannot grow for lack of memory. */
+struct ohash_elem *
+ohash_insert (struct ohash *h, struct ohash_elem *new) 
+{
+  struct ohash_slot s;
+  size_t idx;
+
+  idx = find_slot (h, new->key);
+  if (idx != SIZE_MAX)
+    return h->slots[idx].elem;
+
+  /* Grow at three quarters full.  If memory is short, a fuller
+     table still works, only more slowly, down to the one empty
+     slot that lookups need to stop at. */
+  if ((h->elem_cnt + 1) * 4 > h->slot_cnt * 3
+      && !resize (h, h->slot_cnt * 2)
+      && h->elem_cnt + 1 >= h->slot_cnt)
+    PANIC ("open hash table full and out of memory");
+
+  s.key = new->key;
+  s.elem = new;
+  place (h, s);
+  h->elem_cnt++;
+  return NULL;
+}
+
+/* Finds and returns the element with the given KEY in H, or a
+   null pointer if there is none. */
+struct ohash_elem *
+ohash_find (struct ohash *h, uint32_t key) 
+{
+  size_t idx = find_slot (h, key);
+  return idx != SIZE_MAX ? h->slots[idx].elem : NULL;
+}
+
+/* Finds, removes, and returns the element with the given KEY in
+   H.  Returns a null pointer if there was none. */
+struct ohash_elem *
+ohash_delete (struct ohash *h, uint32_t key) 
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t idx = find_slot (h, key);
+  struct ohash_elem *found;
+
+  if (idx == SIZE_MAX)
+    return NULL;
+  found = h->slots[idx].elem;
+
+  /* Shift back each following element that is not in its home
+     slot, up to the next empty slot. */
+  for (;;) 
+    {
+      size_t next = (idx + 1) & mask;
+      struct ohash_slot *s = &h->slots[next];
+
+      if (s->elem == NULL || probe_distance (h, next, s->key) == 0)
+        break;
+      h->slots[idx] = *s;
+      idx = next;
+    }
+  h->slots[idx].elem = NULL;
+  h->elem_cnt--;
+  return found;
+}
+
+/* Initializes I for iterating open hash table H, with the same
+   idiom as hash_first().  Modifying H during iteration, using
+   any of the functions ohash_clear(), ohash_destroy(),
+   ohash_insert(), or ohash_delete(), invalidates all
+   iterators. */
+void
+ohash_first (struct ohash_iterator *i, struct ohash *h) 
+{
+  ASSERT (i != NULL);
+  ASSERT (h != NULL);
+
+  i->hash = h;
+  i->idx = SIZE_MAX;
+  i->elem = NULL;
+}
+
+/* Advances I to the next element in the table and returns it.
+   Returns a null pointer if no elements are left.  Elements are
+   returned in arbitrary order. */
+struct ohash_elem *
+ohash_next (struct ohash_iterator *i) 
+{
+  ASSERT (i != NULL);
+
+  i->elem = NULL;
+  while (++i->idx < i->hash->slot_cnt)
+    if (i->hash->slots[i->idx].elem != NULL) 
+      {
+        i->elem = i->hash->slots[i->idx].elem;
+        break;
+      }
+  if (i->elem == NULL)
+    i->idx = i->hash->slot_cnt;
+  return i->elem;
+}
+
+/* Returns the current element in the iteration, or a null
+   pointer at the end of the table.  Undefined behavior after
+   calling ohash_first() but before ohash_next(). */
+struct ohash_elem *
+ohash_cur (struct ohash_iterator *i) 
+{
+  return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+ohash_size (struct ohash *h) 
+{
+  return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+ohash_empty (struct ohash *h) 
+{
+  return h->elem_cnt == 0;
+}
+
+/* Puts slot S, whose key is not yet in H, into H, where there
+   must be an empty slot. */
+static void
+place (struct ohash *h, struct ohash_slot s) 
+{
+  size_t mask = h->slot_cnt - 1;
+  size_t idx = home_slot (h, s.key);
+  size_t dist;
+
+  for (dist = 0; ; dist++, idx = (idx + 1) & mask) 
+    {
+      struct ohash_slot *cur = &h->slots[idx];
+      size_t cur_dist;
+
+      if (cur->elem == NULL) 
+        {
+          *cur = s;
+          return;
+        }
+
+      /* Take the place of an element closer to its home, and
+         carry it on instead. */
+      cur_dist = probe_distance (h, idx, cur->key);
+      if (cur_dist < dist) 
+        {
+          struct ohash_slot tmp = *cur;
+          *cur = s;
+          s = tmp;
+          dist = cur_dist;
+        }
+    }
+}
+
+/* Changes the number of slots in H to SLOT_CNT, a power of 2
+   large enough for all of H's elements, moving every element.
+   Returns true if successful, false if memory allocation failed,
+   in which case H is unchanged. */
+static bool
+resize (struct ohash *h, size_t slot_cnt) 
+{
+  struct ohash_slot *old_slots = h->slots;
+  size_t old_slot_cnt = h->slot_cnt;
+  size_t i;
+
+  ASSERT (slot_cnt > h->elem_cnt);
+  ASSERT ((slot_cnt & (slot_cnt - 1)) == 0);
+
+  h->slots = malloc (sizeof *h->slots * slot_cnt);
+  if (h->slots == NULL) 
+    {
+      h->slots = old_slots;
+      return false;
+    }
+  for (i = 0; i < slot_cnt; i++)
+    h->slots[i].elem = NULL;
+  h->slot_cnt = slot_cnt;
+  for (h->shift = 32; slot_cnt > 1; slot_cnt >>= 1)
+    h->shift--;
+
+  for (i = 0; i < old_slot_cnt; i++)
+    if (old_slots[i].elem != NULL)
+      place (h, old_slots[i]);
+  free (old_slots);
+  return true;
+}
@@ -0,0 +1,99 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressed hash table with integer keys.
+
+   This is an alternative to struct hash (see hash.h) for tables
+   that are looked up by a 32-bit integer, such as a sector
+   number, on hot paths.  Like struct hash, it does no
+   allocation per element: each structure that can be in an
+   ohash embeds a struct ohash_elem, which holds its key, and
+   ohash_entry converts a struct ohash_elem back to the
+   structure that contains it.
+
+   Unlike struct hash, the table is a single array of slots,
+   each holding a copy of its element's key next to a pointer to
+   the element.  A lookup compares keys inside the array and
+   follows a pointer only to return the element it found, so it
+   touches one or two cache lines instead of a chain of list
+   elements scattered through memory, and it needs no hash or
+   comparison callbacks.
+
+   Collisions are resolved by linear probing with "Robin Hood"
+   ordering: an element being inserted takes the place of any
+   element it passes that is closer to its own home slot, which
+   then moves on in its place.  This keeps probe sequences short
+   and lets an unsuccessful lookup stop as soon as it reaches an
+   element closer to home than the key it wants would be.
+   Deletion shifts the elements that follow back by one slot, so
+   the table never fills with deleted-slot markers.
+
+   The table doubles in size, all at once, when it is three
+   quarters full.  It never shrinks, except that ohash_clear()
+   empties it. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Open hash element. */
+struct ohash_elem 
+  {
+    uint32_t key;               /* Set before inserting; then fixed. */
+  };
+
+/* Converts pointer to open hash element OHASH_ELEM into a
+   pointer to the structure that OHASH_ELEM is embedded inside.
+   Supply the name of the outer structure STRUCT and the member
+   name MEMBER of the open hash element. */
+#define ohash_entry(OHASH_ELEM, STRUCT, MEMBER)                 \
+        ((STRUCT *) ((uint8_t *) &(OHASH_ELEM)->key             \
+                     - offsetof (STRUCT, MEMBER.key)))
+
+/* Performs some operation on open hash element E. */
+typedef void ohash_action_func (struct ohash_elem *e);
+
+/* A slot in an open hash table. */
+struct ohash_slot 
+  {
+    uint32_t key;               /* Copy of elem->key. */
+    struct ohash_elem *elem;    /* Element, or null if empty. */
+  };
+
+/* Open hash table. */
+struct ohash 
+  {
+    size_t elem_cnt;            /* Number of elements in table. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    unsigned shift;             /* 32 - log2 (slot_cnt). */
+    struct ohash_slot *slots;   /* Array of `slot_cnt' slots. */
+  };
+
+/* An open hash table iterator. */
+struct ohash_iterator 
+  {
+    struct ohash *hash;         /* The open hash table. */
+    size_t idx;                 /* Index of current slot. */
+    struct ohash_elem *elem;    /* Current element. */
+  };
+
+/* Basic life cycle. */
+bool ohash_init (struct ohash *);
+void ohash_clear (struct ohash *, ohash_action_func *);
+void ohash_destroy (struct ohash *, ohash_action_func *);
+
+/* Search, insertion, deletion. */
+struct ohash_elem *ohash_insert (struct ohash *, struct ohash_elem *);
+struct ohash_elem *ohash_find (struct ohash *, uint32_t key);
+struct ohash_elem *ohash_delete (struct ohash *, uint32_t key);
+
+/* Iteration. */
+void ohash_first (struct ohash_iterator *, struct ohash *);
+struct ohash_elem *ohash_next (struct ohash_iterator *);
+struct ohash_elem *ohash_cur (struct ohash_iterator *);
+
+/* Information. */
+size_t ohash_size (struct ohash *);
+bool ohash_empty (struct ohash *);
+
+#endif /* lib/kernel/ohash.h */
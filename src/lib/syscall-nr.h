@@ -28,7 +28,32 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Performance measurement. */
+    SYS_TICKS,                  /* Timer ticks since boot. */
+    SYS_BLOCKSTAT,              /* Block device I/O counters. */
+    SYS_TIME_NS,                /* Nanoseconds since boot. */
+    SYS_CACHESTAT,              /* Buffer cache counters. */
+
+    /* User heap. */
+    SYS_SBRK,                   /* Move the program break. */
+
+    /* Pipes. */
+    SYS_PIPE,                   /* Create a pipe. */
+    SYS_DUP,                    /* Duplicate a file descriptor. */
+    SYS_DUP2,                   /* Duplicate onto stdin or stdout. */
+
+    /* Shared memory. */
+    SYS_SHM_OPEN,               /* Open a shared memory segment. */
+    SYS_SHM_MAP,                /* Map a segment into memory. */
+    SYS_SHM_UNMAP,              /* Unmap and close a segment. */
+
+    /* User threads. */
+    SYS_THREAD_CREATE,          /* Start a thread in this process. */
+    SYS_THREAD_EXIT,            /* Terminate this thread. */
+    SYS_THREAD_JOIN,            /* Wait for a thread to exit. */
+    SYS_THREAD_YIELD            /* Let another thread run. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Streams returned by fopen().  Each has its own BUFSIZ-byte
+   buffer.  These live apart from stdio.c so that programs that
+   never open a stream don't carry the buffers. */
+static FILE streams[FOPEN_MAX];
+static char buffers[FOPEN_MAX][BUFSIZ];
+
+/* Held while claiming a free entry in streams[]. */
+static struct spinlock streams_lock = SPINLOCK_INITIALIZER;
+
+/* Opens file NAME and returns a fully buffered stream for it, or
+   a null pointer on failure.  MODE is "r" to read, "w" to write
+   a new, empty file, or "a" to append to a file, creating it if
+   necessary, optionally followed by "+" to allow both reading
+   and writing. */
+FILE *
+fopen (const char *name, const char *mode)
+{
+  FILE *stream = NULL;
+  int flags;
+  int fd;
+  int i;
+
+  switch (mode[0])
+    {
+    case 'r':
+      flags = __STREAM_READ;
+      break;
+    case 'w':
+    case 'a':
+      flags = __STREAM_WRITE;
+      break;
+    default:
+      return NULL;
+    }
+  if (strchr (mode, '+') != NULL)
+    flags |= __STREAM_READ | __STREAM_WRITE;
+
+  /* A stream with a buffer is taken. */
+  spinlock_acquire (&streams_lock);
+  for (i = 0; i < FOPEN_MAX; i++)
+    if (streams[i].buf == NULL)
+      {
+        stream = &streams[i];
+        stream->buf = buffers[i];
+        break;
+      }
+  spinlock_release (&streams_lock);
+  if (stream == NULL)
+    return NULL;
+
+  /* Pintos files cannot be truncated, so "w" replaces the file. */
+  if (mode[0] == 'w')
+    remove (name);
+  if (mode[0] != 'r')
+    create (name, 0);
+  fd = open (name);
+  if (fd < 0)
+    {
+      stream->buf = NULL;
+      return NULL;
+    }
+  if (mode[0] == 'a')
+    seek (fd, filesize (fd));
+
+  stream->fd = fd;
+  stream->flags = flags;
+  stream->mode = _IOFBF;
+  stream->size = BUFSIZ;
+  stream->pos = stream->len = 0;
+  spinlock_init (&stream->lock);
+  __stream_link (stream);
+  return stream;
+}
+
+/* Flushes and closes STREAM.
+   Returns 0 if successful, EOF if flushing failed. */
+int
+fclose (FILE *stream)
+{
+  int retval = fflush (stream);
+
+  close (stream->fd);
+  __stream_unlink (stream);
+  stream->buf = NULL;
+  return retval;
+}
@@ -0,0 +1,300 @@
+#include <stdlib.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <spinlock.h>
+#include <syscall.h>
+
+/* User-space malloc().
+
+   Memory comes from the heap that sbrk() extends.  The kernel
+   maps a heap page only when it is first touched, so growing the
+   heap is cheap and untouched memory costs nothing.
+
+   Small requests are rounded up to a power of 2 between 16 bytes
+   and 1 kB, a "size class".  Each class keeps a free list of
+   blocks of that size.  Blocks come from one-page "arenas"; an
+   arena is handed out a block at a time, rather than being
+   divided up front, so that its pages are touched only as they
+   are used.  The arena header at the start of each page records
+   the class, so that free() needs no per-block header.
+
+   Larger requests get a run of whole pages with an arena header
+   that records the page count.  Freed runs go on a list and are
+   reused by later large requests that fit; a run at the top of
+   the heap is given back with sbrk() instead.
+
+   A process may have several threads (see uthread_create()), so
+   malloc() and free() hold a spinlock throughout.  Neither makes
+   more than a couple of system calls. */
+
+#define PAGE_SIZE 4096
+
+/* Size classes: 16, 32, ..., 1024 bytes. */
+#define MIN_SHIFT 4
+#define CLASS_CNT 7
+
+/* Magic number for detecting arena corruption. */
+#define ARENA_MAGIC 0x3c0ffe1d
+
+/* Arena. */
+struct arena
+  {
+    unsigned magic;             /* Always set to ARENA_MAGIC. */
+    int class;                  /* Size class, or -1 for a big block. */
+    size_t page_cnt;            /* Pages in a big block. */
+    struct arena *next;         /* Next free big block. */
+  };
+
+/* Free block. */
+struct block
+  {
+    struct block *next;         /* Next free block of the same class. */
+  };
+
+/* Size class. */
+struct class
+  {
+    struct block *free_list;    /* Free blocks. */
+    uint8_t *next;              /* Next never-used block in newest arena. */
+    uint8_t *end;               /* End of newest arena. */
+  };
+
+static struct class classes[CLASS_CNT];
+static struct arena *free_big;  /* Free big blocks. */
+static struct spinlock malloc_lock = SPINLOCK_INITIALIZER;
+
+/* Returns the size class for SIZE, which must be at most the
+   largest class size. */
+static inline int
+size_to_class (size_t size)
+{
+  int class = 0;
+
+  size = (size - 1) >> MIN_SHIFT;
+  while (size != 0)
+    {
+      size >>= 1;
+      class++;
+    }
+  return class;
+}
+
+/* Returns the size of blocks in CLASS. */
+static inline size_t
+class_size (int class)
+{
+  return (size_t) 1 << (MIN_SHIFT + class);
+}
+
+/* Obtains PAGE_CNT pages from the end of the heap, page-aligning
+   the break first if necessary.  Returns a null pointer if the
+   heap cannot grow. */
+static void *
+get_pages (size_t page_cnt)
+{
+  uint8_t *cur = sbrk (0);
+  size_t pad = ROUND_UP ((uintptr_t) cur, PAGE_SIZE) - (uintptr_t) cur;
+
+  if (sbrk (pad + page_cnt * PAGE_SIZE) == (void *) -1)
+    return NULL;
+  return cur + pad;
+}
+
+/* Returns the arena that block P is inside. */
+static struct arena *
+block_to_arena (void *p)
+{
+  struct arena *a = (struct arena *) ((uintptr_t) p & ~(PAGE_SIZE - 1));
+
+  ASSERT (a->magic == ARENA_MAGIC);
+  ASSERT (a->class < 0
+          || ((uintptr_t) p & (class_size (a->class) - 1)) == 0);
+  ASSERT (a->class >= 0 || (uint8_t *) p == (uint8_t *) (a + 1));
+  return a;
+}
+
+/* Allocates a big block of at least SIZE bytes. */
+static void *
+malloc_big (size_t size)
+{
+  size_t page_cnt = DIV_ROUND_UP (size + sizeof (struct arena), PAGE_SIZE);
+  struct arena **ap, *a;
+
+  /* Reuse a freed run if one is large enough. */
+  for (ap = &free_big; *ap != NULL; ap = &(*ap)->next)
+    if ((*ap)->page_cnt >= page_cnt)
+      {
+        a = *ap;
+        *ap = a->next;
+        return a + 1;
+      }
+
+  a = get_pages (page_cnt);
+  if (a == NULL)
+    return NULL;
+  a->magic = ARENA_MAGIC;
+  a->class = -1;
+  a->page_cnt = page_cnt;
+  return a + 1;
+}
+
+/* Allocates a block of at least SIZE bytes, which must be
+   nonzero.  Must be called with malloc_lock held. */
+static void *
+malloc_locked (size_t size)
+{
+  struct class *c;
+  struct block *b;
+  int class;
+
+  if (size > class_size (CLASS_CNT - 1))
+    return malloc_big (size);
+
+  /* Fast path: pop the class's free list. */
+  class = size_to_class (size);
+  c = &classes[class];
+  b = c->free_list;
+  if (b != NULL)
+    {
+      c->free_list = b->next;
+      return b;
+    }
+
+  /* Carve the next block from the newest arena, starting a new
+     arena if it is used up. */
+  if (c->next == NULL || c->next + class_size (class) > c->end)
+    {
+      struct arena *a = get_pages (1);
+      if (a == NULL)
+        return NULL;
+      a->magic = ARENA_MAGIC;
+      a->class = class;
+      a->page_cnt = 1;
+
+      /* The first block follows the header, aligned to the class
+         size so that block_to_arena() can check alignment. */
+      c->next = (uint8_t *) a + ROUND_UP (sizeof *a, class_size (class));
+      c->end = (uint8_t *) a + PAGE_SIZE;
+    }
+  b = (struct block *) c->next;
+  c->next += class_size (class);
+  return b;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size)
+{
+  void *p;
+
+  /* A null pointer satisfies a request for 0 bytes. */
+  if (size == 0)
+    return NULL;
+
+  spinlock_acquire (&malloc_lock);
+  p = malloc_locked (size);
+  spinlock_release (&malloc_lock);
+  return p;
+}
+
+/* Allocates and return A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b)
+{
+  void *p;
+  size_t size;
+
+  /* Calculate block size and make sure it fits in size_t. */
+  size = a * b;
+  if (a != 0 && size / a != b)
+    return NULL;
+
+  /* Allocate and zero memory. */
+  p = malloc (size);
+  if (p != NULL)
+    memset (p, 0, size);
+
+  return p;
+}
+
+/* Returns the number of bytes allocated for block P. */
+static size_t
+block_size (void *p)
+{
+  struct arena *a = block_to_arena (p);
+
+  return (a->class >= 0
+          ? class_size (a->class)
+          : a->page_cnt * PAGE_SIZE - sizeof *a);
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.
+   If successful, returns the new block; on failure, returns a
+   null pointer.
+   A call with null OLD_BLOCK is equivalent to malloc(NEW_SIZE).
+   A call with zero NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size)
+{
+  void *new_block;
+  size_t old_size;
+
+  if (new_size == 0)
+    {
+      free (old_block);
+      return NULL;
+    }
+  if (old_block == NULL)
+    return malloc (new_size);
+
+  /* Shrinking, or growing within the block's slack, is free. */
+  old_size = block_size (old_block);
+  if (new_size <= old_size)
+    return old_block;
+
+  new_block = malloc (new_size);
+  if (new_block != NULL)
+    {
+      memcpy (new_block, old_block, old_size);
+      free (old_block);
+    }
+  return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p)
+{
+  struct arena *a;
+
+  if (p == NULL)
+    return;
+
+  a = block_to_arena (p);
+  spinlock_acquire (&malloc_lock);
+  if (a->class >= 0)
+    {
+      struct block *b = p;
+      struct class *c = &classes[a->class];
+
+      b->next = c->free_list;
+      c->free_list = b;
+    }
+  else if ((uint8_t *) a + a->page_cnt * PAGE_SIZE == sbrk (0))
+    {
+      /* Give the top of the heap back. */
+      sbrk (-(intptr_t) (a->page_cnt * PAGE_SIZE));
+    }
+  else
+    {
+      a->next = free_big;
+      free_big = a;
+    }
+  spinlock_release (&malloc_lock);
+}
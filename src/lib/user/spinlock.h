@@ -0,0 +1,72 @@
+#ifndef __LIB_USER_SPINLOCK_H
+#define __LIB_USER_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <syscall.h>
+
+/* Spinlocks for the threads of a user process.
+
+   There is no system call to sleep on a lock, so a thread that
+   finds one held spins for a while, in case the holder is running
+   on another CPU and about to let go, and then yields the CPU, in
+   case the holder was preempted and needs it to finish.  Use them
+   only around short stretches of code. */
+struct spinlock
+  {
+    volatile uint32_t locked;   /* 1 if held, 0 if free. */
+  };
+
+/* Times spinlock_acquire() polls a held lock before yielding. */
+#define SPINLOCK_SPIN_CNT 1000
+
+/* Initializer for a free spinlock. */
+#define SPINLOCK_INITIALIZER { 0 }
+
+/* Initializes LOCK as free. */
+static inline void
+spinlock_init (struct spinlock *lock)
+{
+  lock->locked = 0;
+}
+
+/* Tries to acquire LOCK without waiting.  Returns true if
+   successful.  The locked exchange is a full memory barrier. */
+static inline bool
+spinlock_try_acquire (struct spinlock *lock)
+{
+  uint32_t old = 1;
+
+  asm volatile ("xchgl %0, %1"
+                : "+r" (old), "+m" (lock->locked) : : "memory");
+  return old == 0;
+}
+
+/* Acquires LOCK, waiting as long as necessary. */
+static inline void
+spinlock_acquire (struct spinlock *lock)
+{
+  while (!spinlock_try_acquire (lock))
+    {
+      unsigned spin_cnt = 0;
+
+      while (lock->locked)
+        if (++spin_cnt < SPINLOCK_SPIN_CNT)
+          asm volatile ("pause");
+        else
+          {
+            uthread_yield ();
+            spin_cnt = 0;
+          }
+    }
+}
+
+/* Releases LOCK, which the caller must hold. */
+static inline void
+spinlock_release (struct spinlock *lock)
+{
+  asm volatile ("" : : : "memory");
+  lock->locked = 0;
+}
+
+#endif /* lib/user/spinlock.h */
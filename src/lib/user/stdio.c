@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Buffered streams.
+
+   Output to a stream collects in its buffer and is passed to
+   write() when the buffer fills, or, for line-buffered streams
+   such as the console, after each new-line.  Input is read a
+   buffer at a time.
+
+   The kernel's read() on the keyboard does not return until it
+   has as many bytes as asked for, so stdin reads one byte at a
+   time; it flushes stdout first so that a prompt appears before
+   the program waits for input.
+
+   Each public function below holds the stream's lock, and calls
+   only the static stream_*() functions, which do not lock, so
+   that fprintf() and fgets() are atomic.  A thread holding
+   stdin's lock may also take stdout's, and fflush (NULL) takes
+   each stream's lock while holding all_streams_lock, so no other
+   order is allowed. */
+
+static char stdout_buf[BUFSIZ];
+static char stdin_buf[1];
+
+static FILE stdout_stream =
+  {STDOUT_FILENO, __STREAM_WRITE, _IOLBF,
+   stdout_buf, sizeof stdout_buf, 0, 0, NULL, SPINLOCK_INITIALIZER};
+static FILE stdin_stream =
+  {STDIN_FILENO, __STREAM_READ, _IONBF,
+   stdin_buf, sizeof stdin_buf, 0, 0, &stdout_stream, SPINLOCK_INITIALIZER};
+
+FILE *stdin = &stdin_stream;
+FILE *stdout = &stdout_stream;
+
+/* All streams, for fflush (NULL). */
+static FILE *all_streams = &stdin_stream;
+static struct spinlock all_streams_lock = SPINLOCK_INITIALIZER;
+
+/* Adds STREAM to the list of all streams. */
+void
+__stream_link (FILE *stream)
+{
+  spinlock_acquire (&all_streams_lock);
+  stream->next = all_streams;
+  all_streams = stream;
+  spinlock_release (&all_streams_lock);
+}
+
+/* Removes STREAM from the list of all streams. */
+void
+__stream_unlink (FILE *stream)
+{
+  FILE **sp;
+
+  spinlock_acquire (&all_streams_lock);
+  for (sp = &all_streams; *sp != NULL; sp = &(*sp)->next)
+    if (*sp == stream)
+      {
+        *sp = stream->next;
+        break;
+      }
+  spinlock_release (&all_streams_lock);
+}
+
+/* Passes the data buffered for writing in STREAM to write().
+   Returns 0 if successful, EOF on error. */
+static int
+flush_output (FILE *stream)
+{
+  size_t ofs = 0;
+
+  while (ofs < stream->len)
+    {
+      int n = write (stream->fd, stream->buf + ofs, stream->len - ofs);
+      if (n <= 0)
+        {
+          /* Keep what could not be written. */
+          memmove (stream->buf, stream->buf + ofs, stream->len - ofs);
+          stream->len -= ofs;
+          stream->flags |= __STREAM_ERROR;
+          return EOF;
+        }
+      ofs += n;
+    }
+  stream->len = 0;
+  stream->flags &= ~__STREAM_WRITING;
+  return 0;
+}
+
+/* Discards read-ahead data in STREAM, moving the file position
+   back to the first byte the caller has not read. */
+static void
+drop_input (FILE *stream)
+{
+  if (stream->pos < stream->len)
+    seek (stream->fd, tell (stream->fd) - (stream->len - stream->pos));
+  stream->pos = stream->len = 0;
+  stream->flags &= ~__STREAM_READING;
+}
+
+/* Flushes STREAM: written data is passed to write(), read-ahead
+   data is discarded.  Returns 0 if successful, EOF on error. */
+static int
+stream_flush (FILE *stream)
+{
+  int retval = 0;
+
+  if (stream->flags & __STREAM_WRITING)
+    retval = flush_output (stream);
+  else if (stream->flags & __STREAM_READING)
+    drop_input (stream);
+  return retval;
+}
+
+/* Flushes STREAM, or all streams if STREAM is a null pointer.
+   Written data is passed to write(); read-ahead data is
+   discarded.  Returns 0 if successful, EOF on error. */
+int
+fflush (FILE *stream)
+{
+  int retval = 0;
+
+  if (stream == NULL)
+    {
+      spinlock_acquire (&all_streams_lock);
+      for (stream = all_streams; stream != NULL; stream = stream->next)
+        if (fflush (stream) == EOF)
+          retval = EOF;
+      spinlock_release (&all_streams_lock);
+      return retval;
+    }
+
+  spinlock_acquire (&stream->lock);
+  retval = stream_flush (stream);
+  spinlock_release (&stream->lock);
+  return retval;
+}
+
+/* Makes STREAM use the SIZE bytes at BUF as its buffer, in the
+   given buffering MODE.  If BUF is a null pointer, keeps the
+   current buffer.  Must be called before any I/O on STREAM.
+   Returns 0 if successful, nonzero otherwise. */
+int
+setvbuf (FILE *stream, char *buf, int mode, size_t size)
+{
+  int retval = EOF;
+
+  if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF)
+    return EOF;
+  spinlock_acquire (&stream->lock);
+  if (stream_flush (stream) != EOF)
+    {
+      if (buf != NULL && size > 0)
+        {
+          stream->buf = buf;
+          stream->size = size;
+        }
+      stream->mode = mode;
+      retval = 0;
+    }
+  spinlock_release (&stream->lock);
+  return retval;
+}
+
+/* Refills STREAM's buffer.  Returns true if it holds at least one
+   byte afterward. */
+static bool
+fill_input (FILE *stream)
+{
+  int n;
+
+  if (!(stream->flags & __STREAM_READ))
+    {
+      stream->flags |= __STREAM_ERROR;
+      return false;
+    }
+  if (stream->flags & __STREAM_WRITING)
+    flush_output (stream);
+  if (stream == stdin)
+    fflush (stdout);
+
+  n = read (stream->fd, stream->buf,
+            stream->mode == _IONBF ? 1 : stream->size);
+  stream->pos = 0;
+  stream->len = n > 0 ? n : 0;
+  if (n <= 0)
+    {
+      stream->flags &= ~__STREAM_READING;
+      stream->flags |= n == 0 ? __STREAM_EOF : __STREAM_ERROR;
+      return false;
+    }
+  stream->flags |= __STREAM_READING;
+  return true;
+}
+
+/* Reads up to CNT elements of SIZE bytes each from STREAM into
+   BUFFER.  Returns the number of whole elements read. */
+static size_t
+stream_read (void *buffer, size_t size, size_t cnt, FILE *stream)
+{
+  char *dst = buffer;
+  size_t total = size * cnt;
+  size_t done = 0;
+
+  if (total == 0)
+    return 0;
+
+  while (done < total)
+    {
+      size_t avail = (stream->flags & __STREAM_READING
+                      ? stream->len - stream->pos : 0);
+
+      if (avail == 0)
+        {
+          /* Large reads from a file skip the buffer. */
+          if (total - done >= stream->size && stream != stdin
+              && (stream->flags & __STREAM_READ))
+            {
+              int n;
+
+              if (stream->flags & __STREAM_WRITING)
+                flush_output (stream);
+              n = read (stream->fd, dst + done, total - done);
+              if (n <= 0)
+                {
+                  stream->flags |= n == 0 ? __STREAM_EOF : __STREAM_ERROR;
+                  break;
+                }
+              done += n;
+              continue;
+            }
+          if (!fill_input (stream))
+            break;
+          avail = stream->len;
+        }
+
+      if (avail > total - done)
+        avail = total - done;
+      memcpy (dst + done, stream->buf + stream->pos, avail);
+      stream->pos += avail;
+      done += avail;
+    }
+  return done / size;
+}
+
+/* Writes CNT elements of SIZE bytes each from BUFFER to STREAM.
+   Returns the number of whole elements written. */
+static size_t
+stream_write (const void *buffer, size_t size, size_t cnt, FILE *stream)
+{
+  const char *src = buffer;
+  size_t total = size * cnt;
+  size_t done = 0;
+
+  if (total == 0)
+    return 0;
+  if (!(stream->flags & __STREAM_WRITE))
+    {
+      stream->flags |= __STREAM_ERROR;
+      return 0;
+    }
+  if (stream->flags & __STREAM_READING)
+    drop_input (stream);
+
+  /* Writes that would not fit in an empty buffer go straight
+     through, after whatever is already buffered. */
+  if (stream->mode == _IONBF || total >= stream->size)
+    {
+      if (flush_output (stream) == EOF)
+        return 0;
+      while (done < total)
+        {
+          int n = write (stream->fd, src + done, total - done);
+          if (n <= 0)
+            {
+              stream->flags |= __STREAM_ERROR;
+              break;
+            }
+          done += n;
+        }
+      return done / size;
+    }
+
+  while (done < total)
+    {
+      size_t room = stream->size - stream->len;
+      if (room > total - done)
+        room = total - done;
+      memcpy (stream->buf + stream->len, src + done, room);
+      stream->len += room;
+      stream->flags |= __STREAM_WRITING;
+      done += room;
+      if (stream->len == stream->size && flush_output (stream) == EOF)
+        return done / size;
+    }
+
+  /* An error here leaves the data buffered and is reported by
+     ferror(). */
+  if (stream->mode == _IOLBF && memchr (src, '\n', total) != NULL)
+    flush_output (stream);
+  return cnt;
+}
+
+size_t
+fread (void *buffer, size_t size, size_t cnt, FILE *stream)
+{
+  size_t retval;
+
+  spinlock_acquire (&stream->lock);
+  retval = stream_read (buffer, size, cnt, stream);
+  spinlock_release (&stream->lock);
+  return retval;
+}
+
+size_t
+fwrite (const void *buffer, size_t size, size_t cnt, FILE *stream)
+{
+  size_t retval;
+
+  spinlock_acquire (&stream->lock);
+  retval = stream_write (buffer, size, cnt, stream);
+  spinlock_release (&stream->lock);
+  return retval;
+}
+
+/* Reads and returns one byte from STREAM as an unsigned char,
+   or EOF at end of file or on error. */
+static int
+stream_getc (FILE *stream)
+{
+  if ((!(stream->flags & __STREAM_READING) || stream->pos >= stream->len)
+      && !fill_input (stream))
+    return EOF;
+  return (unsigned char) stream->buf[stream->pos++];
+}
+
+/* Writes C, converted to unsigned char, to STREAM.
+   Returns C, or EOF on error. */
+static int
+stream_putc (int c, FILE *stream)
+{
+  unsigned char ch = c;
+
+  if (!(stream->flags & __STREAM_WRITING) || stream->mode == _IONBF
+      || stream->len + 1 >= stream->size || ch == '\n')
+    return stream_write (&ch, 1, 1, stream) == 1 ? ch : EOF;
+
+  /* Fast path: append to a buffer that has room. */
+  stream->buf[stream->len++] = ch;
+  return ch;
+}
+
+int
+fgetc (FILE *stream)
+{
+  int c;
+
+  spinlock_acquire (&stream->lock);
+  c = stream_getc (stream);
+  spinlock_release (&stream->lock);
+  return c;
+}
+
+int
+fputc (int c, FILE *stream)
+{
+  spinlock_acquire (&stream->lock);
+  c = stream_putc (c, stream);
+  spinlock_release (&stream->lock);
+  return c;
+}
+
+/* Reads a line from STREAM into S, which has room for SIZE
+   bytes.  Stops after a new-line, which is kept, after SIZE - 1
+   bytes, or at end of file.  Returns S, or a null pointer if
+   nothing was read. */
+char *
+fgets (char *s, int size, FILE *stream)
+{
+  int i = 0;
+
+  if (size <= 0)
+    return NULL;
+  spinlock_acquire (&stream->lock);
+  while (i < size - 1)
+    {
+      int c = stream_getc (stream);
+      if (c == EOF)
+        break;
+      s[i++] = c;
+      if (c == '\n')
+        break;
+    }
+  spinlock_release (&stream->lock);
+  s[i] = '\0';
+  return i > 0 ? s : NULL;
+}
+
+/* Writes string S to STREAM, without a trailing new-line.
+   Returns 0 if successful, EOF on error. */
+int
+fputs (const char *s, FILE *stream)
+{
+  size_t length = strlen (s);
+  return fwrite (s, 1, length, stream) == length ? 0 : EOF;
+}
+
+/* Returns nonzero if end of file has been seen on STREAM. */
+int
+feof (FILE *stream)
+{
+  return (stream->flags & __STREAM_EOF) != 0;
+}
+
+/* Returns nonzero if an I/O error has occurred on STREAM. */
+int
+ferror (FILE *stream)
+{
+  return (stream->flags & __STREAM_ERROR) != 0;
+}
+
+/* Returns the file descriptor underlying STREAM. */
+int
+fileno (FILE *stream)
+{
+  return stream->fd;
+}
+
+/* Auxiliary data for vfprintf_helper(). */
+struct vfprintf_aux
+  {
+    FILE *stream;       /* Output stream. */
+    int char_cnt;       /* Total characters written so far. */
+    bool new_line;      /* Was a new-line written? */
+  };
+
+/* Helper for vfprintf(). */
+static void
+vfprintf_helper (char c, void *aux_)
+{
+  struct vfprintf_aux *aux = aux_;
+
+  stream_putc (c, aux->stream);
+  aux->char_cnt++;
+  if (c == '\n')
+    aux->new_line = true;
+}
+
+/* Formats FORMAT with ARGS and writes the output to STREAM.
+   Returns the number of characters written.  A line-buffered
+   stream is flushed once at the end, not after every line. */
+int
+vfprintf (FILE *stream, const char *format, va_list args)
+{
+  struct vfprintf_aux aux;
+  int mode;
+
+  spinlock_acquire (&stream->lock);
+  mode = stream->mode;
+  aux.stream = stream;
+  aux.char_cnt = 0;
+  aux.new_line = false;
+  if (mode == _IOLBF)
+    stream->mode = _IOFBF;
+  __vprintf (format, args, vfprintf_helper, &aux);
+  stream->mode = mode;
+  if (mode == _IOLBF && aux.new_line)
+    stream_flush (stream);
+  spinlock_release (&stream->lock);
+  return aux.char_cnt;
+}
+
+/* Like printf(), but writes output to STREAM. */
+int
+fprintf (FILE *stream, const char *format, ...)
+{
+  va_list args;
+  int retval;
+
+  va_start (args, format);
+  retval = vfprintf (stream, format, args);
+  va_end (args);
+
+  return retval;
+}
@@ -1,7 +1,81 @@
 #ifndef __LIB_USER_STDIO_H
 #define __LIB_USER_STDIO_H
 
+#include <spinlock.h>
+
 int hprintf (int, const char *, ...) PRINTF_FORMAT (2, 3);
 int vhprintf (int, const char *, va_list) PRINTF_FORMAT (2, 0);
 
+/* Buffered streams. */
+
+/* Returned by character input functions at end of file. */
+#define EOF (-1)
+
+/* Size of a stream buffer, in bytes. */
+#define BUFSIZ 4096
+
+/* Number of streams fopen() can have open at once. */
+#define FOPEN_MAX 8
+
+/* Buffering modes for setvbuf(). */
+#define _IOFBF 0                /* Write when the buffer fills. */
+#define _IOLBF 1                /* Also write after each new-line. */
+#define _IONBF 2                /* Write immediately. */
+
+/* A buffered stream over a file descriptor.
+   A stream's buffer holds either data read ahead of the caller
+   or data written by the caller but not yet passed to write(),
+   never both.  Each call on a stream holds its lock, so that
+   threads do not mix up its buffer. */
+typedef struct FILE
+  {
+    int fd;                     /* File descriptor. */
+    int flags;                  /* __STREAM_* flags. */
+    int mode;                   /* _IOFBF, _IOLBF, or _IONBF. */
+    char *buf;                  /* Buffer. */
+    size_t size;                /* Buffer capacity in bytes. */
+    size_t pos;                 /* Read position within buf. */
+    size_t len;                 /* Bytes of data in buf. */
+    struct FILE *next;          /* Next stream in list of all streams. */
+    struct spinlock lock;       /* Held by a thread using the stream. */
+  }
+FILE;
+
+/* FILE flags. */
+#define __STREAM_READ    0x01   /* Opened for reading. */
+#define __STREAM_WRITE   0x02   /* Opened for writing. */
+#define __STREAM_READING 0x04   /* buf holds read-ahead data. */
+#define __STREAM_WRITING 0x08   /* buf holds unwritten data. */
+#define __STREAM_EOF     0x10   /* End of file seen. */
+#define __STREAM_ERROR   0x20   /* I/O error seen. */
+
+extern FILE *stdin;
+extern FILE *stdout;
+
+FILE *fopen (const char *, const char *mode);
+int fclose (FILE *);
+int fflush (FILE *);
+int setvbuf (FILE *, char *buf, int mode, size_t size);
+
+size_t fread (void *, size_t size, size_t cnt, FILE *);
+size_t fwrite (const void *, size_t size, size_t cnt, FILE *);
+int fgetc (FILE *);
+int fputc (int, FILE *);
+char *fgets (char *, int size, FILE *);
+int fputs (const char *, FILE *);
+int fprintf (FILE *, const char *, ...) PRINTF_FORMAT (2, 3);
+int vfprintf (FILE *, const char *, va_list) PRINTF_FORMAT (2, 0);
+
+int feof (FILE *);
+int ferror (FILE *);
+int fileno (FILE *);
+
+#define getc(STREAM) fgetc (STREAM)
+#define putc(C, STREAM) fputc (C, STREAM)
+#define getchar() fgetc (stdin)
+
+/* Internal functions. */
+void __stream_link (FILE *);
+void __stream_unlink (FILE *);
+
 #endif /* lib/user/stdio.h */
@@ -1,9 +1,20 @@
 #include <syscall.h>
+#include <stdio.h>
 #include "../syscall-nr.h"
 
+/* System calls enter the kernel through sysenter when the CPU
+   supports it, and through "int $0x30" otherwise.  The kernel
+   accepts both.
+
+   The int_syscallN() macros use "int $0x30", pushing NUMBER and
+   the arguments on the stack.  sysenter_syscall() passes them in
+   registers instead: NUMBER in %eax and the arguments in %ebx,
+   %esi, and %edi, with %ecx and %edx telling the kernel where to
+   return. */
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
-#define syscall0(NUMBER)                                        \
+#define int_syscall0(NUMBER)                                    \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
@@ -16,25 +27,25 @@
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
+#define int_syscall1(NUMBER, ARG0)                              \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
             ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0)                              \
+               : "memory");                                     \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
    returns the return value as an `int'. */
-#define syscall2(NUMBER, ARG0, ARG1)                            \
+#define int_syscall2(NUMBER, ARG0, ARG1)                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[arg1]; pushl %[arg1]; "                   \
+            ("pushl %[arg1]; pushl %[arg0]; "                   \
              "pushl %[number]; int $0x30; addl $12, %%esp"      \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
@@ -46,11 +57,11 @@
 
 /* Invokes syscall NUMBER, passing arguments ARG0, ARG1, and
    ARG2, and returns the return value as an `int'. */
-#define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
+#define int_syscall3(NUMBER, ARG0, ARG1, ARG2)                  \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[arg2]; pushl %[arg2]; pushl %[arg2]; "    \
+            ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
              "pushl %[number]; int $0x30; addl $16, %%esp"      \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
@@ -61,6 +72,58 @@
           retval;                                               \
         })
 
+/* Invokes syscall NUMBER through sysenter, passing arguments
+   ARG0, ARG1, and ARG2, and returns the return value as an
+   `int'. */
+#define sysenter_syscall(NUMBER, ARG0, ARG1, ARG2)              \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("movl %%esp, %%ecx; movl $1f, %%edx; sysenter; 1:" \
+               : "=a" (retval)                                  \
+               : "a" (NUMBER),                                  \
+                 "b" (ARG0),                                    \
+                 "S" (ARG1),                                    \
+                 "D" (ARG2)                                     \
+               : "ecx", "edx", "memory");                       \
+          retval;                                               \
+        })
+
+/* Returns true if system calls may use sysenter. */
+static inline bool
+use_sysenter (void)
+{
+  /* 1 if the CPU has sysenter, -1 if not, 0 if not yet known. */
+  static int has_sysenter;
+
+  if (has_sysenter == 0)
+    {
+      unsigned eax, ebx, ecx, edx;
+      asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+                   : "a" (1));
+      has_sysenter = edx & (1 << 11) ? 1 : -1;
+    }
+  return has_sysenter > 0;
+}
+
+#define syscall0(NUMBER)                                        \
+        (use_sysenter ()                                        \
+         ? sysenter_syscall (NUMBER, 0, 0, 0)                   \
+         : int_syscall0 (NUMBER))
+#define syscall1(NUMBER, ARG0)                                  \
+        (use_sysenter ()                                        \
+         ? sysenter_syscall (NUMBER, (int) (ARG0), 0, 0)        \
+         : int_syscall1 (NUMBER, ARG0))
+#define syscall2(NUMBER, ARG0, ARG1)                            \
+        (use_sysenter ()                                        \
+         ? sysenter_syscall (NUMBER, (int) (ARG0), (int) (ARG1), 0) \
+         : int_syscall2 (NUMBER, ARG0, ARG1))
+#define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
+        (use_sysenter ()                                        \
+         ? sysenter_syscall (NUMBER, (int) (ARG0), (int) (ARG1),  \
+                             (int) (ARG2))                      \
+         : int_syscall3 (NUMBER, ARG0, ARG1, ARG2))
+
 void
 halt (void) 
 {
@@ -71,6 +134,7 @@ halt (void)
 void
 exit (int status)
 {
+  fflush (NULL);
   syscall1 (SYS_EXIT, status);
   NOT_REACHED ();
 }
@@ -182,3 +246,112 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+int
+ticks (void)
+{
+  return syscall0 (SYS_TICKS);
+}
+
+bool
+blockstat (int role, struct blockstat *st)
+{
+  return syscall2 (SYS_BLOCKSTAT, role, st);
+}
+
+uint64_t
+time_ns (void)
+{
+  uint64_t ns;
+  syscall1 (SYS_TIME_NS, &ns);
+  return ns;
+}
+
+bool
+cachestat (struct cachestat *st)
+{
+  return syscall1 (SYS_CACHESTAT, st);
+}
+
+void *
+sbrk (intptr_t increment)
+{
+  return (void *) syscall1 (SYS_SBRK, increment);
+}
+
+int
+brk (void *addr)
+{
+  char *cur = sbrk (0);
+  return sbrk ((char *) addr - cur) != (void *) -1 ? 0 : -1;
+}
+
+int
+pipe (int fds[2])
+{
+  return syscall1 (SYS_PIPE, fds);
+}
+
+int
+dup (int fd)
+{
+  return syscall1 (SYS_DUP, fd);
+}
+
+int
+dup2 (int oldfd, int newfd)
+{
+  return syscall2 (SYS_DUP2, oldfd, newfd);
+}
+
+int
+shm_open (const char *name, unsigned size)
+{
+  return syscall2 (SYS_SHM_OPEN, name, size);
+}
+
+void *
+shm_map (int id)
+{
+  return (void *) syscall1 (SYS_SHM_MAP, id);
+}
+
+bool
+shm_unmap (void *addr)
+{
+  return syscall1 (SYS_SHM_UNMAP, addr);
+}
+
+/* Where a new thread begins in user mode, with FUNC and AUX on
+   its stack. */
+static void
+uthread_start (uthread_func *func, void *aux)
+{
+  func (aux);
+  uthread_exit ();
+}
+
+int
+uthread_create (uthread_func *func, void *aux)
+{
+  return syscall3 (SYS_THREAD_CREATE, uthread_start, func, aux);
+}
+
+void
+uthread_exit (void)
+{
+  syscall0 (SYS_THREAD_EXIT);
+  NOT_REACHED ();
+}
+
+int
+uthread_join (int tid)
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+uthread_yield (void)
+{
+  syscall0 (SYS_THREAD_YIELD);
+}
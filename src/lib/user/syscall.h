@@ -2,6 +2,7 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <debug.h>
 
 /* Process identifier. */
@@ -15,6 +16,49 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* Latency histogram buckets in struct blockstat_io.  Bucket 0
+   counts requests that took less than 1 us, bucket I > 0 those
+   that took 2**(I-1) us up to 2**I us, and the last bucket
+   everything slower. */
+#define BLOCKSTAT_BUCKETS 24
+
+/* Reads or writes of a block device, as reported by blockstat(). */
+struct blockstat_io
+  {
+    unsigned long long requests;        /* Requests completed. */
+    unsigned long long sectors;         /* Sectors transferred. */
+    unsigned long long sequential;      /* Requests that began where the
+                                           previous one ended. */
+    unsigned long long queue_ns;        /* Total time waiting. */
+    unsigned long long service_ns;      /* Total time being served. */
+    unsigned long long latency[BLOCKSTAT_BUCKETS]; /* Histogram. */
+  };
+
+/* Statistics of a block device, as reported by blockstat(). */
+struct blockstat
+  {
+    unsigned long long read_cnt;        /* Sectors read. */
+    unsigned long long write_cnt;       /* Sectors written. */
+    struct blockstat_io read;           /* Read requests. */
+    struct blockstat_io write;          /* Write requests. */
+  };
+
+/* Buffer cache counters, as reported by cachestat().  All but
+   entries and dirty count events since boot. */
+struct cachestat
+  {
+    unsigned long long hits;            /* Requests found in the cache. */
+    unsigned long long misses;          /* Requests that read the disk. */
+    unsigned long long evictions;       /* Entries reclaimed. */
+    unsigned long long dirty_evictions; /* ...that had to be written. */
+    unsigned long long writebacks;      /* Sectors written back. */
+    unsigned long long readaheads;      /* Sectors prefetched. */
+    unsigned long long readahead_hits;  /* ...later requested. */
+    unsigned long long readahead_wasted; /* ...evicted unrequested. */
+    unsigned entries;                   /* Size of the cache. */
+    unsigned dirty;                     /* Dirty entries now. */
+  };
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -45,4 +89,34 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Performance measurement. */
+int ticks (void);
+bool blockstat (int role, struct blockstat *);
+uint64_t time_ns (void);
+bool cachestat (struct cachestat *);
+
+/* User heap. */
+void *sbrk (intptr_t increment);
+int brk (void *addr);
+
+/* Pipes. */
+int pipe (int fds[2]);
+int dup (int fd);
+int dup2 (int oldfd, int newfd);
+
+/* Shared memory. */
+int shm_open (const char *name, unsigned size);
+void *shm_map (int id);
+bool shm_unmap (void *addr);
+
+/* User threads.  A thread runs FUNC (AUX) on a one-page stack of
+   its own, and exits when FUNC returns.  Threads share the rest
+   of the process; the user library's malloc() and stdio lock for
+   them. */
+typedef void uthread_func (void *aux);
+int uthread_create (uthread_func *, void *aux);
+void uthread_exit (void) NO_RETURN;
+int uthread_join (int tid);
+void uthread_yield (void);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,22 @@
+/* Runs after dedup-persist, in a second boot on the same disk.
+   Changing a sector of "b" must copy it, which only happens if
+   the sector's reference count survived the reboot, and writing
+   a third copy must find the existing sectors, which only
+   happens if the table's contents were reloaded. */
+
+#include <syscall.h>
+#include "tests/filesys/dedup/pattern.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pattern_change ("b", 99, 1);
+  pattern_check ("a", PATTERN_NONE, 0);
+  pattern_check ("b", 99, 1);
+  CHECK (remove ("b"), "remove \"b\"");
+  pattern_write ("c");
+  pattern_check ("a", PATTERN_NONE, 0);
+  pattern_check ("c", PATTERN_NONE, 0);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dedup-persist-check) begin
+(dedup-persist-check) open "b"
+(dedup-persist-check) changed sector 99 of "b"
+(dedup-persist-check) close "b"
+(dedup-persist-check) open "a" for verification
+(dedup-persist-check) verified contents of "a"
+(dedup-persist-check) open "b" for verification
+(dedup-persist-check) verified contents of "b"
+(dedup-persist-check) remove "b"
+(dedup-persist-check) create "c"
+(dedup-persist-check) open "c"
+(dedup-persist-check) wrote 2400 sectors to "c"
+(dedup-persist-check) close "c"
+(dedup-persist-check) open "a" for verification
+(dedup-persist-check) verified contents of "a"
+(dedup-persist-check) open "c" for verification
+(dedup-persist-check) verified contents of "c"
+(dedup-persist-check) end
+EOF
+pass;
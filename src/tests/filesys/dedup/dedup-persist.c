@@ -0,0 +1,14 @@
+/* Writes two files that share their data sectors.  The kernel is
+   then rebooted on the same disk to run dedup-persist-check. */
+
+#include <syscall.h>
+#include "tests/filesys/dedup/pattern.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pattern_write ("a");
+  pattern_write ("b");
+}
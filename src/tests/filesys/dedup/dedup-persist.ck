@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dedup-persist) begin
+(dedup-persist) create "a"
+(dedup-persist) open "a"
+(dedup-persist) wrote 2400 sectors to "a"
+(dedup-persist) close "a"
+(dedup-persist) create "b"
+(dedup-persist) open "b"
+(dedup-persist) wrote 2400 sectors to "b"
+(dedup-persist) close "b"
+(dedup-persist) end
+EOF
+pass;
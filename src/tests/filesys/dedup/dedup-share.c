@@ -0,0 +1,19 @@
+/* Writes the same contents to two files, which fit on the disk
+   only if they share their data sectors, then changes a sector
+   of the second file and verifies that the change is not seen
+   through the first. */
+
+#include <syscall.h>
+#include "tests/filesys/dedup/pattern.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pattern_write ("a");
+  pattern_write ("b");
+  pattern_change ("b", 1234, 1);
+  pattern_check ("a", PATTERN_NONE, 0);
+  pattern_check ("b", 1234, 1);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dedup-share) begin
+(dedup-share) create "a"
+(dedup-share) open "a"
+(dedup-share) wrote 2400 sectors to "a"
+(dedup-share) close "a"
+(dedup-share) create "b"
+(dedup-share) open "b"
+(dedup-share) wrote 2400 sectors to "b"
+(dedup-share) close "b"
+(dedup-share) open "b"
+(dedup-share) changed sector 1234 of "b"
+(dedup-share) close "b"
+(dedup-share) open "a" for verification
+(dedup-share) verified contents of "a"
+(dedup-share) open "b" for verification
+(dedup-share) verified contents of "b"
+(dedup-share) end
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Creates two files of zeros, which fit on the disk only if all
+   of their sectors share the zero sector, then writes one sector
+   of the first and verifies that the second still reads as
+   zeros. */
+
+#include <syscall.h>
+#include "tests/filesys/dedup/pattern.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  CHECK (create ("z1", PATTERN_SECTORS * 512), "create \"z1\"");
+  CHECK (create ("z2", PATTERN_SECTORS * 512), "create \"z2\"");
+  pattern_change ("z1", 17, 1);
+  zero_check ("z1", 17, 1);
+  zero_check ("z2", PATTERN_NONE, 0);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dedup-zero) begin
+(dedup-zero) create "z1"
+(dedup-zero) create "z2"
+(dedup-zero) open "z1"
+(dedup-zero) changed sector 17 of "z1"
+(dedup-zero) close "z1"
+(dedup-zero) open "z1" for verification
+(dedup-zero) verified contents of "z1"
+(dedup-zero) open "z2" for verification
+(dedup-zero) verified contents of "z2"
+(dedup-zero) end
+EOF
+pass;
@@ -0,0 +1,109 @@
+#include "tests/filesys/dedup/pattern.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+#define SECTOR 512
+
+static char expected[SECTOR];
+static char actual[SECTOR];
+
+/* Fills the SECTOR-byte BUF with the contents of sector SECTOR
+   of a pattern file written with SEED.  No two sectors of any
+   pattern file are alike, and none is all zeros. */
+void
+pattern_fill (void *buf_, size_t sector, unsigned seed)
+{
+  uint32_t *buf = buf_;
+  size_t i;
+
+  buf[0] = sector;
+  buf[1] = seed;
+  for (i = 2; i < SECTOR / sizeof *buf; i++)
+    buf[i] = (sector * 2654435761u) ^ (seed << 16) ^ i;
+}
+
+/* Creates NAME and writes PATTERN_SECTORS sectors of the seed 0
+   pattern to it. */
+void
+pattern_write (const char *name)
+{
+  size_t sector;
+  int fd;
+
+  CHECK (create (name, 0), "create \"%s\"", name);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  for (sector = 0; sector < PATTERN_SECTORS; sector++)
+    {
+      pattern_fill (expected, sector, 0);
+      if (write (fd, expected, SECTOR) != SECTOR)
+        fail ("write sector %zu of \"%s\"", sector, name);
+    }
+  msg ("wrote %d sectors to \"%s\"", PATTERN_SECTORS, name);
+  msg ("close \"%s\"", name);
+  close (fd);
+}
+
+/* Overwrites sector SECTOR of NAME with the SEED pattern. */
+void
+pattern_change (const char *name, size_t sector, unsigned seed)
+{
+  int fd;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  pattern_fill (expected, sector, seed);
+  seek (fd, sector * SECTOR);
+  if (write (fd, expected, SECTOR) != SECTOR)
+    fail ("write sector %zu of \"%s\"", sector, name);
+  msg ("changed sector %zu of \"%s\"", sector, name);
+  msg ("close \"%s\"", name);
+  close (fd);
+}
+
+/* Reads back NAME, which must hold PATTERN_SECTORS sectors: the
+   seed 0 pattern, or zeros if ZEROS is true, except for sector
+   CHANGED, which holds the SEED pattern. */
+static void
+verify (const char *name, size_t changed, unsigned seed, bool zeros)
+{
+  size_t sector;
+  int fd;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\" for verification", name);
+  if (filesize (fd) != PATTERN_SECTORS * SECTOR)
+    fail ("\"%s\" is %d bytes long", name, filesize (fd));
+  for (sector = 0; sector < PATTERN_SECTORS; sector++)
+    {
+      if (sector == changed)
+        pattern_fill (expected, sector, seed);
+      else if (zeros)
+        memset (expected, 0, SECTOR);
+      else
+        pattern_fill (expected, sector, 0);
+      if (read (fd, actual, SECTOR) != SECTOR)
+        fail ("read sector %zu of \"%s\"", sector, name);
+      if (memcmp (actual, expected, SECTOR))
+        fail ("sector %zu of \"%s\" differs from expected", sector, name);
+    }
+  msg ("verified contents of \"%s\"", name);
+  close (fd);
+}
+
+/* Verifies that NAME holds the seed 0 pattern, except that
+   sector CHANGED, unless it is PATTERN_NONE, holds the SEED
+   pattern. */
+void
+pattern_check (const char *name, size_t changed, unsigned seed)
+{
+  verify (name, changed, seed, false);
+}
+
+/* Verifies that NAME holds zeros, except that sector CHANGED,
+   unless it is PATTERN_NONE, holds the SEED pattern. */
+void
+zero_check (const char *name, size_t changed, unsigned seed)
+{
+  verify (name, changed, seed, true);
+}
@@ -0,0 +1,20 @@
+#ifndef TESTS_FILESYS_DEDUP_PATTERN_H
+#define TESTS_FILESYS_DEDUP_PATTERN_H
+
+#include <stddef.h>
+
+/* Number of sectors in a pattern file.  The test disks are 2 MB,
+   so two such files fit only if their data sectors are shared. */
+#define PATTERN_SECTORS 2400
+
+/* Passed as CHANGED to pattern_check() when no sector was
+   changed. */
+#define PATTERN_NONE ((size_t) -1)
+
+void pattern_fill (void *, size_t sector, unsigned seed);
+void pattern_write (const char *name);
+void pattern_change (const char *name, size_t sector, unsigned seed);
+void pattern_check (const char *name, size_t changed, unsigned seed);
+void zero_check (const char *name, size_t changed, unsigned seed);
+
+#endif /* tests/filesys/dedup/pattern.h */
@@ -0,0 +1,57 @@
+/* Child process for the mixed test.
+   Fills a private file, then issues random 4 kB reads and writes
+   to it, roughly two reads per write. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/perf/mixed.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+
+static char buf[BLOCK_SIZE];
+static struct perf perf;
+
+int
+main (int argc, char *argv[])
+{
+  char file_name[16], label[16];
+  int child_idx;
+  int fd, i;
+
+  test_name = "child-mixed";
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  snprintf (file_name, sizeof file_name, "mixed%d", child_idx);
+  snprintf (label, sizeof label, "mixed-%d", child_idx);
+
+  random_init (child_idx);
+  random_bytes (buf, sizeof buf);
+  if (!create (file_name, 0) || (fd = open (file_name)) < 2)
+    fail ("create \"%s\" failed", file_name);
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+      fail ("write block %d of \"%s\" failed", i, file_name);
+
+  perf_begin (&perf, label);
+  for (i = 0; i < OP_CNT; i++)
+    {
+      size_t ofs = random_ulong () % BLOCK_CNT * BLOCK_SIZE;
+      bool writing = random_ulong () % 3 == 0;
+      int n;
+
+      perf_op_begin (&perf);
+      seek (fd, ofs);
+      n = writing ? write (fd, buf, BLOCK_SIZE) : read (fd, buf, BLOCK_SIZE);
+      if (n != BLOCK_SIZE)
+        fail ("%s at offset %zu in \"%s\" failed",
+              writing ? "write" : "read", ofs, file_name);
+      perf_op_end (&perf, BLOCK_SIZE);
+    }
+  perf_end (&perf);
+  close (fd);
+
+  return child_idx;
+}
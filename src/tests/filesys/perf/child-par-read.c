@@ -0,0 +1,53 @@
+/* Child process for the par-read test.  Reads random sectors of
+   a small private file, which stays in the buffer cache, so that
+   every read is a cache hit. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/filesys/perf/par-read.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+
+static char buf[PAR_FILE_SIZE];
+static struct perf perf;
+
+int
+main (int argc, char *argv[])
+{
+  char file_name[16], label[16];
+  int child_idx;
+  int fd, i;
+
+  test_name = "child-par-read";
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+  snprintf (file_name, sizeof file_name, "par%d", child_idx);
+  snprintf (label, sizeof label, "par-read-%d", child_idx);
+
+  random_init (child_idx);
+  random_bytes (buf, sizeof buf);
+  if (!create (file_name, 0) || (fd = open (file_name)) < 2)
+    fail ("create \"%s\" failed", file_name);
+  if (write (fd, buf, sizeof buf) != sizeof buf)
+    fail ("write \"%s\" failed", file_name);
+
+  perf_begin (&perf, label);
+  for (i = 0; i < PAR_READ_CNT; i++)
+    {
+      size_t ofs = random_ulong () % (PAR_FILE_SIZE / PAR_READ_SIZE)
+                   * PAR_READ_SIZE;
+
+      perf_op_begin (&perf);
+      seek (fd, ofs);
+      if (read (fd, buf, PAR_READ_SIZE) != PAR_READ_SIZE)
+        fail ("read at offset %zu in \"%s\" failed", ofs, file_name);
+      perf_op_end (&perf, PAR_READ_SIZE);
+    }
+  perf_end (&perf);
+  close (fd);
+
+  return child_idx;
+}
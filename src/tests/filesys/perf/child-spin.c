@@ -0,0 +1,26 @@
+/* Child process for the sched test.  Computes without making
+   any system calls, so that only timer preemption takes the CPU
+   away from it. */
+
+#include <stdlib.h>
+#include "tests/filesys/perf/sched.h"
+#include "tests/lib.h"
+
+int
+main (int argc, char *argv[])
+{
+  volatile unsigned sum = 0;
+  int child_idx;
+  int i, j;
+
+  test_name = "child-spin";
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi (argv[1]);
+
+  for (i = 0; i < SPIN_OP_CNT; i++)
+    for (j = 0; j < SPIN_ITERS; j++)
+      sum += j ^ child_idx;
+
+  return child_idx;
+}
@@ -0,0 +1,9 @@
+/* Child process for the kernel-tlb test.  Exits at once, so that
+   starting and waiting for it measures process creation and
+   teardown alone. */
+
+int
+main (void)
+{
+  return 0;
+}
@@ -0,0 +1,44 @@
+/* Measures name lookup in a large directory by opening randomly
+   chosen files among many. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 200
+#define LOOKUP_CNT 1000
+
+static struct perf perf;
+
+void
+test_main (void)
+{
+  char file_name[16];
+  int i;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "file%d", i);
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+    }
+
+  perf_begin (&perf, "dir-lookup");
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      int fd;
+
+      snprintf (file_name, sizeof file_name, "file%lu",
+                random_ulong () % FILE_CNT);
+      perf_op_begin (&perf);
+      if ((fd = open (file_name)) < 2)
+        fail ("open \"%s\" failed", file_name);
+      close (fd);
+      perf_op_end (&perf, 0);
+    }
+  perf_end (&perf);
+}
@@ -0,0 +1,64 @@
+/* Measures kernel paths that touch many pages of kernel memory:
+   4 kB reads of a file that stays in the buffer cache, and
+   starting and waiting for a trivial child process, which
+   switches page directories several times.
+
+   Compare a normal run against one with the kernel's
+   -smallpages option (e.g. "make perf KERNELFLAGS=-smallpages")
+   to see what large and global kernel pages save. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (16 * 1024)   /* Small enough to stay cached. */
+#define BLOCK_SIZE 4096
+#define READ_CNT 1024
+#define EXEC_CNT 32
+
+static const char file_name[] = "tlb";
+static char buf[FILE_SIZE];
+static struct perf perf;
+
+void
+test_main (void)
+{
+  int fd, i;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  if (write (fd, buf, sizeof buf) != sizeof buf)
+    fail ("write \"%s\" failed", file_name);
+
+  perf_begin (&perf, "tlb-read");
+  for (i = 0; i < READ_CNT; i++)
+    {
+      size_t ofs = i * BLOCK_SIZE % FILE_SIZE;
+
+      perf_op_begin (&perf);
+      seek (fd, ofs);
+      if (read (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read at offset %zu in \"%s\" failed", ofs, file_name);
+      perf_op_end (&perf, BLOCK_SIZE);
+    }
+  perf_end (&perf);
+  close (fd);
+
+  perf_begin (&perf, "tlb-exec");
+  for (i = 0; i < EXEC_CNT; i++)
+    {
+      pid_t pid;
+
+      perf_op_begin (&perf);
+      if ((pid = exec ("child-tlb")) == PID_ERROR)
+        fail ("exec \"child-tlb\" failed");
+      if (wait (pid) != 0)
+        fail ("wait for \"child-tlb\" failed");
+      perf_op_end (&perf, 0);
+    }
+  perf_end (&perf);
+}
@@ -0,0 +1,24 @@
+/* Runs several processes at once, each doing a mix of random
+   reads and writes to its own file, and measures the aggregate
+   throughput.  Each child also reports its own latencies. */
+
+#include <syscall.h>
+#include "tests/filesys/perf/mixed.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct perf perf;
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+
+  perf_begin (&perf, "mixed-total");
+  exec_children ("child-mixed", children, CHILD_CNT);
+  wait_children (children, CHILD_CNT);
+  perf.op_cnt = CHILD_CNT * OP_CNT;
+  perf.bytes = (unsigned long long) CHILD_CNT * OP_CNT * BLOCK_SIZE;
+  perf_end (&perf);
+}
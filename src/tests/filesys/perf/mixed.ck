@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::perf::perf;
+check_perf ("mixed-0", "mixed-1", "mixed-2", "mixed-3", "mixed-total");
@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_PERF_MIXED_H
+#define TESTS_FILESYS_PERF_MIXED_H
+
+#define CHILD_CNT 4
+#define BLOCK_SIZE 4096
+#define BLOCK_CNT 64            /* Per child. */
+#define OP_CNT 256              /* Per child. */
+
+#endif /* tests/filesys/perf/mixed.h */
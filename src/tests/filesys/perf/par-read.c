@@ -0,0 +1,32 @@
+/* Runs several processes at once, each reading its own small
+   file, which stays in the buffer cache, and measures the
+   aggregate throughput of cache hits.  The files' sectors spread
+   over the cache's shards, so with more CPUs (e.g. "make perf
+   PINTOSOPTS=--smp=4") the total should grow with the CPU count
+   as far as the rest of the kernel allows.
+
+   For now the kernel lock (see threads/smp.c) runs every read()
+   on one CPU at a time.  Until it is gone, this measures that
+   lock more than the cache, and it should not scale. */
+
+#include <syscall.h>
+#include "tests/filesys/perf/par-read.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct perf perf;
+
+void
+test_main (void)
+{
+  pid_t children[PAR_CHILD_CNT];
+
+  perf_begin (&perf, "par-read-total");
+  exec_children ("child-par-read", children, PAR_CHILD_CNT);
+  wait_children (children, PAR_CHILD_CNT);
+  perf.op_cnt = PAR_CHILD_CNT * PAR_READ_CNT;
+  perf.bytes = (unsigned long long) PAR_CHILD_CNT * PAR_READ_CNT
+               * PAR_READ_SIZE;
+  perf_end (&perf);
+}
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::perf::perf;
+check_perf ("par-read-0", "par-read-1", "par-read-2", "par-read-3",
+	    "par-read-total");
@@ -0,0 +1,9 @@
+#ifndef TESTS_FILESYS_PERF_PAR_READ_H
+#define TESTS_FILESYS_PERF_PAR_READ_H
+
+#define PAR_CHILD_CNT 4
+#define PAR_FILE_SIZE 2048      /* Per child; all fit in the cache. */
+#define PAR_READ_SIZE 512
+#define PAR_READ_CNT 2048       /* Per child. */
+
+#endif /* tests/filesys/perf/par-read.h */
@@ -0,0 +1,117 @@
+/* Measurement helpers shared by the file system performance
+   tests.
+
+   A phase is bracketed by perf_begin() and perf_end(), and each
+   operation in it by perf_op_begin() and perf_op_end().
+   perf_end() prints a single line of the form
+
+     (test) PERF label: N ops, X ops/s, Y.YY MB/s, p50 A us, p99 B us,
+       R reads, W writes
+
+   (on one line) that tests/make-perf collects.  Time comes from
+   time_ns(), the kernel's calibrated TSC clock, and latencies are
+   reported in microseconds; R and W are the number of sectors
+   the file system device read and wrote during the phase. */
+
+#include "tests/filesys/perf/perf.h"
+#include <stdlib.h>
+#include "tests/lib.h"
+
+#define FS_ROLE 1               /* BLOCK_FILESYS in devices/block.h. */
+
+static void
+get_blockstat (struct blockstat *st)
+{
+  if (!blockstat (FS_ROLE, st))
+    fail ("blockstat failed");
+}
+
+/* Starts measuring phase LABEL in P. */
+void
+perf_begin (struct perf *p, const char *label)
+{
+  p->label = label;
+  p->op_cnt = 0;
+  p->bytes = 0;
+  p->sample_cnt = 0;
+  get_blockstat (&p->fs_start);
+  p->start = time_ns ();
+}
+
+/* Marks the start of one operation in P. */
+void
+perf_op_begin (struct perf *p)
+{
+  p->op_start = time_ns ();
+}
+
+/* Marks the end of the operation started by the last call to
+   perf_op_begin(), which moved BYTES bytes. */
+void
+perf_op_end (struct perf *p, size_t bytes)
+{
+  if (p->sample_cnt < PERF_MAX_SAMPLES)
+    p->samples[p->sample_cnt++] = (time_ns () - p->op_start) / 1000;
+  p->op_cnt++;
+  p->bytes += bytes;
+}
+
+static int
+compare_unsigned (const void *a_, const void *b_)
+{
+  const unsigned *a = a_;
+  const unsigned *b = b_;
+
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Returns the PCT'th percentile of P's samples in microseconds.
+   P's samples must be sorted. */
+static unsigned
+percentile_us (const struct perf *p, int pct)
+{
+  size_t idx = (p->sample_cnt * pct + 99) / 100;
+
+  if (idx > 0)
+    idx--;
+  return p->samples[idx];
+}
+
+/* Ends phase P and prints its PERF line.  Phases whose
+   operations were not timed individually print no percentiles. */
+void
+perf_end (struct perf *p)
+{
+  struct blockstat fs_end;
+  uint64_t elapsed_us = (time_ns () - p->start) / 1000;
+  unsigned long long centi_mbps;
+
+  get_blockstat (&fs_end);
+
+  /* Shorter phases are rounded up to one microsecond. */
+  if (elapsed_us < 1)
+    elapsed_us = 1;
+  centi_mbps = (p->bytes * 100 * 1000000 / elapsed_us) / (1024 * 1024);
+
+  if (p->sample_cnt > 0)
+    {
+      qsort (p->samples, p->sample_cnt, sizeof *p->samples,
+             compare_unsigned);
+      msg ("PERF %s: %zu ops, %llu ops/s, %llu.%02llu MB/s, "
+           "p50 %u us, p99 %u us, %llu reads, %llu writes",
+           p->label, p->op_cnt,
+           (unsigned long long) p->op_cnt * 1000000 / elapsed_us,
+           centi_mbps / 100, centi_mbps % 100,
+           percentile_us (p, 50), percentile_us (p, 99),
+           fs_end.read_cnt - p->fs_start.read_cnt,
+           fs_end.write_cnt - p->fs_start.write_cnt);
+    }
+  else
+    msg ("PERF %s: %zu ops, %llu ops/s, %llu.%02llu MB/s, "
+         "%llu reads, %llu writes",
+         p->label, p->op_cnt,
+         (unsigned long long) p->op_cnt * 1000000 / elapsed_us,
+         centi_mbps / 100, centi_mbps % 100,
+         fs_end.read_cnt - p->fs_start.read_cnt,
+         fs_end.write_cnt - p->fs_start.write_cnt);
+}
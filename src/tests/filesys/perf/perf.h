@@ -0,0 +1,29 @@
+#ifndef TESTS_FILESYS_PERF_PERF_H
+#define TESTS_FILESYS_PERF_PERF_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <syscall.h>
+
+/* Most per-operation latencies a measurement keeps. */
+#define PERF_MAX_SAMPLES 1024
+
+/* One measured phase of a benchmark. */
+struct perf
+  {
+    const char *label;          /* Name printed in the PERF line. */
+    uint64_t start;             /* time_ns() when the phase began. */
+    uint64_t op_start;          /* time_ns() when the current op began. */
+    struct blockstat fs_start;  /* File system disk counters at start. */
+    size_t op_cnt;              /* Operations completed. */
+    unsigned long long bytes;   /* Bytes transferred. */
+    size_t sample_cnt;          /* Latencies recorded in samples[]. */
+    unsigned samples[PERF_MAX_SAMPLES];  /* Per-operation latencies in us. */
+  };
+
+void perf_begin (struct perf *, const char *label);
+void perf_op_begin (struct perf *);
+void perf_op_end (struct perf *, size_t bytes);
+void perf_end (struct perf *);
+
+#endif /* tests/filesys/perf/perf.h */
@@ -0,0 +1,26 @@
+use strict;
+use warnings;
+use tests::tests;
+
+# Checks the output of a performance test: it must have run to
+# completion like any other test and printed a PERF line for each
+# of the given labels.  The numbers themselves are not graded;
+# tests/make-perf collects them.
+sub check_perf {
+    my (@labels) = @_;
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+
+    my ($name) = $test =~ m%([^/]+)$%;
+    fail "Run didn't print \"($name) begin\"\n"
+      if !grep ($_ eq "($name) begin", @output);
+    fail "Run didn't print \"($name) end\"\n"
+      if !grep ($_ eq "($name) end", @output);
+    for my $label (@labels) {
+	fail "Run didn't report performance of \"$label\"\n"
+	  if !grep (/^\(\S+\) PERF \Q$label\E: \d+ ops, /, @output);
+    }
+    pass;
+}
+
+1;
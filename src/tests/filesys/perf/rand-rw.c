@@ -0,0 +1,58 @@
+/* Measures random 4 kB reads and then random 4 kB writes at
+   block-aligned offsets within a 1 MB file. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 4096
+#define BLOCK_CNT 256
+#define OP_CNT 512
+
+static const char file_name[] = "rand";
+static char buf[BLOCK_SIZE];
+static struct perf perf;
+
+static void
+random_pass (int fd, const char *label, bool writing)
+{
+  int i;
+
+  perf_begin (&perf, label);
+  for (i = 0; i < OP_CNT; i++)
+    {
+      size_t ofs = random_ulong () % BLOCK_CNT * BLOCK_SIZE;
+      int n;
+
+      perf_op_begin (&perf);
+      seek (fd, ofs);
+      n = writing ? write (fd, buf, BLOCK_SIZE) : read (fd, buf, BLOCK_SIZE);
+      if (n != BLOCK_SIZE)
+        fail ("%s %d bytes at offset %zu in \"%s\" failed",
+              writing ? "write" : "read", BLOCK_SIZE, ofs, file_name);
+      perf_op_end (&perf, BLOCK_SIZE);
+    }
+  perf_end (&perf);
+}
+
+void
+test_main (void)
+{
+  int fd, i;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  msg ("write \"%s\"", file_name);
+  for (i = 0; i < BLOCK_CNT; i++)
+    if (write (fd, buf, BLOCK_SIZE) != BLOCK_SIZE)
+      fail ("write block %d of \"%s\" failed", i, file_name);
+
+  random_pass (fd, "rand-read-4096", false);
+  random_pass (fd, "rand-write-4096", true);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
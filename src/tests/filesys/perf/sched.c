@@ -0,0 +1,40 @@
+/* Runs CPU-bound and I/O-bound processes together and measures
+   how the scheduler serves each kind: SPIN_CHILD_CNT copies of
+   child-spin, which only compute, alongside the CHILD_CNT
+   copies of child-mixed from the mixed test, which mostly wait
+   for the disk.  "sched-io" ends when the I/O-bound children
+   are done and "sched-cpu" when all are; the child-mixed lines
+   give the I/O latencies.
+
+   Run with more CPUs (e.g. "make perf PINTOSOPTS=--smp=4") to
+   see how the per-CPU run queues spread the load. */
+
+#include <syscall.h>
+#include "tests/filesys/perf/mixed.h"
+#include "tests/filesys/perf/perf.h"
+#include "tests/filesys/perf/sched.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static struct perf io_perf, cpu_perf;
+
+void
+test_main (void)
+{
+  pid_t spinners[SPIN_CHILD_CNT];
+  pid_t io_children[CHILD_CNT];
+
+  perf_begin (&cpu_perf, "sched-cpu");
+  perf_begin (&io_perf, "sched-io");
+  exec_children ("child-spin", spinners, SPIN_CHILD_CNT);
+  exec_children ("child-mixed", io_children, CHILD_CNT);
+
+  wait_children (io_children, CHILD_CNT);
+  io_perf.op_cnt = CHILD_CNT * OP_CNT;
+  io_perf.bytes = (unsigned long long) CHILD_CNT * OP_CNT * BLOCK_SIZE;
+  perf_end (&io_perf);
+
+  wait_children (spinners, SPIN_CHILD_CNT);
+  cpu_perf.op_cnt = SPIN_CHILD_CNT * SPIN_OP_CNT;
+  perf_end (&cpu_perf);
+}
@@ -0,0 +1,8 @@
+#ifndef TESTS_FILESYS_PERF_SCHED_H
+#define TESTS_FILESYS_PERF_SCHED_H
+
+#define SPIN_CHILD_CNT 8
+#define SPIN_OP_CNT 64          /* Per child. */
+#define SPIN_ITERS 100000       /* Per operation. */
+
+#endif /* tests/filesys/perf/sched.h */
@@ -0,0 +1,58 @@
+/* Measures sequential read throughput: reads a 1 MB file from
+   start to end once for each of several block sizes. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+
+static const char file_name[] = "seq";
+static char buf[16384];
+static struct perf perf;
+
+static void
+read_pass (int fd, size_t block_size)
+{
+  char label[32];
+  size_t ofs;
+
+  snprintf (label, sizeof label, "seq-read-%zu", block_size);
+  seek (fd, 0);
+  perf_begin (&perf, label);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += block_size)
+    {
+      perf_op_begin (&perf);
+      if (read (fd, buf, block_size) != (int) block_size)
+        fail ("read %zu bytes at offset %zu in \"%s\" failed",
+              block_size, ofs, file_name);
+      perf_op_end (&perf, block_size);
+    }
+  perf_end (&perf);
+}
+
+void
+test_main (void)
+{
+  size_t ofs;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  msg ("write \"%s\"", file_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    if (write (fd, buf, sizeof buf) != sizeof buf)
+      fail ("write %zu bytes at offset %zu in \"%s\" failed",
+            sizeof buf, ofs, file_name);
+
+  read_pass (fd, 512);
+  read_pass (fd, 4096);
+  read_pass (fd, 16384);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
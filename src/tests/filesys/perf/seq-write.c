@@ -0,0 +1,51 @@
+/* Measures sequential write throughput: writes a 1 MB file from
+   start to end once for each of several block sizes. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+
+static char buf[16384];
+static struct perf perf;
+
+static void
+write_pass (size_t block_size)
+{
+  char file_name[32], label[32];
+  size_t ofs;
+  int fd;
+
+  snprintf (file_name, sizeof file_name, "seq-%zu", block_size);
+  snprintf (label, sizeof label, "seq-write-%zu", block_size);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  perf_begin (&perf, label);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += block_size)
+    {
+      perf_op_begin (&perf);
+      if (write (fd, buf, block_size) != (int) block_size)
+        fail ("write %zu bytes at offset %zu in \"%s\" failed",
+              block_size, ofs, file_name);
+      perf_op_end (&perf, block_size);
+    }
+  perf_end (&perf);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+}
+
+void
+test_main (void)
+{
+  random_bytes (buf, sizeof buf);
+  write_pass (512);
+  write_pass (4096);
+  write_pass (16384);
+}
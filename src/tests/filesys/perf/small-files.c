@@ -0,0 +1,53 @@
+/* Measures creating many small files, each written once, and
+   then deleting them all. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/perf/perf.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 100
+#define FILE_SIZE 512
+
+static char buf[FILE_SIZE];
+static struct perf perf;
+
+void
+test_main (void)
+{
+  char file_name[16];
+  int i;
+
+  random_bytes (buf, sizeof buf);
+
+  perf_begin (&perf, "small-create");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (file_name, sizeof file_name, "small%d", i);
+      perf_op_begin (&perf);
+      if (!create (file_name, 0))
+        fail ("create \"%s\" failed", file_name);
+      if ((fd = open (file_name)) < 2)
+        fail ("open \"%s\" failed", file_name);
+      if (write (fd, buf, FILE_SIZE) != FILE_SIZE)
+        fail ("write \"%s\" failed", file_name);
+      close (fd);
+      perf_op_end (&perf, FILE_SIZE);
+    }
+  perf_end (&perf);
+
+  perf_begin (&perf, "small-delete");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (file_name, sizeof file_name, "small%d", i);
+      perf_op_begin (&perf);
+      if (!remove (file_name))
+        fail ("remove \"%s\" failed", file_name);
+      perf_op_end (&perf, 0);
+    }
+  perf_end (&perf);
+}
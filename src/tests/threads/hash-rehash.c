@@ -0,0 +1,134 @@
+/* Tests lib/kernel/hash.c.
+
+   Inserts and deletes random keys, checking after each
+   operation that the table holds exactly the keys it should,
+   including while elements are still being moved from an old
+   bucket array to a new one. */
+
+#include <debug.h>
+#include <hash.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+
+/* Number of distinct keys. */
+#define KEY_CNT 4096
+
+/* Number of random insertions and deletions. */
+#define OP_CNT (KEY_CNT * 32)
+
+/* A hash table element. */
+struct value 
+  {
+    struct hash_elem elem;      /* Hash element. */
+    int value;                  /* Item value. */
+    bool present;               /* In the table? */
+  };
+
+static unsigned value_hash (const struct hash_elem *, void *);
+static bool value_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+static void verify_hash (struct hash *, struct value[], size_t present_cnt);
+
+void
+test_hash_rehash (void) 
+{
+  static struct value values[KEY_CNT];
+  struct hash hash;
+  size_t present_cnt = 0;
+  int i;
+
+  for (i = 0; i < KEY_CNT; i++) 
+    {
+      values[i].value = i;
+      values[i].present = false;
+    }
+  if (!hash_init (&hash, value_hash, value_less, NULL))
+    fail ("hash_init failed");
+
+  msg ("inserting and deleting %d random keys", OP_CNT);
+  for (i = 0; i < OP_CNT; i++) 
+    {
+      struct value *v = &values[random_ulong () % KEY_CNT];
+      struct hash_elem *e;
+
+      /* Grow for the first quarter, shrink for the second, and
+         so on. */
+      if ((i / (OP_CNT / 4)) % 2 == 0 ? random_ulong () % 4 != 0
+                                      : random_ulong () % 4 == 0) 
+        {
+          e = hash_insert (&hash, &v->elem);
+          ASSERT ((e != NULL) == v->present);
+          if (e == NULL) 
+            {
+              v->present = true;
+              present_cnt++;
+            }
+        }
+      else
+        {
+          e = hash_delete (&hash, &v->elem);
+          ASSERT ((e != NULL) == v->present);
+          if (e != NULL) 
+            {
+              v->present = false;
+              present_cnt--;
+            }
+        }
+      ASSERT (hash_size (&hash) == present_cnt);
+
+      if (i % 97 == 0)
+        verify_hash (&hash, values, present_cnt);
+    }
+  verify_hash (&hash, values, present_cnt);
+
+  hash_clear (&hash, NULL);
+  ASSERT (hash_empty (&hash));
+  hash_destroy (&hash, NULL);
+
+  msg ("table held the right keys throughout");
+}
+
+/* Returns a hash of value E. */
+static unsigned
+value_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  return hash_int (hash_entry (e, struct value, elem)->value);
+}
+
+/* Returns true if value A is less than value B, false
+   otherwise. */
+static bool
+value_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED) 
+{
+  const struct value *a = hash_entry (a_, struct value, elem);
+  const struct value *b = hash_entry (b_, struct value, elem);
+  
+  return a->value < b->value;
+}
+
+/* Verifies that HASH contains exactly the PRESENT_CNT elements
+   of VALUES[] marked present, both by looking up every value and
+   by iterating over the table. */
+static void
+verify_hash (struct hash *hash, struct value values[], size_t present_cnt) 
+{
+  struct hash_iterator it;
+  size_t cnt = 0;
+  int i;
+
+  for (i = 0; i < KEY_CNT; i++) 
+    {
+      struct hash_elem *e = hash_find (hash, &values[i].elem);
+      ASSERT (values[i].present ? e == &values[i].elem : e == NULL);
+    }
+
+  hash_first (&it, hash);
+  while (hash_next (&it)) 
+    {
+      struct value *v = hash_entry (hash_cur (&it), struct value, elem);
+      ASSERT (v->present);
+      cnt++;
+    }
+  ASSERT (cnt == present_cnt);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(hash-rehash) begin
+(hash-rehash) inserting and deleting 131072 random keys
+(hash-rehash) table held the right keys throughout
+(hash-rehash) end
+EOF
+pass;
@@ -0,0 +1,161 @@
+/* Compares the chained hash table in lib/kernel/hash.c with the
+   open-addressed one in lib/kernel/ohash.c on integer keys, as
+   for a sector number to buffer cache entry index: inserting
+   KEY_CNT keys, then looking up keys that are present and keys
+   that are not.
+
+   The elements are allocated one at a time with malloc(), as
+   real table entries are, so that following a chain means
+   visiting scattered memory. */
+
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <ohash.h>
+#include <random.h>
+#include "tests/threads/perf/perf.h"
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+
+#define KEY_CNT 4096
+#define LOOKUP_CNT 65536
+
+/* A table entry, keyed by sector number. */
+struct entry
+  {
+    struct hash_elem hash_elem;         /* Element in chained table. */
+    struct ohash_elem ohash_elem;       /* Element in open table. */
+    uint32_t sector;                    /* Key. */
+  };
+
+static struct entry *entries[KEY_CNT];
+static struct perf perf;
+
+static unsigned
+entry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct entry, hash_elem)->sector);
+}
+
+static bool
+entry_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return (hash_entry (a, struct entry, hash_elem)->sector
+          < hash_entry (b, struct entry, hash_elem)->sector);
+}
+
+/* Returns the key of the I'th present entry.  Present keys are
+   even, so odd keys are absent. */
+static uint32_t
+present_key (size_t i)
+{
+  return i * 2;
+}
+
+/* Returns a key picked at random from those that are present,
+   or, if MISS, from those that are not. */
+static uint32_t
+random_key (bool miss)
+{
+  return present_key (random_ulong () % KEY_CNT) + miss;
+}
+
+static void
+bench_chained (void)
+{
+  struct hash h;
+  struct entry key;
+  size_t i;
+
+  if (!hash_init (&h, entry_hash, entry_less, NULL))
+    fail ("hash_init failed");
+
+  perf_begin (&perf, "chained-insert");
+  for (i = 0; i < KEY_CNT; i++)
+    hash_insert (&h, &entries[i]->hash_elem);
+  perf.op_cnt = KEY_CNT;
+  perf_end (&perf);
+
+  perf_begin (&perf, "chained-hit");
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      key.sector = random_key (false);
+      if (hash_find (&h, &key.hash_elem) == NULL)
+        fail ("chained table lost key %"PRIu32, key.sector);
+    }
+  perf.op_cnt = LOOKUP_CNT;
+  perf_end (&perf);
+
+  perf_begin (&perf, "chained-miss");
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      key.sector = random_key (true);
+      if (hash_find (&h, &key.hash_elem) != NULL)
+        fail ("chained table found absent key %"PRIu32, key.sector);
+    }
+  perf.op_cnt = LOOKUP_CNT;
+  perf_end (&perf);
+
+  hash_destroy (&h, NULL);
+}
+
+static void
+bench_open (void)
+{
+  struct ohash h;
+  size_t i;
+
+  if (!ohash_init (&h))
+    fail ("ohash_init failed");
+
+  perf_begin (&perf, "open-insert");
+  for (i = 0; i < KEY_CNT; i++)
+    ohash_insert (&h, &entries[i]->ohash_elem);
+  perf.op_cnt = KEY_CNT;
+  perf_end (&perf);
+
+  perf_begin (&perf, "open-hit");
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      uint32_t key = random_key (false);
+      if (ohash_find (&h, key) == NULL)
+        fail ("open table lost key %"PRIu32, key);
+    }
+  perf.op_cnt = LOOKUP_CNT;
+  perf_end (&perf);
+
+  perf_begin (&perf, "open-miss");
+  for (i = 0; i < LOOKUP_CNT; i++)
+    {
+      uint32_t key = random_key (true);
+      if (ohash_find (&h, key) != NULL)
+        fail ("open table found absent key %"PRIu32, key);
+    }
+  perf.op_cnt = LOOKUP_CNT;
+  perf_end (&perf);
+
+  ohash_destroy (&h, NULL);
+}
+
+void
+test_hash_lookup (void) 
+{
+  size_t i;
+
+  random_init (0);
+  for (i = 0; i < KEY_CNT; i++)
+    {
+      entries[i] = malloc (sizeof *entries[i]);
+      if (entries[i] == NULL)
+        fail ("out of memory");
+      entries[i]->sector = present_key (i);
+      entries[i]->ohash_elem.key = present_key (i);
+    }
+
+  bench_chained ();
+  bench_open ();
+
+  for (i = 0; i < KEY_CNT; i++)
+    free (entries[i]);
+}
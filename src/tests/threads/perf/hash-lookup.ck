@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::filesys::perf::perf;
+check_perf ("chained-insert", "chained-hit", "chained-miss",
+	    "open-insert", "open-hit", "open-miss");
@@ -0,0 +1,89 @@
+/* Measurement helpers shared by the kernel performance tests.
+
+   These work like the ones for the file system performance
+   tests in tests/filesys/perf/perf.c, but run inside the kernel
+   and take their time from timer_ns().  perf_end() prints
+
+     (test) PERF label: N ops, X ops/s, p50 A us, p99 B us
+
+   for tests/make-perf to collect.  A phase too fast to time one
+   operation at a time can instead set op_cnt itself between
+   perf_begin() and perf_end(), which then prints no
+   percentiles. */
+
+#include "tests/threads/perf/perf.h"
+#include <stdlib.h>
+#include "devices/timer.h"
+#include "tests/threads/tests.h"
+
+/* Starts measuring phase LABEL in P. */
+void
+perf_begin (struct perf *p, const char *label)
+{
+  p->label = label;
+  p->op_cnt = 0;
+  p->sample_cnt = 0;
+  p->start = timer_ns ();
+}
+
+/* Marks the start of one operation in P. */
+void
+perf_op_begin (struct perf *p)
+{
+  p->op_start = timer_ns ();
+}
+
+/* Marks the end of the operation started by the last call to
+   perf_op_begin(). */
+void
+perf_op_end (struct perf *p)
+{
+  if (p->sample_cnt < PERF_MAX_SAMPLES)
+    p->samples[p->sample_cnt++] = (timer_ns () - p->op_start) / 1000;
+  p->op_cnt++;
+}
+
+static int
+compare_unsigned (const void *a_, const void *b_)
+{
+  const unsigned *a = a_;
+  const unsigned *b = b_;
+
+  return *a < *b ? -1 : *a > *b;
+}
+
+/* Returns the PCT'th percentile of P's samples in microseconds.
+   P's samples must be sorted. */
+static unsigned
+percentile_us (const struct perf *p, int pct)
+{
+  size_t idx = (p->sample_cnt * pct + 99) / 100;
+
+  if (idx > 0)
+    idx--;
+  return p->samples[idx];
+}
+
+/* Ends phase P and prints its PERF line. */
+void
+perf_end (struct perf *p)
+{
+  uint64_t elapsed_us = (timer_ns () - p->start) / 1000;
+  unsigned long long ops_per_sec;
+
+  /* Shorter phases are rounded up to one microsecond. */
+  if (elapsed_us < 1)
+    elapsed_us = 1;
+  ops_per_sec = (unsigned long long) p->op_cnt * 1000000 / elapsed_us;
+
+  if (p->sample_cnt > 0)
+    {
+      qsort (p->samples, p->sample_cnt, sizeof *p->samples,
+             compare_unsigned);
+      msg ("PERF %s: %zu ops, %llu ops/s, p50 %u us, p99 %u us",
+           p->label, p->op_cnt, ops_per_sec,
+           percentile_us (p, 50), percentile_us (p, 99));
+    }
+  else
+    msg ("PERF %s: %zu ops, %llu ops/s", p->label, p->op_cnt, ops_per_sec);
+}
@@ -0,0 +1,26 @@
+#ifndef TESTS_THREADS_PERF_PERF_H
+#define TESTS_THREADS_PERF_PERF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Most per-operation latencies a measurement keeps. */
+#define PERF_MAX_SAMPLES 1024
+
+/* One measured phase of a benchmark. */
+struct perf
+  {
+    const char *label;          /* Name printed in the PERF line. */
+    uint64_t start;             /* timer_ns() when the phase began. */
+    uint64_t op_start;          /* timer_ns() when the current op began. */
+    size_t op_cnt;              /* Operations completed. */
+    size_t sample_cnt;          /* Latencies recorded in samples[]. */
+    unsigned samples[PERF_MAX_SAMPLES];  /* Per-operation latencies in us. */
+  };
+
+void perf_begin (struct perf *, const char *label);
+void perf_op_begin (struct perf *);
+void perf_op_end (struct perf *);
+void perf_end (struct perf *);
+
+#endif /* tests/threads/perf/perf.h */
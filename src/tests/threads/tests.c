@@ -38,6 +38,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"hash-lookup", test_hash_lookup},
+    {"hash-rehash", test_hash_rehash},
   };
 
 static const char *test_name;
@@ -0,0 +1,26 @@
+/* Child process run by pipe-stdin.  Reads its stdin, a pipe,
+   until end of file, prints what it read, and exits with the
+   number of bytes read. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-pipe-read";
+
+int
+main (void) 
+{
+  char buf[128];
+  int total = 0;
+  int n;
+
+  while ((n = read (STDIN_FILENO, buf + total,
+                    sizeof buf - 1 - total)) > 0)
+    total += n;
+  if (n < 0)
+    fail ("read returned %d", n);
+  buf[total] = '\0';
+  msg ("read \"%s\"", buf);
+  return total;
+}
@@ -0,0 +1,18 @@
+/* Child process run by pipe-block.  Writes PIPE_BIG bytes to its
+   stdout, which is a pipe, and exits.  It must not print
+   anything else, since its output is the pipe's data. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/pipe.h"
+
+int
+main (void) 
+{
+  static char buf[PIPE_BIG];
+  int i;
+
+  for (i = 0; i < PIPE_BIG; i++)
+    buf[i] = PIPE_PATTERN (i);
+  return write (STDOUT_FILENO, buf, PIPE_BIG) == PIPE_BIG ? 0 : 1;
+}
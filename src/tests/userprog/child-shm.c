@@ -0,0 +1,28 @@
+/* Child process run by the shm tests.  Opens the shared memory
+   segment named by its argument, creating it if there is none,
+   maps it, reports what it finds at the start, and stores its
+   own string there before exiting without unmapping. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-shm";
+
+int
+main (int argc, char *argv[]) 
+{
+  char *p;
+  int id;
+
+  if (argc != 2)
+    fail ("usage: child-shm NAME");
+  if ((id = shm_open (argv[1], 4096)) == -1)
+    fail ("shm_open \"%s\"", argv[1]);
+  if ((p = shm_map (id)) == NULL)
+    fail ("shm_map");
+  msg ("found \"%s\"", p);
+  strlcpy (p, "from child", 4096);
+  return 0;
+}
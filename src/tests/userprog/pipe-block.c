@@ -0,0 +1,53 @@
+/* Runs child-pipe-write with its stdout on a pipe.  The child
+   writes more than the pipe holds, so it must block until this
+   process reads, and this process blocks in read() whenever the
+   pipe is empty.  Reading ends with end of file once the child,
+   the last writer, exits. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/userprog/pipe.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[1000];
+  size_t total = 0;
+  int fds[2];
+  int console;
+  pid_t child;
+  int n;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK ((console = dup (STDOUT_FILENO)) > 1, "dup stdout");
+
+  /* The child inherits stdout, the pipe's write end.  No msg()
+     until stdout is the console again. */
+  dup2 (fds[1], STDOUT_FILENO);
+  child = exec ("child-pipe-write");
+  dup2 (console, STDOUT_FILENO);
+  CHECK (child != -1, "exec child-pipe-write");
+
+  /* Otherwise this process would be a writer, too, and read()
+     would never see end of file. */
+  close (fds[1]);
+
+  while ((n = read (fds[0], buf, sizeof buf)) > 0)
+    {
+      int i;
+
+      for (i = 0; i < n; i++)
+        if (buf[i] != PIPE_PATTERN (total + i))
+          fail ("byte %zu is %d, not %d",
+                total + i, buf[i], PIPE_PATTERN (total + i));
+      total += n;
+    }
+  if (n < 0)
+    fail ("read returned %d", n);
+  if (total != PIPE_BIG)
+    fail ("read %zu bytes instead of %d", total, PIPE_BIG);
+  msg ("read %d bytes, then end of file", PIPE_BIG);
+  CHECK (wait (child) == 0, "wait for child");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-block) begin
+(pipe-block) pipe
+(pipe-block) dup stdout
+(pipe-block) exec child-pipe-write
+child-pipe-write: exit(0)
+(pipe-block) read 12288 bytes, then end of file
+(pipe-block) wait for child
+(pipe-block) end
+pipe-block: exit(0)
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Duplicates the write end of a pipe.  The pipe stays open for
+   writing until both copies are closed. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  int fds[2];
+  int copy;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK ((copy = dup (fds[1])) > 1, "dup write end");
+  CHECK (copy != fds[0] && copy != fds[1], "dup returned a new fd");
+  msg ("close original write end");
+  close (fds[1]);
+  CHECK (write (copy, "xyz", 3) == 3, "write 3 bytes through copy");
+  CHECK (read (fds[0], buf, sizeof buf) == 3, "read 3 bytes");
+  msg ("close copy");
+  close (copy);
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read end of file");
+  close (fds[0]);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-dup) begin
+(pipe-dup) pipe
+(pipe-dup) dup write end
+(pipe-dup) dup returned a new fd
+(pipe-dup) close original write end
+(pipe-dup) write 3 bytes through copy
+(pipe-dup) read 3 bytes
+(pipe-dup) close copy
+(pipe-dup) read end of file
+(pipe-dup) end
+pipe-dup: exit(0)
+EOF
+pass;
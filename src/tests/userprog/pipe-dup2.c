@@ -0,0 +1,35 @@
+/* Redirects stdout into a pipe with dup2(), writes to stdout,
+   then puts the console back and checks what the pipe got. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "not on the console";
+  char buf[sizeof text];
+  int fds[2];
+  int console;
+  int redirected, written, restored;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK ((console = dup (STDOUT_FILENO)) > 1, "dup stdout");
+
+  /* No msg() until stdout is the console again. */
+  redirected = dup2 (fds[1], STDOUT_FILENO);
+  written = write (STDOUT_FILENO, text, sizeof text);
+  restored = dup2 (console, STDOUT_FILENO);
+
+  CHECK (redirected == STDOUT_FILENO, "dup2 pipe to stdout");
+  CHECK (written == sizeof text, "write %zu bytes to stdout", sizeof text);
+  CHECK (restored == STDOUT_FILENO, "dup2 console back to stdout");
+  CHECK (read (fds[0], buf, sizeof buf) == sizeof text,
+         "read %zu bytes from pipe", sizeof text);
+  if (memcmp (buf, text, sizeof text))
+    fail ("pipe held \"%s\" instead of \"%s\"", buf, text);
+  msg ("pipe held \"%s\"", buf);
+}
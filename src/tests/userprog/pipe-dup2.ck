@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-dup2) begin
+(pipe-dup2) pipe
+(pipe-dup2) dup stdout
+(pipe-dup2) dup2 pipe to stdout
+(pipe-dup2) write 19 bytes to stdout
+(pipe-dup2) dup2 console back to stdout
+(pipe-dup2) read 19 bytes from pipe
+(pipe-dup2) pipe held "not on the console"
+(pipe-dup2) end
+pipe-dup2: exit(0)
+EOF
+pass;
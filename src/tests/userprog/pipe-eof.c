@@ -0,0 +1,22 @@
+/* Closes the write end of a pipe that still holds data.  Reads
+   must return the data, then 0 for end of file. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  int fds[2];
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], "abc", 3) == 3, "write 3 bytes");
+  msg ("close write end");
+  close (fds[1]);
+  CHECK (read (fds[0], buf, sizeof buf) == 3, "read 3 bytes");
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read end of file");
+  CHECK (read (fds[0], buf, sizeof buf) == 0, "read end of file again");
+  close (fds[0]);
+}
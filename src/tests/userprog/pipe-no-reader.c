@@ -0,0 +1,18 @@
+/* Closes the read end of a pipe.  Writes to the write end must
+   then fail with -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int fds[2];
+
+  CHECK (pipe (fds) == 0, "pipe");
+  msg ("close read end");
+  close (fds[0]);
+  CHECK (write (fds[1], "abc", 3) == -1, "write returns -1");
+  close (fds[1]);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-no-reader) begin
+(pipe-no-reader) pipe
+(pipe-no-reader) close read end
+(pipe-no-reader) write returns -1
+(pipe-no-reader) end
+pipe-no-reader: exit(0)
+EOF
+pass;
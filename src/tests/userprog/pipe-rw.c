@@ -0,0 +1,25 @@
+/* Writes to a pipe and reads the same bytes back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "through the pipe";
+  char buf[sizeof text];
+  int fds[2];
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], text, sizeof text) == sizeof text,
+         "write %zu bytes", sizeof text);
+  CHECK (read (fds[0], buf, sizeof buf) == sizeof text,
+         "read %zu bytes", sizeof text);
+  if (memcmp (buf, text, sizeof text))
+    fail ("read back \"%s\" instead of \"%s\"", buf, text);
+  msg ("read back \"%s\"", buf);
+  close (fds[0]);
+  close (fds[1]);
+}
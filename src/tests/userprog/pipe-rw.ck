@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-rw) begin
+(pipe-rw) pipe
+(pipe-rw) write 17 bytes
+(pipe-rw) read 17 bytes
+(pipe-rw) read back "through the pipe"
+(pipe-rw) end
+pipe-rw: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Fills a pipe, closes its write end, and runs child-pipe-read
+   with its stdin on the pipe.  The child reads until end of file
+   and exits with the number of bytes it read. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  static const char text[] = "read me from stdin";
+  int fds[2];
+  pid_t child;
+
+  CHECK (pipe (fds) == 0, "pipe");
+  CHECK (write (fds[1], text, sizeof text - 1) == sizeof text - 1,
+         "write %zu bytes", sizeof text - 1);
+  close (fds[1]);
+  CHECK (dup2 (fds[0], STDIN_FILENO) == STDIN_FILENO, "dup2 pipe to stdin");
+  close (fds[0]);
+  msg ("exec child-pipe-read");
+  if ((child = exec ("child-pipe-read")) == -1)
+    fail ("exec child-pipe-read");
+  CHECK (wait (child) == sizeof text - 1, "wait for child");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pipe-stdin) begin
+(pipe-stdin) pipe
+(pipe-stdin) write 18 bytes
+(pipe-stdin) dup2 pipe to stdin
+(pipe-stdin) exec child-pipe-read
+(child-pipe-read) read "read me from stdin"
+child-pipe-read: exit(18)
+(pipe-stdin) wait for child
+(pipe-stdin) end
+pipe-stdin: exit(0)
+EOF
+pass;
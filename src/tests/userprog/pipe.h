@@ -0,0 +1,11 @@
+#ifndef TESTS_USERPROG_PIPE_H
+#define TESTS_USERPROG_PIPE_H
+
+/* Bytes that child-pipe-write sends, several times the size of a
+   pipe's buffer. */
+#define PIPE_BIG 12288
+
+/* Byte I of what child-pipe-write sends. */
+#define PIPE_PATTERN(I) ((char) ((I) % 251))
+
+#endif /* tests/userprog/pipe.h */
@@ -0,0 +1,36 @@
+/* Grows the heap with sbrk() and checks that the new pages read
+   as zeros and keep what is written to them. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_CNT 3
+#define PGSIZE 4096
+
+void
+test_main (void) 
+{
+  char *old_break = sbrk (0);
+  char *heap;
+  size_t i;
+
+  CHECK ((heap = sbrk (PAGE_CNT * PGSIZE)) == old_break,
+         "sbrk (%d)", PAGE_CNT * PGSIZE);
+  CHECK ((char *) sbrk (0) == heap + PAGE_CNT * PGSIZE,
+         "break moved by %d bytes", PAGE_CNT * PGSIZE);
+
+  for (i = 0; i < PAGE_CNT * PGSIZE; i++)
+    if (heap[i] != 0)
+      fail ("byte %zu of new heap is %d, not 0", i, heap[i]);
+  msg ("new heap reads as zeros");
+
+  for (i = 0; i < PAGE_CNT * PGSIZE; i++)
+    heap[i] = i % 251;
+  for (i = 0; i < PAGE_CNT * PGSIZE; i++)
+    if (heap[i] != (char) (i % 251))
+      fail ("byte %zu of heap changed", i);
+  msg ("heap keeps its contents");
+}
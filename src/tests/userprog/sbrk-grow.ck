@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk-grow) begin
+(sbrk-grow) sbrk (12288)
+(sbrk-grow) break moved by 12288 bytes
+(sbrk-grow) new heap reads as zeros
+(sbrk-grow) heap keeps its contents
+(sbrk-grow) end
+sbrk-grow: exit(0)
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Passes heap pages that the process has never touched to read()
+   and write().  The kernel must map them; it may not fail the
+   call or kill the process. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+
+void
+test_main (void) 
+{
+  char zeros[100];
+  char *heap;
+  char *buf;
+  int handle, byte_cnt;
+
+  heap = sbrk (4 * PGSIZE);
+  CHECK (heap != (void *) -1, "sbrk (%d)", 4 * PGSIZE);
+
+  /* A buffer that straddles two untouched pages. */
+  buf = (char *) (((uintptr_t) heap + 2 * PGSIZE) & ~(PGSIZE - 1)) - 100;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  byte_cnt = read (handle, buf, sizeof sample - 1);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("read() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  compare_bytes (buf, sample, sizeof sample - 1, 0, "sample.txt");
+  msg ("read into untouched heap pages");
+  close (handle);
+
+  /* Write from the last page, also untouched, which holds
+     zeros. */
+  buf = heap + 4 * PGSIZE - sizeof zeros;
+  CHECK (create ("zeros", sizeof zeros), "create \"zeros\"");
+  CHECK ((handle = open ("zeros")) > 1, "open \"zeros\"");
+  byte_cnt = write (handle, buf, sizeof zeros);
+  if (byte_cnt != sizeof zeros)
+    fail ("write() returned %d instead of %zu", byte_cnt, sizeof zeros);
+  msg ("wrote from an untouched heap page");
+  close (handle);
+
+  memset (zeros, 0, sizeof zeros);
+  check_file ("zeros", zeros, sizeof zeros);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sbrk-rw) begin
+(sbrk-rw) sbrk (16384)
+(sbrk-rw) open "sample.txt"
+(sbrk-rw) read into untouched heap pages
+(sbrk-rw) create "zeros"
+(sbrk-rw) open "zeros"
+(sbrk-rw) wrote from an untouched heap page
+(sbrk-rw) open "zeros" for verification
+(sbrk-rw) verified contents of "zeros"
+(sbrk-rw) close "zeros"
+(sbrk-rw) end
+sbrk-rw: exit(0)
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Grows the heap by two pages, shrinks it by one, and checks
+   that the first page is intact, that the heap cannot shrink
+   below its start, and that touching the page given back
+   terminates the process with exit code -1. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PGSIZE 4096
+
+void
+test_main (void) 
+{
+  uintptr_t old_break = (uintptr_t) sbrk (0);
+  char *heap;
+
+  /* Start on a page boundary, so that shrinking by a page
+     frees a whole page. */
+  sbrk (((old_break + PGSIZE - 1) & ~(PGSIZE - 1)) - old_break);
+  heap = sbrk (2 * PGSIZE);
+  CHECK (heap != (void *) -1, "sbrk (%d)", 2 * PGSIZE);
+  heap[0] = 'a';
+  heap[PGSIZE] = 'b';
+
+  CHECK (sbrk (-PGSIZE) == heap + 2 * PGSIZE, "sbrk (%d)", -PGSIZE);
+  CHECK (sbrk (0) == heap + PGSIZE, "break moved back by %d bytes", PGSIZE);
+  CHECK (heap[0] == 'a', "first page intact");
+  CHECK (sbrk (-2 * PGSIZE) == (void *) -1,
+         "sbrk below the heap start fails");
+
+  msg ("touching the page given back");
+  msg ("read '%c'", heap[PGSIZE]);
+  fail ("should have exited with -1");
+}
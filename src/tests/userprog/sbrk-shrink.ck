@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(sbrk-shrink) begin
+(sbrk-shrink) sbrk (8192)
+(sbrk-shrink) sbrk (-4096)
+(sbrk-shrink) break moved back by 4096 bytes
+(sbrk-shrink) first page intact
+(sbrk-shrink) sbrk below the heap start fails
+(sbrk-shrink) touching the page given back
+sbrk-shrink: exit(-1)
+EOF
+pass;
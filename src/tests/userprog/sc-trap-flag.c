@@ -0,0 +1,42 @@
+/* Sets the trap flag (TF) and makes a system call through
+   sysenter, which leaves TF set on entry to the kernel.  The
+   resulting debug exception in kernel mode must not crash the
+   kernel: the call must complete, and the process goes on with
+   TF clear. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FLAG_TF 0x100
+
+static const char text[] = "(sc-trap-flag) wrote with TF set\n";
+
+void
+test_main (void) 
+{
+  uint32_t eax, ebx, ecx, edx, eflags;
+  int retval;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  if (!(edx & (1 << 11)))
+    {
+      msg ("CPU has no sysenter");
+      return;
+    }
+
+  /* The popfl sets TF, so the single-step trap follows the next
+     instruction, sysenter, and arrives in the kernel. */
+  asm volatile ("movl %%esp, %%ecx; movl $1f, %%edx;"
+                "pushfl; orl %[tf], (%%esp); popfl; sysenter; 1:"
+                : "=a" (retval)
+                : "a" (SYS_WRITE), "b" (STDOUT_FILENO),
+                  "S" (text), "D" (sizeof text - 1), [tf] "i" (FLAG_TF)
+                : "ecx", "edx", "cc", "memory");
+  CHECK (retval == sizeof text - 1, "write returned %d", retval);
+
+  asm volatile ("pushfl; popl %0" : "=g" (eflags));
+  CHECK (!(eflags & FLAG_TF), "TF is clear");
+}
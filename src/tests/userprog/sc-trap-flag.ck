@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(sc-trap-flag) begin
+(sc-trap-flag) wrote with TF set
+(sc-trap-flag) write returned 33
+(sc-trap-flag) TF is clear
+(sc-trap-flag) end
+sc-trap-flag: exit(0)
+EOF
+(sc-trap-flag) begin
+(sc-trap-flag) CPU has no sysenter
+(sc-trap-flag) end
+sc-trap-flag: exit(0)
+EOF
+pass;
@@ -0,0 +1,20 @@
+/* Runs a child that creates a segment and exits without
+   unmapping it.  The child held the only reference, so exiting
+   must free the segment, and opening it by name must then fail
+   instead of finding what the child stored. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t child;
+
+  msg ("exec child-shm");
+  if ((child = exec ("child-shm shm-exit")) == -1)
+    fail ("exec child-shm");
+  CHECK (wait (child) == 0, "wait for child");
+  CHECK (shm_open ("shm-exit", 0) == -1, "segment is gone");
+}
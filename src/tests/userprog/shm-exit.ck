@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-exit) begin
+(shm-exit) exec child-shm
+(child-shm) found ""
+child-shm: exit(0)
+(shm-exit) wait for child
+(shm-exit) segment is gone
+(shm-exit) end
+shm-exit: exit(0)
+EOF
+pass;
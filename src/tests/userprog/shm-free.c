@@ -0,0 +1,28 @@
+/* Unmaps a segment that no other process has open, which must
+   free it.  Opening the name again creates a new, zeroed
+   segment. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *p;
+  int id;
+  int i;
+
+  CHECK ((id = shm_open ("shm-free", 4096)) != -1, "shm_open");
+  CHECK ((p = shm_map (id)) != NULL, "shm_map");
+  for (i = 0; i < 4096; i++)
+    p[i] = 0xaa;
+  CHECK (shm_unmap (p), "shm_unmap");
+  CHECK (shm_open ("shm-free", 0) == -1, "segment is gone");
+  CHECK ((id = shm_open ("shm-free", 4096)) != -1, "shm_open again");
+  CHECK ((p = shm_map (id)) != NULL, "shm_map again");
+  for (i = 0; i < 4096; i++)
+    if (p[i] != 0)
+      fail ("byte %d of new segment is %d", i, p[i]);
+  msg ("new segment is zeroed");
+}
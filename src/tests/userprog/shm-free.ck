@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-free) begin
+(shm-free) shm_open
+(shm-free) shm_map
+(shm-free) shm_unmap
+(shm-free) segment is gone
+(shm-free) shm_open again
+(shm-free) shm_map again
+(shm-free) new segment is zeroed
+(shm-free) end
+shm-free: exit(0)
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Maps a segment twice, which must return the same address,
+   then unmaps it and checks that it cannot be mapped or unmapped
+   again without opening it anew.  Opening it anew maps it at the
+   window's lowest free address, where it was before. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *p, *q;
+  int id;
+
+  CHECK ((id = shm_open ("shm-remap", 8192)) != -1, "shm_open");
+  CHECK ((p = shm_map (id)) != NULL, "shm_map");
+  CHECK (shm_map (id) == p, "shm_map again returns same address");
+  p[0] = p[8191] = 'x';
+  CHECK (shm_unmap (p), "shm_unmap");
+  CHECK (shm_map (id) == NULL, "shm_map after unmap fails");
+  CHECK (!shm_unmap (p), "shm_unmap after unmap fails");
+  CHECK ((id = shm_open ("shm-remap", 8192)) != -1, "shm_open again");
+  CHECK ((q = shm_map (id)) == p, "shm_map again returns old address");
+  CHECK (q[0] == 0 && q[8191] == 0, "new segment is zeroed");
+}
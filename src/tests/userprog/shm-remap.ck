@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-remap) begin
+(shm-remap) shm_open
+(shm-remap) shm_map
+(shm-remap) shm_map again returns same address
+(shm-remap) shm_unmap
+(shm-remap) shm_map after unmap fails
+(shm-remap) shm_unmap after unmap fails
+(shm-remap) shm_open again
+(shm-remap) shm_map again returns old address
+(shm-remap) new segment is zeroed
+(shm-remap) end
+shm-remap: exit(0)
+EOF
+pass;
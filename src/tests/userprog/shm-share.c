@@ -0,0 +1,28 @@
+/* Shares a segment with a child process.  The child sees what
+   this process stored, and this process sees what the child
+   stored in return, even after the child has exited. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  pid_t child;
+  char *p;
+  int id;
+
+  CHECK ((id = shm_open ("shm-share", 4096)) != -1, "shm_open");
+  CHECK ((p = shm_map (id)) != NULL, "shm_map");
+  strlcpy (p, "from parent", 4096);
+  msg ("exec child-shm");
+  if ((child = exec ("child-shm shm-share")) == -1)
+    fail ("exec child-shm");
+  CHECK (wait (child) == 0, "wait for child");
+  if (strcmp (p, "from child"))
+    fail ("segment holds \"%s\"", p);
+  msg ("child stored \"%s\"", p);
+  CHECK (shm_unmap (p), "shm_unmap");
+}
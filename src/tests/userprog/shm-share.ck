@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(shm-share) begin
+(shm-share) shm_open
+(shm-share) shm_map
+(shm-share) exec child-shm
+(child-shm) found "from parent"
+child-shm: exit(0)
+(shm-share) wait for child
+(shm-share) child stored "from child"
+(shm-share) shm_unmap
+(shm-share) end
+shm-share: exit(0)
+EOF
+pass;
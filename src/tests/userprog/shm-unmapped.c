@@ -0,0 +1,22 @@
+/* Touches a segment's address after unmapping it.  The page
+   must be gone, so the process must be terminated with -1 exit
+   code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char *p;
+  int id;
+
+  CHECK ((id = shm_open ("shm-unmapped", 4096)) != -1, "shm_open");
+  CHECK ((p = shm_map (id)) != NULL, "shm_map");
+  p[0] = 'x';
+  CHECK (shm_unmap (p), "shm_unmap");
+  msg ("touch unmapped page");
+  *(volatile char *) p = 'y';
+  fail ("should have exited with -1");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(shm-unmapped) begin
+(shm-unmapped) shm_open
+(shm-unmapped) shm_map
+(shm-unmapped) shm_unmap
+(shm-unmapped) touch unmapped page
+shm-unmapped: exit(-1)
+EOF
+pass;
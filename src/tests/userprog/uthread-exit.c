@@ -0,0 +1,26 @@
+/* Calls exit() from a thread other than the first.  That must
+   end the whole process with the thread's exit code, including
+   the first thread, asleep joining the other. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+call_exit (void *aux UNUSED) 
+{
+  msg ("thread calls exit");
+  exit (57);
+}
+
+void
+test_main (void) 
+{
+  int tid;
+
+  msg ("create thread");
+  if ((tid = uthread_create (call_exit, NULL)) == -1)
+    fail ("uthread_create");
+  uthread_join (tid);
+  fail ("should have exited with 57");
+}
@@ -0,0 +1,27 @@
+/* Dereferences a null pointer in a thread other than the first.
+   That must kill the whole process with -1 exit code, including
+   the first thread, asleep joining the other. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+fault (void *aux UNUSED) 
+{
+  msg ("thread faults");
+  *(volatile int *) NULL = 42;
+  fail ("should have exited with -1");
+}
+
+void
+test_main (void) 
+{
+  int tid;
+
+  msg ("create thread");
+  if ((tid = uthread_create (fault, NULL)) == -1)
+    fail ("uthread_create");
+  uthread_join (tid);
+  fail ("should have exited with -1");
+}
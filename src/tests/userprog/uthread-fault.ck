@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(uthread-fault) begin
+(uthread-fault) create thread
+(uthread-fault) thread faults
+uthread-fault: exit(-1)
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Starts a thread in this process and joins it.  The thread
+   sees its argument and stores through it, and joining returns
+   only after the thread is done.  A thread may be joined only
+   once. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+store_answer (void *aux) 
+{
+  int *answer = aux;
+
+  msg ("thread running");
+  *answer = 42;
+}
+
+void
+test_main (void) 
+{
+  static volatile int answer;
+  int tid;
+
+  msg ("create thread");
+  if ((tid = uthread_create (store_answer, (void *) &answer)) == -1)
+    fail ("uthread_create");
+  CHECK (uthread_join (tid) == tid, "join thread");
+  CHECK (answer == 42, "thread stored %d", answer);
+  CHECK (uthread_join (tid) == -1, "join it again");
+}
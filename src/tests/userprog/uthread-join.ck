@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-join) begin
+(uthread-join) create thread
+(uthread-join) thread running
+(uthread-join) join thread
+(uthread-join) thread stored 42
+(uthread-join) join it again
+(uthread-join) end
+uthread-join: exit(0)
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Creates threads until uthread_create() fails, which it must do
+   at the latest when every thread stack slot is in use, then
+   joins them all.  Their stacks must then be free for new
+   threads. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MAX_THREADS 1000
+
+static volatile bool go;
+
+static void
+wait_for_go (void *aux UNUSED) 
+{
+  while (!go)
+    uthread_yield ();
+}
+
+void
+test_main (void) 
+{
+  static int tids[MAX_THREADS];
+  int thread_cnt;
+  int i;
+
+  msg ("create threads until one fails");
+  for (thread_cnt = 0; thread_cnt < MAX_THREADS; thread_cnt++)
+    if ((tids[thread_cnt] = uthread_create (wait_for_go, NULL)) == -1)
+      break;
+  if (thread_cnt == 0 || thread_cnt == MAX_THREADS)
+    fail ("created %d threads", thread_cnt);
+
+  msg ("join them all");
+  go = true;
+  for (i = 0; i < thread_cnt; i++)
+    if (uthread_join (tids[i]) != tids[i])
+      fail ("join of thread %d failed", i);
+
+  msg ("create and join one more");
+  if ((tids[0] = uthread_create (wait_for_go, NULL)) == -1)
+    fail ("uthread_create failed after joining");
+  if (uthread_join (tids[0]) != tids[0])
+    fail ("join failed");
+}
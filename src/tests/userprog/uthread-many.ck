@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(uthread-many) begin
+(uthread-many) create threads until one fails
+(uthread-many) join them all
+(uthread-many) create and join one more
+(uthread-many) end
+uthread-many: exit(0)
+EOF
+pass;
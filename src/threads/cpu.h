@@ -0,0 +1,90 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* CPU identification and model-specific registers.
+   See [IA32-v2a] "CPUID--CPU Identification" and [IA32-v3b]
+   appendix B "Model-Specific Registers (MSRs)". */
+
+/* CPUID leaf 1 EDX feature bits. */
+#define CPUID_PSE   (1 << 3)            /* 4 MB pages. */
+#define CPUID_TSC   (1 << 4)            /* Time-stamp counter. */
+#define CPUID_MSR   (1 << 5)            /* rdmsr/wrmsr. */
+#define CPUID_APIC  (1 << 9)            /* Local APIC. */
+#define CPUID_SEP   (1 << 11)           /* sysenter/sysexit. */
+#define CPUID_PGE   (1 << 13)           /* Global pages. */
+
+/* CR4 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR4_PSE     (1 << 4)            /* 4 MB pages. */
+#define CR4_PGE     (1 << 7)            /* Global pages. */
+
+/* Model-specific registers. */
+#define MSR_SYSENTER_CS  0x174          /* sysenter code segment. */
+#define MSR_SYSENTER_ESP 0x175          /* sysenter stack pointer. */
+#define MSR_SYSENTER_EIP 0x176          /* sysenter entry point. */
+
+/* Executes CPUID with EAX = LEAF and stores the results. */
+static inline void
+cpuid (uint32_t leaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx,
+       uint32_t *edx)
+{
+  asm volatile ("cpuid"
+                : "=a" (*eax), "=b" (*ebx), "=c" (*ecx), "=d" (*edx)
+                : "a" (leaf));
+}
+
+/* Returns true if the CPU has all of the CPUID leaf 1 EDX
+   FEATURES.  Every CPU Pintos runs on has CPUID. */
+static inline bool
+cpu_has (uint32_t features)
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  cpuid (1, &eax, &ebx, &ecx, &edx);
+  return (edx & features) == features;
+}
+
+/* Reads model-specific register MSR. */
+static inline uint64_t
+rdmsr (uint32_t msr)
+{
+  uint64_t value;
+  asm volatile ("rdmsr" : "=A" (value) : "c" (msr));
+  return value;
+}
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Returns control register CR4. */
+static inline uint32_t
+read_cr4 (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Sets control register CR4 to CR4. */
+static inline void
+write_cr4 (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Returns the time-stamp counter, which counts CPU cycles. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* threads/cpu.h */
@@ -15,13 +15,16 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -34,9 +37,11 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #include "filesys/cache.h"
+#include "filesys/dedup.h"
 #endif
 
 /* Page directory with kernel mappings only. */
@@ -53,11 +58,19 @@ static const char *scratch_bdev_name;
 #ifdef VM
 static const char *swap_bdev_name;
 #endif
+
+/* -ramdisk: Size of RAM disk to create, in kB, or 0 for none.
+   -ramdisk-load: Copy the scratch device into it at boot? */
+static size_t ramdisk_kb;
+static bool ramdisk_load_scratch;
 #endif /* FILESYS */
 
 /* -ul: Maximum number of pages to put into palloc's user pool. */
 static size_t user_page_limit = SIZE_MAX;
 
+/* -smallpages: Map the kernel with ordinary 4 kB pages only? */
+static bool small_pages;
+
 static void bss_init (void);
 static void paging_init (void);
 
@@ -99,6 +112,8 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  smp_init ();
+  trace_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -120,11 +135,27 @@ main (void)
   thread_start ();
   serial_init_queue ();
   timer_calibrate ();
+  smp_start ();
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
-  locate_block_devices ();
+  if (ramdisk_kb > 0)
+    {
+      struct block *ramdisk = ramdisk_init (ramdisk_kb * 1024
+                                            / BLOCK_SECTOR_SIZE);
+      if (filesys_bdev_name == NULL)
+        filesys_bdev_name = block_name (ramdisk);
+      locate_block_devices ();
+      if (ramdisk_load_scratch)
+        {
+          if (block_get_role (BLOCK_SCRATCH) == NULL)
+            PANIC ("-ramdisk-load: no scratch device");
+          ramdisk_load (ramdisk, block_get_role (BLOCK_SCRATCH));
+        }
+    }
+  else
+    locate_block_devices ();
   filesys_init (format_filesys);
 #endif
 
@@ -158,13 +189,30 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports them, each whole 4 MB of RAM that holds
+   no kernel text is mapped with a single large page, which
+   takes one TLB entry instead of 1024, and every kernel
+   mapping is global, so that its TLB entries survive the CR3
+   reload on each switch between processes.  The kernel text
+   keeps 4 kB pages so that it stays read-only. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  bool large_pages = !small_pages && cpu_has (CPUID_PSE);
+  uint32_t global = 0;
+
+  if (large_pages)
+    write_cr4 (read_cr4 () | CR4_PSE);
+  if (!small_pages && cpu_has (CPUID_PGE))
+    {
+      write_cr4 (read_cr4 () | CR4_PGE);
+      global = PTE_G;
+    }
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -176,13 +224,22 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large_pages && pte_idx == 0
+          && init_ram_pages - page >= PTSPAN / PGSIZE
+          && (&_end_kernel_text <= vaddr || vaddr + PTSPAN <= &_start))
+        {
+          pd[pde_idx] = pde_create_large (vaddr) | global;
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | global;
     }
 
   /* Store the physical address of the page directory into CR3
@@ -252,6 +309,12 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-dedup"))
+        dedup_enabled = true;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_kb = atoi (value);
+      else if (!strcmp (name, "-ramdisk-load"))
+        ramdisk_load_scratch = true;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -261,6 +324,12 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-trace"))
+        trace_pages = value != NULL ? atoi (value) : 64;
+      else if (!strcmp (name, "-smallpages"))
+        small_pages = true;
+      else if (!strcmp (name, "-smp"))
+        smp_cpu_limit = atoi (value);
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -378,12 +447,20 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -dedup             Share identical file system data sectors.\n"
+          "  -ramdisk=KB        Keep the file system on a KB kB RAM disk.\n"
+          "  -ramdisk-load      With -ramdisk, copy the scratch device onto\n"
+          "                     the RAM disk at boot.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -trace[=PAGES]     Trace kernel events into PAGES pages (default\n"
+          "                     64), saved to the scratch device.\n"
+          "  -smallpages        Map kernel memory with 4 kB non-global pages.\n"
+          "  -smp=N             Use at most N CPUs (default all, up to 8).\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
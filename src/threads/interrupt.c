@@ -6,9 +6,14 @@
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
+#ifdef USERPROG
+#include "userprog/process.h"
+#endif
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -38,20 +43,34 @@ static const char *intr_names[INTR_CNT];
 static unsigned int unexpected_cnt[INTR_CNT];
 
 /* External interrupts are those generated by devices outside the
-   CPU, such as the timer.  External interrupts run with
-   interrupts turned off, so they never nest, nor are they ever
-   pre-empted.  Handlers for external interrupts also may not
-   sleep, although they may invoke intr_yield_on_return() to
-   request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   CPU, such as the timer, and interprocessor interrupts (IPIs)
+   from other CPUs.  External interrupts run with interrupts
+   turned off, so they never nest, nor are they ever pre-empted.
+   Handlers for external interrupts also may not sleep, although
+   they may invoke intr_yield_on_return() to request that a new
+   process be scheduled just before the interrupt returns.  The
+   state for this is per CPU, in struct cpu.
+
+   Device interrupts come through the PICs, on vectors
+   0x20...0x2f, and IPIs through the local APIC, on vectors
+   0xf0...0xfe. */
+#define IPI_MIN 0xf0
+#define IPI_MAX 0xfe
+
+/* Returns true if VEC_NO is an external interrupt. */
+static inline bool
+is_external (uint8_t vec_no)
+{
+  return ((vec_no >= 0x20 && vec_no <= 0x2f)
+          || (vec_no >= IPI_MIN && vec_no <= IPI_MAX));
+}
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
 
 /* Interrupt Descriptor Table helpers. */
+static void load_idt (void);
 static uint64_t make_intr_gate (void (*) (void), int dpl);
 static uint64_t make_trap_gate (void (*) (void), int dpl);
 static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
@@ -117,7 +136,6 @@ intr_disable (void)
 void
 intr_init (void)
 {
-  uint64_t idtr_operand;
   int i;
 
   /* Initialize interrupt controller. */
@@ -126,12 +144,7 @@ intr_init (void)
   /* Initialize IDT. */
   for (i = 0; i < INTR_CNT; i++)
     idt[i] = make_intr_gate (intr_stubs[i], 0);
-
-  /* Load IDT register.
-     See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
-     Descriptor Table (IDT)". */
-  idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
-  asm volatile ("lidt %0" : : "m" (idtr_operand));
+  load_idt ();
 
   /* Initialize intr_names. */
   for (i = 0; i < INTR_CNT; i++)
@@ -157,6 +170,25 @@ intr_init (void)
   intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Points a CPU other than the boot CPU at the IDT that
+   intr_init() built.  The IDT is shared, so handlers registered
+   later apply to every CPU. */
+void
+intr_init_ap (void)
+{
+  load_idt ();
+}
+
+/* Loads the IDT register.
+   See [IA32-v2a] "LIDT" and [IA32-v3a] 5.10 "Interrupt
+   Descriptor Table (IDT)". */
+static void
+load_idt (void)
+{
+  uint64_t idtr_operand = make_idtr_operand (sizeof idt - 1, idt);
+  asm volatile ("lidt %0" : : "m" (idtr_operand));
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -181,7 +213,7 @@ void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
                    const char *name) 
 {
-  ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+  ASSERT (is_external (vec_no));
   register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -202,16 +234,20 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
                    intr_handler_func *handler, const char *name)
 {
-  ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+  ASSERT (!is_external (vec_no));
   register_handler (vec_no, dpl, level, handler, name);
 }
 
 /* Returns true during processing of an external interrupt
-   and false at all other times. */
+   and false at all other times.  External interrupts run with
+   interrupts off, so with them on the answer is false, whichever
+   CPU the caller is on. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  if (intr_get_level () == INTR_ON)
+    return false;
+  return cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -222,7 +258,7 @@ void
 intr_yield_on_return (void) 
 {
   ASSERT (intr_context ());
-  yield_on_return = true;
+  cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -346,26 +382,42 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  struct cpu *c = NULL;
+
+  /* A TLB flush IPI comes from a CPU that holds the kernel lock
+     and is waiting for us, so it must be served without it. */
+  if (frame->vec_no == IPI_TLB_FLUSH)
+    {
+      smp_tlb_interrupt ();
+      return;
+    }
+
+  /* Interrupts from user mode, and the one that ends an idle
+     CPU's halt, arrive without the kernel lock; others find this
+     CPU already holding it.  See smp.c. */
+  kernel_lock_acquire ();
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
-     and they need to be acknowledged on the PIC (see below).
-     An external interrupt handler cannot sleep. */
-  external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+     and they need to be acknowledged on the PIC or local APIC
+     (see below).  An external interrupt handler cannot sleep. */
+  external = is_external (frame->vec_no);
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (!intr_context ());
 
-      in_external_intr = true;
-      yield_on_return = false;
+      c = cpu_current ();
+      c->in_external_intr = true;
+      c->yield_on_return = false;
     }
 
   /* Invoke the interrupt's handler. */
   handler = intr_handlers[frame->vec_no];
   if (handler != NULL)
     handler (frame);
-  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f)
+  else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+           || frame->vec_no == LAPIC_SPURIOUS)
     {
       /* There is no handler, but this interrupt can trigger
          spuriously due to a hardware fault or hardware race
@@ -380,12 +432,29 @@ intr_handler (struct intr_frame *frame)
       ASSERT (intr_get_level () == INTR_OFF);
       ASSERT (intr_context ());
 
-      in_external_intr = false;
-      pic_end_of_interrupt (frame->vec_no); 
+      c->in_external_intr = false;
+      if (frame->vec_no <= 0x2f)
+        pic_end_of_interrupt (frame->vec_no); 
+      else
+        lapic_eoi ();
 
-      if (yield_on_return) 
+      if (c->yield_on_return) 
         thread_yield (); 
     }
+
+  /* Give up the kernel lock on the way back to user mode, keeping
+     interrupts off until the return so that nothing can enter the
+     kernel on this CPU in between. */
+  if ((frame->cs & 3) != 0)
+    {
+#ifdef USERPROG
+      /* Another thread of the process may have called exit(). */
+      if (process_exiting ())
+        thread_exit ();
+#endif
+      intr_disable ();
+      kernel_lock_release ();
+    }
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -5,7 +5,9 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -28,19 +30,38 @@
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
+   The free list, with its lock, is shared by all CPUs.  In front
+   of it, each CPU keeps a "magazine" of up to MAG_SIZE free
+   blocks of each size, which it allocates from and frees to with
+   interrupts off but without taking the lock.  Only when a
+   magazine runs empty or full does the CPU take the lock, to
+   move a batch of MAG_BATCH blocks between it and the free list.
+   Blocks in magazines count as in use, so an arena stays
+   allocated while any of its blocks is in one.
+
    We can't handle blocks bigger than 2 kB using this scheme,
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
    the beginning of the allocated block's arena header. */
 
+/* Per-CPU cache of free blocks. */
+#define MAG_SIZE 16             /* Most blocks in a magazine. */
+#define MAG_BATCH 8             /* Blocks moved to or from free list. */
+struct magazine
+  {
+    size_t cnt;                 /* Number of blocks in rounds[]. */
+    struct block *rounds[MAG_SIZE];     /* Free blocks. */
+  };
+
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    struct magazine mags[CPU_MAX];      /* Magazine for each CPU. */
     struct list free_list;      /* List of free blocks. */
-    struct lock lock;           /* Lock. */
+    struct lock lock;           /* Lock on free_list and arenas. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -66,6 +87,12 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *mag_get (struct desc *);
+static bool mag_put (struct desc *, struct block *);
+static struct block *free_list_get (struct desc *);
+static void free_list_put (struct desc *, struct block *);
+static struct block *depot_get (struct desc *);
+static void depot_put (struct desc *, struct block *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -119,37 +146,11 @@ malloc (size_t size)
       return a + 1;
     }
 
-  lock_acquire (&d->lock);
-
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
-    {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
-
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
-    }
-
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
+  /* Take a block from this CPU's magazine, refilling it from
+     the free list if it is empty. */
+  b = mag_get (d);
+  if (b == NULL)
+    b = depot_get (d);
   return b;
 }
 
@@ -233,26 +234,10 @@ free (void *p)
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
-            {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
-            }
-
-          lock_release (&d->lock);
+          /* Put the block in this CPU's magazine, making room by
+             moving blocks to the free list if it is full. */
+          if (!mag_put (d, b))
+            depot_put (d, b);
         }
       else
         {
@@ -263,6 +248,148 @@ free (void *p)
     }
 }
 
+/* Removes and returns a block from the running CPU's magazine
+   for D, or returns a null pointer if it is empty. */
+static struct block *
+mag_get (struct desc *d) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct magazine *m = &d->mags[cpu_current ()->id];
+  struct block *b = m->cnt > 0 ? m->rounds[--m->cnt] : NULL;
+  intr_set_level (old_level);
+  return b;
+}
+
+/* Adds B to the running CPU's magazine for D and returns true,
+   or returns false if it is full. */
+static bool
+mag_put (struct desc *d, struct block *b) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct magazine *m = &d->mags[cpu_current ()->id];
+  bool ok = m->cnt < MAG_SIZE;
+  if (ok)
+    m->rounds[m->cnt++] = b;
+  intr_set_level (old_level);
+  return ok;
+}
+
+/* Removes and returns a block from D's free list, creating a new
+   arena if the list is empty, or returns a null pointer if
+   memory is not available.  D's lock must be held. */
+static struct block *
+free_list_get (struct desc *d) 
+{
+  struct block *b;
+  struct arena *a;
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL) 
+        return NULL; 
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+    }
+
+  /* Get a block from free list. */
+  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+  a = block_to_arena (b);
+  a->free_cnt--;
+  return b;
+}
+
+/* Adds B to D's free list, freeing its arena if that leaves the
+   arena with no blocks in use.  D's lock must be held. */
+static void
+free_list_put (struct desc *d, struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  ASSERT (lock_held_by_current_thread (&d->lock));
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      palloc_free_page (a);
+    }
+}
+
+/* Returns a block from D's free list, and moves up to
+   MAG_BATCH - 1 more blocks already on the list into the running
+   CPU's magazine, so that the next allocations need no lock.
+   Returns a null pointer if memory is not available. */
+static struct block *
+depot_get (struct desc *d) 
+{
+  struct block *b;
+
+  lock_acquire (&d->lock);
+  b = free_list_get (d);
+  if (b != NULL)
+    {
+      enum intr_level old_level = intr_disable ();
+      struct magazine *m = &d->mags[cpu_current ()->id];
+      size_t i;
+
+      for (i = 1; i < MAG_BATCH && m->cnt < MAG_SIZE
+             && !list_empty (&d->free_list); i++)
+        m->rounds[m->cnt++] = free_list_get (d);
+      intr_set_level (old_level);
+    }
+  lock_release (&d->lock);
+  return b;
+}
+
+/* Adds B to D's free list, along with up to MAG_BATCH - 1 blocks
+   from the running CPU's magazine, which is full, to make room
+   there for later frees. */
+static void
+depot_put (struct desc *d, struct block *b) 
+{
+  struct block *batch[MAG_BATCH];
+  enum intr_level old_level;
+  struct magazine *m;
+  size_t cnt, i;
+
+  batch[0] = b;
+  old_level = intr_disable ();
+  m = &d->mags[cpu_current ()->id];
+  for (cnt = 1; cnt < MAG_BATCH && m->cnt > 0; cnt++)
+    batch[cnt] = m->rounds[--m->cnt];
+  intr_set_level (old_level);
+
+  lock_acquire (&d->lock);
+  for (i = 0; i < cnt; i++)
+    free_list_put (d, batch[i]);
+  lock_release (&d->lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
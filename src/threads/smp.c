@@ -0,0 +1,481 @@
+#include "threads/smp.h"
+#include <debug.h>
+#include <packed.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/cpu.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/spinlock.h"
+#include "threads/thread.h"
+#include "threads/trace.h"
+#include "threads/vaddr.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/tss.h"
+#endif
+
+/* Multiprocessor support.
+
+   smp_init() finds the other CPUs in the BIOS's MP configuration
+   table, as described by the Intel MultiProcessor Specification
+   [MP], and smp_start() starts each of them on its own idle
+   thread, from which it joins the scheduler.
+
+   Each CPU has its own run queue (see thread.c), but all run
+   kernel code under a single "kernel lock", which a CPU takes
+   when it enters the kernel from user mode or from an idle halt
+   and gives up when it returns to user mode or halts again (see
+   intr_handler() and thread.c's idle loop).  A thread that
+   sleeps keeps the lock on its CPU for the next thread.  So no
+   two CPUs ever run kernel code at the same time, and the
+   uniprocessor rule that turning interrupts off makes a critical
+   section atomic still holds.
+   User programs, on the other hand, run on all CPUs at once.
+
+   This is coarse-grained SMP, not yet a multiprocessor kernel.
+   The scheduler's run queues, palloc(), malloc(), the buffer
+   cache, and the console still rely on interrupts being off, or
+   on sleep locks built on that, and only the kernel lock makes
+   that safe across CPUs.  Until those critical sections take
+   spinlocks (spinlock.h) of their own and the kernel lock can
+   go, a workload that spends its time in the kernel runs no
+   faster on several CPUs than on one.
+
+   Code that holds the kernel lock must not busy-wait for an
+   interrupt: device interrupts arrive only on the boot CPU,
+   which cannot handle them without the lock.  Sleep instead.
+
+   Only the boot CPU gets timer interrupts.  thread_tick() uses
+   them to charge every CPU's running thread and sends the others
+   a reschedule IPI when their time slices run out.
+   thread_unblock() sends one to an idle CPU when it gives it a
+   thread that just became ready.
+
+   The threads of a user process share a page directory, so when
+   one of them changes it, the others' CPUs may still hold the
+   old entries in their TLBs.  smp_flush_tlb() sends those CPUs a
+   TLB flush IPI and waits for them.  The IPI is handled without
+   the kernel lock, which its sender holds, and a CPU that is
+   spinning for the kernel lock with interrupts off flushes as it
+   spins. */
+
+/* MP floating pointer structure.  See [MP] 4.1. */
+struct mp_fps
+  {
+    char signature[4];                  /* "_MP_". */
+    uint32_t config;                    /* Physical address of mp_config. */
+    uint8_t length;                     /* In 16-byte units. */
+    uint8_t revision;
+    uint8_t checksum;                   /* Bytes sum to 0. */
+    uint8_t features[5];                /* Nonzero features[0]: no table. */
+  }
+PACKED;
+
+/* MP configuration table header.  See [MP] 4.2. */
+struct mp_config
+  {
+    char signature[4];                  /* "PCMP". */
+    uint16_t length;                    /* Of header and entries. */
+    uint8_t revision;
+    uint8_t checksum;                   /* Bytes sum to 0. */
+    char oem[8];
+    char product[12];
+    uint32_t oem_table;
+    uint16_t oem_length;
+    uint16_t entry_cnt;                 /* Entries that follow. */
+    uint32_t lapic;                     /* Physical address of local APICs. */
+    uint16_t ext_length;
+    uint8_t ext_checksum;
+    uint8_t reserved;
+  }
+PACKED;
+
+/* MP configuration table processor entry.  See [MP] 4.3.1.
+   Other entries are 8 bytes long and of no interest to us. */
+#define MP_PROCESSOR 0
+struct mp_processor
+  {
+    uint8_t type;                       /* MP_PROCESSOR. */
+    uint8_t apic_id;                    /* Local APIC ID. */
+    uint8_t apic_version;
+    uint8_t flags;                      /* MP_ENABLED, MP_BOOT. */
+    uint32_t signature;
+    uint32_t features;
+    uint32_t reserved[2];
+  }
+PACKED;
+#define MP_ENABLED 0x01                 /* Usable. */
+#define MP_BOOT 0x02                    /* Boot CPU. */
+
+/* Physical address that ap_start is copied to.  It must be a
+   multiple of 4 kB below 1 MB that nothing else uses after
+   boot.  The loader and its stack lie below it; the initial
+   thread's page and start.S's page tables lie above. */
+#define AP_START 0x8000
+
+/* The startup code in ap-start.S, and its parameters, which
+   mirror ap_params there. */
+extern uint8_t ap_start[], ap_start_end[], ap_params[];
+struct ap_params
+  {
+    uint16_t gdt_limit;                 /* GDTR, as for lgdt. */
+    uint32_t gdt_base;
+    uint32_t cr4;                       /* CR4. */
+    uint32_t cr3;                       /* Physical address of page directory. */
+  }
+PACKED;
+
+/* Top of the stack for the AP being started, loaded by
+   ap_start32. */
+void *ap_stack;
+
+void ap_main (void) NO_RETURN;
+
+struct cpu cpus[CPU_MAX];
+unsigned cpu_cnt = 1;
+unsigned smp_cpu_limit = CPU_MAX;
+
+/* Local APIC IDs of the CPUs found by smp_init(), boot CPU
+   first. */
+static uint8_t apic_ids[CPU_MAX];
+static unsigned found_cnt;
+
+/* True once CPUs are found through the running thread.  Until
+   then cpu_current() returns the boot CPU, which lets it work
+   before thread_init(). */
+static bool smp_active;
+
+/* The kernel lock and the CPU that holds it.  The boot CPU holds
+   it from the start. */
+static struct spinlock kernel_spinlock = { 1 };
+static struct cpu *kernel_lock_holder = &cpus[0];
+
+static const struct mp_fps *find_mp (void);
+static intr_handler_func reschedule_interrupt;
+static void flush_tlb (struct cpu *);
+
+/* Finds the CPUs that the BIOS reports and maps the local APIC
+   registers.  If there is no MP configuration table, or only one
+   CPU, leaves Pintos running on the boot CPU alone.  Must be
+   called after paging_init() and before any process is
+   created. */
+void
+smp_init (void)
+{
+  const struct mp_fps *fps;
+  const struct mp_config *config;
+  const uint8_t *entry;
+  unsigned i;
+
+  cpus[0].started = true;
+  if (smp_cpu_limit < 2 || !cpu_has (CPUID_APIC))
+    return;
+  fps = find_mp ();
+  if (fps == NULL || fps->config == 0 || fps->features[0] != 0
+      || fps->config >= init_ram_pages * PGSIZE)
+    return;
+  config = ptov (fps->config);
+  if (memcmp (config->signature, "PCMP", 4))
+    return;
+
+  /* Collect the usable CPUs, putting the boot CPU first. */
+  found_cnt = 1;
+  entry = (const uint8_t *) (config + 1);
+  for (i = 0; i < config->entry_cnt; i++)
+    {
+      const struct mp_processor *p = (const struct mp_processor *) entry;
+      if (*entry != MP_PROCESSOR)
+        {
+          entry += 8;
+          continue;
+        }
+      entry += sizeof *p;
+      if (!(p->flags & MP_ENABLED))
+        continue;
+      if (p->flags & MP_BOOT)
+        apic_ids[0] = p->apic_id;
+      else if (found_cnt < smp_cpu_limit && found_cnt < CPU_MAX)
+        apic_ids[found_cnt++] = p->apic_id;
+    }
+  if (found_cnt == 1)
+    return;
+
+  lapic_map (config->lapic);
+  cpus[0].apic_id = lapic_id ();
+}
+
+/* Returns the sum of the SIZE bytes at P. */
+static uint8_t
+checksum (const void *p, size_t size)
+{
+  const uint8_t *b = p;
+  uint8_t sum = 0;
+
+  while (size-- > 0)
+    sum += *b++;
+  return sum;
+}
+
+/* Searches SIZE bytes of physical memory at PADDR for an MP
+   floating pointer structure and returns it, or a null pointer
+   if there is none. */
+static const struct mp_fps *
+scan_mp (uintptr_t paddr, size_t size)
+{
+  const struct mp_fps *p = ptov (paddr);
+  const struct mp_fps *end = ptov (paddr + size);
+
+  for (; p < end; p++)
+    if (!memcmp (p->signature, "_MP_", 4)
+        && checksum (p, sizeof *p) == 0)
+      return p;
+  return NULL;
+}
+
+/* Returns the MP floating pointer structure, or a null pointer
+   if there is none.  [MP] 4 says to look in the first kB of the
+   extended BIOS data area, in the last kB of base memory, and in
+   the BIOS ROM, in that order. */
+static const struct mp_fps *
+find_mp (void)
+{
+  uint16_t ebda_segment = *(uint16_t *) ptov (0x40e);
+  uint16_t base_kb = *(uint16_t *) ptov (0x413);
+  const struct mp_fps *fps = NULL;
+
+  if (ebda_segment != 0)
+    fps = scan_mp ((uintptr_t) ebda_segment << 4, 1024);
+  if (fps == NULL)
+    fps = scan_mp ((uintptr_t) base_kb * 1024 - 1024, 1024);
+  if (fps == NULL)
+    fps = scan_mp (0xf0000, 0x10000);
+  return fps;
+}
+
+/* Starts the CPUs that smp_init() found, one at a time, and adds
+   each to the scheduler.  Must be called from the initial
+   thread, after thread_start() and timer_calibrate(). */
+void
+smp_start (void)
+{
+  struct ap_params *params = ptov (AP_START + (ap_params - ap_start));
+  uint32_t *pd;
+  uint64_t gdtr;
+  unsigned i;
+
+  if (found_cnt < 2)
+    return;
+
+  intr_register_ext (IPI_RESCHEDULE, reschedule_interrupt, "reschedule");
+  lapic_init (true);
+  smp_active = true;
+
+  /* The page directory for starting APs is the kernel's, plus an
+     identity mapping of the first 4 MB for ap_start. */
+  pd = palloc_get_page (PAL_ASSERT);
+  memcpy (pd, init_page_dir, PGSIZE);
+  pd[0] = pd[pd_no (ptov (0))];
+
+  memcpy (ptov (AP_START), ap_start, ap_start_end - ap_start);
+  asm volatile ("sgdt %0" : "=m" (gdtr));
+  params->gdt_limit = gdtr;
+  params->gdt_base = gdtr >> 16;
+  params->cr4 = read_cr4 ();
+  params->cr3 = vtop (pd);
+
+  for (i = 1; i < found_cnt; i++)
+    {
+      struct cpu *c = &cpus[cpu_cnt];
+      struct thread *idle;
+      int64_t start;
+
+      c->id = cpu_cnt;
+      c->apic_id = apic_ids[i];
+      idle = thread_create_idle (c);
+      if (idle == NULL)
+        break;
+      trace_init_cpu (c->id);
+      ap_stack = (uint8_t *) idle + PGSIZE;
+
+      /* Sleep, rather than spin, while waiting: the AP needs the
+         kernel lock to finish starting. */
+      lapic_start_ap (c->apic_id, AP_START);
+      start = timer_ticks ();
+      while (!c->started && timer_elapsed (start) < TIMER_FREQ)
+        timer_sleep (1);
+      if (!c->started)
+        {
+          printf ("smp: CPU with APIC ID %u did not start\n",
+                  (unsigned) c->apic_id);
+          break;
+        }
+      cpu_cnt++;
+    }
+
+  palloc_free_page (pd);
+  printf ("smp: %u CPUs running\n", cpu_cnt);
+}
+
+/* Called by ap_start32 on a newly started AP, on the stack of
+   the idle thread that smp_start() created for it.  Finishes
+   setting up the CPU and becomes its idle thread. */
+void
+ap_main (void)
+{
+  struct cpu *c = cpu_current ();
+  uint32_t cr4;
+
+  /* Switch to the kernel's page directory, and flush the global
+     TLB entries that the identity mapping of low memory left
+     behind, which reloading CR3 keeps. */
+  asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)) : "memory");
+  cr4 = read_cr4 ();
+  if (cr4 & CR4_PGE)
+    {
+      write_cr4 (cr4 & ~CR4_PGE);
+      write_cr4 (cr4);
+    }
+
+  intr_init_ap ();
+  lapic_init (false);
+  kernel_lock_acquire ();
+#ifdef USERPROG
+  tss_init ();
+  gdt_init ();
+#endif
+
+  c->started = true;
+  thread_start_ap ();
+}
+
+/* Returns the CPU running the caller. */
+struct cpu *
+cpu_current (void)
+{
+  /* The running thread's struct is at the start of the page that
+     holds the stack, as in running_thread(). */
+  struct thread *t = pg_round_down (&t);
+
+  return smp_active ? t->cpu : &cpus[0];
+}
+
+/* Acquires the kernel lock for the running CPU, unless it
+   already holds it.  The check is made with interrupts off, so
+   that the caller cannot move to another CPU in the middle. */
+void
+kernel_lock_acquire (void)
+{
+  enum intr_level old_level = intr_disable ();
+  struct cpu *c = cpu_current ();
+
+  if (kernel_lock_holder != c)
+    {
+      /* The holder may be waiting for this CPU to flush its
+         TLB, which with interrupts off it can only do here. */
+      while (!spinlock_try_acquire (&kernel_spinlock))
+        {
+          if (c->tlb_stale)
+            flush_tlb (c);
+          asm volatile ("pause");
+        }
+      kernel_lock_holder = c;
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases the kernel lock, which the running CPU must hold.
+   Interrupts must be off and stay off until the CPU leaves the
+   kernel: an interrupt in between would take the lock back. */
+void
+kernel_lock_release (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (kernel_lock_holder == cpu_current ());
+
+  kernel_lock_holder = NULL;
+  spinlock_release (&kernel_spinlock);
+}
+
+/* Returns true if the running CPU holds the kernel lock. */
+bool
+kernel_lock_held (void)
+{
+  enum intr_level old_level = intr_disable ();
+  bool held = kernel_lock_holder == cpu_current ();
+  intr_set_level (old_level);
+  return held;
+}
+
+/* Makes CPU C, which must not be the running CPU, call the
+   scheduler when it can. */
+void
+smp_reschedule (struct cpu *c)
+{
+  ASSERT (c != cpu_current ());
+
+  c->woken = true;
+  lapic_send_ipi (c->apic_id, IPI_RESCHEDULE);
+}
+
+/* Reschedule IPI handler. */
+static void
+reschedule_interrupt (struct intr_frame *args UNUSED)
+{
+  intr_yield_on_return ();
+}
+
+/* Flushes the running CPU C's TLB and tells whoever asked for it
+   that it is done. */
+static void
+flush_tlb (struct cpu *c)
+{
+  uint32_t cr3;
+
+  asm volatile ("movl %%cr3, %0; movl %0, %%cr3" : "=r" (cr3) : : "memory");
+  c->tlb_stale = false;
+}
+
+/* Flushes the TLB of every other CPU that is running a thread
+   on page directory PD, and waits until they have.  The caller
+   must hold the kernel lock and have flushed its own TLB. */
+void
+smp_flush_tlb (uint32_t *pd UNUSED)
+{
+#ifdef USERPROG
+  enum intr_level old_level;
+  struct cpu *self;
+  unsigned i;
+
+  if (!smp_active || pd == NULL)
+    return;
+
+  old_level = intr_disable ();
+  self = cpu_current ();
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      if (c != self && c->started && c->thread->pagedir == pd)
+        {
+          c->tlb_stale = true;
+          lapic_send_ipi (c->apic_id, IPI_TLB_FLUSH);
+          while (c->tlb_stale)
+            asm volatile ("pause");
+        }
+    }
+  intr_set_level (old_level);
+#endif
+}
+
+/* TLB flush IPI handler.  intr_handler() calls it before taking
+   the kernel lock, since the sender holds it. */
+void
+smp_tlb_interrupt (void)
+{
+  flush_tlb (cpu_current ());
+  lapic_eoi ();
+}
@@ -0,0 +1,69 @@
+#ifndef THREADS_SMP_H
+#define THREADS_SMP_H
+
+/* Most CPUs that Pintos will use. */
+#define CPU_MAX 8
+
+/* Interrupt vectors for interprocessor interrupts. */
+#define IPI_RESCHEDULE 0xf0     /* Call the scheduler. */
+#define IPI_TLB_FLUSH 0xf1      /* Flush the TLB, see smp.c. */
+
+#ifndef __ASSEMBLER__
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Per-CPU state.
+
+   Each CPU has its own idle thread, task-state segment, and
+   interrupt state.  Kernel code finds its CPU through the
+   running thread, whose `cpu' member the scheduler keeps
+   current, so it must not move to another CPU while it uses the
+   result: either interrupts are off, or the kernel lock (see
+   smp.c) is held and the code does not sleep. */
+struct cpu
+  {
+    unsigned id;                        /* Index in cpus[]. */
+    uint8_t apic_id;                    /* Local APIC ID. */
+    volatile bool started;              /* Running the scheduler? */
+    struct thread *idle_thread;         /* This CPU's idle thread. */
+    struct thread *thread;              /* Thread running here. */
+    struct list ready_list;             /* Ready threads, see thread.c. */
+    unsigned ready_cnt;                 /* Threads in ready_list. */
+    unsigned thread_ticks;              /* Timer ticks since last yield. */
+    bool woken;                         /* Reschedule IPI in flight? */
+    volatile bool tlb_stale;            /* TLB flush IPI in flight? */
+    struct tss *tss;                    /* Task-state segment. */
+
+    /* Owned by interrupt.c. */
+    bool in_external_intr;              /* Processing an external interrupt? */
+    bool yield_on_return;               /* Yield on interrupt return? */
+
+    /* Statistics. */
+    long long idle_ticks;               /* Timer ticks spent idle. */
+    long long kernel_ticks;             /* Timer ticks in kernel threads. */
+    long long user_ticks;               /* Timer ticks in user programs. */
+  };
+
+/* CPUs running the scheduler, in cpus[0] through
+   cpus[cpu_cnt - 1].  cpus[0] is the boot CPU. */
+extern struct cpu cpus[CPU_MAX];
+extern unsigned cpu_cnt;
+
+/* -smp: Use at most this many CPUs. */
+extern unsigned smp_cpu_limit;
+
+void smp_init (void);
+void smp_start (void);
+struct cpu *cpu_current (void);
+
+void kernel_lock_acquire (void);
+void kernel_lock_release (void);
+bool kernel_lock_held (void);
+
+void smp_reschedule (struct cpu *);
+void smp_flush_tlb (uint32_t *pd);
+void smp_tlb_interrupt (void);
+#endif
+
+#endif /* threads/smp.h */
@@ -0,0 +1,65 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Spinlocks.
+
+   A spinlock protects data shared between CPUs for a few
+   instructions at a time.  Its holder is a CPU rather than a
+   thread, so it must not sleep while holding one, and it should
+   keep interrupts off, or an interrupt handler on the same CPU
+   that wants the lock will spin forever.  Everywhere else, use
+   the locks and semaphores in synch.h. */
+struct spinlock
+  {
+    volatile uint32_t locked;   /* 1 if held, 0 if free. */
+  };
+
+/* Initializer for a free spinlock. */
+#define SPINLOCK_INITIALIZER { 0 }
+
+/* Initializes LOCK as free. */
+static inline void
+spinlock_init (struct spinlock *lock)
+{
+  lock->locked = 0;
+}
+
+/* Tries to acquire LOCK without waiting.  Returns true if
+   successful.  The locked exchange is a full memory barrier, so
+   nothing the caller does afterward is visible before the lock
+   is held.  See [IA32-v2b] "XCHG". */
+static inline bool
+spinlock_try_acquire (struct spinlock *lock)
+{
+  uint32_t old = 1;
+
+  asm volatile ("xchgl %0, %1"
+                : "+r" (old), "+m" (lock->locked) : : "memory");
+  return old == 0;
+}
+
+/* Acquires LOCK, waiting as long as necessary.  While the lock
+   is held elsewhere, only reads it, so that the waiting CPUs do
+   not bounce its cache line between them. */
+static inline void
+spinlock_acquire (struct spinlock *lock)
+{
+  while (!spinlock_try_acquire (lock))
+    while (lock->locked)
+      asm volatile ("pause");
+}
+
+/* Releases LOCK, which the running CPU must hold.  x86 never
+   makes a store visible before earlier loads and stores, so a
+   plain store after a compiler barrier suffices. */
+static inline void
+spinlock_release (struct spinlock *lock)
+{
+  asm volatile ("" : : : "memory");
+  lock->locked = 0;
+}
+
+#endif /* threads/spinlock.h */
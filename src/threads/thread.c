@@ -8,8 +8,10 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -20,17 +22,35 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queues.
+
+   Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, wait in the ready_list
+   of one CPU's struct cpu, and each CPU runs only threads from
+   its own.  A CPU whose queue is empty steals a thread from the
+   longest one before it goes idle.
+
+   A thread that becomes ready goes back to the CPU it last ran
+   on, whose caches may still hold its data, unless another CPU
+   is idle or that CPU has more than AFFINITY_SLACK threads more
+   than the least loaded one.  Every BALANCE_TICKS timer ticks,
+   thread_tick() also moves threads from long queues to short
+   ones.
+
+   Like the rest of the scheduler's state, the queues are
+   protected by the kernel lock (see smp.c) with interrupts off,
+   not by locks of their own.  So the per-CPU queues keep threads
+   on warm caches and spread user work evenly, but two CPUs never
+   schedule at the same time: a contended scheduler still waits
+   on the kernel lock. */
+#define AFFINITY_SLACK 1        /* Extra load tolerated to stay put. */
+#define BALANCE_TICKS 20        /* # of timer ticks between balancing. */
+static unsigned balance_ticks;  /* # of timer ticks since balancing. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Idle thread. */
-static struct thread *idle_thread;
-
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
@@ -45,14 +65,8 @@ struct kernel_thread_frame
   void *aux;                  /* Auxiliary data for function. */
 };
 
-/* Statistics. */
-static long long idle_ticks;    /* # of timer ticks spent idle. */
-static long long kernel_ticks;  /* # of timer ticks in kernel threads. */
-static long long user_ticks;    /* # of timer ticks in user programs. */
-
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
-static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -61,7 +75,15 @@ bool thread_mlfqs;
 
 static void kernel_thread (thread_func *, void *aux);
 
+static void enqueue (struct cpu *, struct thread *);
+static struct thread *dequeue (struct cpu *, bool newest);
+static unsigned cpu_load (const struct cpu *);
+static struct cpu *choose_cpu (struct thread *);
+static struct thread *steal_thread (struct cpu *);
+static void balance (void);
+static void wake_cpu (struct cpu *);
 static void idle (void *aux UNUSED);
+static void idle_loop (void) NO_RETURN;
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
@@ -90,10 +112,13 @@ static tid_t allocate_tid (void);
   void
 thread_init (void) 
 {
+  unsigned i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i < CPU_MAX; i++)
+    list_init (&cpus[i].ready_list);
   list_init (&all_list);
 
   /* Set up a thread structure for the running thread. */
@@ -101,6 +126,8 @@ thread_init (void)
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  initial_thread->cpu = &cpus[0];
+  cpus[0].thread = initial_thread;
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
@@ -116,38 +143,81 @@ thread_start (void)
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
-  /* Wait for the idle thread to initialize idle_thread. */
+  /* Wait for the idle thread to set the CPU's idle_thread. */
   sema_down (&idle_started);
 }
 
 /* Called by the timer interrupt handler at each timer tick.
-   Thus, this function runs in an external interrupt context. */
+   Thus, this function runs in an external interrupt context.
+
+   Only the boot CPU gets timer interrupts, so this charges the
+   tick to the thread running on every CPU.  The others cannot
+   be in the kernel, since this CPU holds the kernel lock, so
+   their running threads stay put. */
   void
 thread_tick (void) 
 {
-  struct thread *t = thread_current ();
+  struct cpu *self = cpu_current ();
+  unsigned i;
 
-  /* Update statistics. */
-  if (t == idle_thread)
-    idle_ticks++;
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      struct thread *t = c->thread;
+
+      /* Update statistics. */
+      if (t == c->idle_thread)
+        c->idle_ticks++;
 #ifdef USERPROG
-  else if (t->pagedir != NULL)
-    user_ticks++;
+      else if (t->pagedir != NULL)
+        c->user_ticks++;
 #endif
-  else
-    kernel_ticks++;
-
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
-    intr_yield_on_return ();
+      else
+        c->kernel_ticks++;
+
+      /* Enforce preemption.  An idle CPU other than this one has
+         nothing to preempt. */
+      if (c == self)
+        {
+          if (++c->thread_ticks >= TIME_SLICE)
+            intr_yield_on_return ();
+        }
+      else if (t != c->idle_thread && ++c->thread_ticks >= TIME_SLICE)
+        {
+          c->thread_ticks = 0;
+          if (c->ready_cnt > 0)
+            smp_reschedule (c);
+        }
+    }
+
+  if (cpu_cnt > 1 && ++balance_ticks >= BALANCE_TICKS)
+    {
+      balance_ticks = 0;
+      balance ();
+    }
 }
 
-/* Prints thread statistics. */
+/* Prints thread statistics, with a line per CPU if there is more
+   than one. */
   void
 thread_print_stats (void) 
 {
+  long long idle_ticks = 0, kernel_ticks = 0, user_ticks = 0;
+  unsigned i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      idle_ticks += cpus[i].idle_ticks;
+      kernel_ticks += cpus[i].kernel_ticks;
+      user_ticks += cpus[i].user_ticks;
+    }
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
       idle_ticks, kernel_ticks, user_ticks);
+  if (cpu_cnt > 1)
+    for (i = 0; i < cpu_cnt; i++)
+      printf ("Thread: CPU %u: %lld idle ticks, %lld kernel ticks, "
+          "%lld user ticks\n", i, cpus[i].idle_ticks,
+          cpus[i].kernel_ticks, cpus[i].user_ticks);
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -241,18 +311,23 @@ thread_block (void)
    This function does not preempt the running thread.  This can
    be important: if the caller had disabled interrupts itself,
    it may expect that it can atomically unblock a thread and
-   update other data. */
+   update other data.  If T goes to another CPU that is idle,
+   though, that CPU may pick it up at once. */
   void
 thread_unblock (struct thread *t) 
 {
   enum intr_level old_level;
+  struct cpu *c;
 
   ASSERT (is_thread (t));
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  c = choose_cpu (t);
+  enqueue (c, t);
   t->status = THREAD_READY;
+  TRACE (TRACE_WAKEUP, t->tid, c->id, 0);
+  wake_cpu (c);
   intr_set_level (old_level);
 }
 
@@ -320,8 +395,8 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+  if (cur != cpu_current ()->idle_thread) 
+    enqueue (cpu_current (), cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -389,28 +464,69 @@ thread_get_recent_cpu (void)
   return 0;
 }
 
+/* Creates the idle thread for CPU C, which smp_start() is about
+   to start on the new thread's stack, and returns it, or a null
+   pointer if memory is short.  The thread is already running as
+   far as the scheduler is concerned. */
+  struct thread *
+thread_create_idle (struct cpu *c)
+{
+  struct thread *t = palloc_get_page (PAL_ZERO);
+
+  if (t == NULL)
+    return NULL;
+  init_thread (t, "idle", PRI_MIN);
+  t->tid = allocate_tid ();
+  t->status = THREAD_RUNNING;
+  t->cpu = c;
+  c->idle_thread = c->thread = t;
+  return t;
+}
+
+/* Runs the idle loop on a CPU other than the boot CPU, in the
+   thread that thread_create_idle() made for it.  The CPU must
+   hold the kernel lock. */
+  void
+thread_start_ap (void)
+{
+  idle_loop ();
+}
+
 /* Idle thread.  Executes when no other thread is ready to run.
 
-   The idle thread is initially put on the ready list by
-   thread_start().  It will be scheduled once initially, at which
-   point it initializes idle_thread, "up"s the semaphore passed
-   to it to enable thread_start() to continue, and immediately
-   blocks.  After that, the idle thread never appears in the
-   ready list.  It is returned by next_thread_to_run() as a
-   special case when the ready list is empty. */
+   The boot CPU's idle thread is initially put on the ready list
+   by thread_start().  It will be scheduled once initially, at
+   which point it records itself as the CPU's idle thread, "up"s
+   the semaphore passed to it to enable thread_start() to
+   continue, and immediately blocks.  After that, the idle thread
+   never appears in the ready list.  It is returned by
+   next_thread_to_run() as a special case when the ready list is
+   empty.  Other CPUs' idle threads never appear in the ready
+   list at all. */
   static void
 idle (void *idle_started_ UNUSED) 
 {
   struct semaphore *idle_started = idle_started_;
-  idle_thread = thread_current ();
+  cpu_current ()->idle_thread = thread_current ();
   sema_up (idle_started);
+  idle_loop ();
+}
 
+/* Body of every CPU's idle thread. */
+  static void
+idle_loop (void)
+{
   for (;;) 
   {
     /* Let someone else run. */
     intr_disable ();
     thread_block ();
 
+    /* Let other CPUs into the kernel while this one waits.  The
+       interrupt that ends the wait takes the kernel lock back
+       (see intr_handler()). */
+    kernel_lock_release ();
+
     /* Re-enable interrupts and wait for the next one.
 
        The `sti' instruction disables interrupts until the
@@ -490,25 +606,6 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->magic = THREAD_MAGIC;
   list_push_back (&all_list, &t->allelem);
-#ifdef USERPROG
-  t->this_file = NULL;
-  list_init(&t->finished_list);
-  list_init(&t->child_list);
-  if(t != initial_thread && strcmp(name, "idle") 
-      && strcmp(name, "ahead_reader")){
-    list_push_back(&thread_current()->child_list, &t->child_elem);
-    t->parent = thread_current();
-  }
-  else	
-    t->parent = NULL;
-  list_init(&t->fd_list);
-  sema_init(&t->wait_sema, 0);
-  sema_init(&t->succ_sema, 0);
-  t->is_waiting = false;
-  t->waiting_now = -1;
-  t->wait_exit = -1;
-  t->success_load = false;
-#endif
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -525,17 +622,133 @@ alloc_frame (struct thread *t, size_t size)
 }
 
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from the running CPU's run queue, unless the
+   run queue is empty.  (If the running thread can continue
+   running, then it will be in the run queue.)  If the run queue
+   is empty, steal a thread from another CPU's, and if they are
+   all empty too, return the running CPU's idle thread. */
   static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
-    return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  struct cpu *c = cpu_current ();
+  struct thread *t;
+
+  if (c->ready_cnt > 0)
+    return dequeue (c, false);
+  t = steal_thread (c);
+  return t != NULL ? t : c->idle_thread;
+}
+
+/* Adds T to the end of C's run queue. */
+  static void
+enqueue (struct cpu *c, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_push_back (&c->ready_list, &t->elem);
+  c->ready_cnt++;
+}
+
+/* Removes and returns a thread from C's run queue, which must
+   not be empty: the one that has waited longest, or, if NEWEST,
+   the one that has waited least, which is the one to move to
+   another CPU because it would have to wait longest here. */
+  static struct thread *
+dequeue (struct cpu *c, bool newest)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (c->ready_cnt > 0);
+
+  e = newest ? list_pop_back (&c->ready_list)
+             : list_pop_front (&c->ready_list);
+  c->ready_cnt--;
+  return list_entry (e, struct thread, elem);
+}
+
+/* Returns the number of threads that C has to run, counting the
+   one it is running unless that is its idle thread. */
+  static unsigned
+cpu_load (const struct cpu *c)
+{
+  return c->ready_cnt + (c->thread != c->idle_thread);
+}
+
+/* Returns the CPU whose run queue T should join, following the
+   affinity rule described at the top of this file. */
+  static struct cpu *
+choose_cpu (struct thread *t)
+{
+  struct cpu *last = t->cpu;
+  struct cpu *least = &cpus[0];
+  unsigned i;
+
+  for (i = 1; i < cpu_cnt; i++)
+    if (cpu_load (&cpus[i]) < cpu_load (least))
+      least = &cpus[i];
+
+  if (last == NULL || cpu_load (last) == cpu_load (least))
+    return last != NULL ? last : least;
+  if (cpu_load (least) == 0
+      || cpu_load (last) > cpu_load (least) + AFFINITY_SLACK)
+    return least;
+  return last;
+}
+
+/* Takes a thread from the longest run queue other than SELF's,
+   for SELF to run, and returns it, or returns a null pointer if
+   there is none. */
+  static struct thread *
+steal_thread (struct cpu *self)
+{
+  struct cpu *busiest = NULL;
+  unsigned i;
+
+  for (i = 0; i < cpu_cnt; i++)
+    {
+      struct cpu *c = &cpus[i];
+      if (c != self && c->ready_cnt > 0
+          && (busiest == NULL || c->ready_cnt > busiest->ready_cnt))
+        busiest = c;
+    }
+  return busiest != NULL ? dequeue (busiest, true) : NULL;
+}
+
+/* Moves threads from the most to the least loaded CPUs until
+   their loads differ by at most one. */
+  static void
+balance (void)
+{
+  for (;;)
+    {
+      struct cpu *busiest = &cpus[0];
+      struct cpu *least = &cpus[0];
+      unsigned i;
+
+      for (i = 1; i < cpu_cnt; i++)
+        {
+          if (cpus[i].ready_cnt > busiest->ready_cnt)
+            busiest = &cpus[i];
+          if (cpu_load (&cpus[i]) < cpu_load (least))
+            least = &cpus[i];
+        }
+      if (busiest->ready_cnt == 0
+          || cpu_load (busiest) <= cpu_load (least) + 1)
+        break;
+
+      enqueue (least, dequeue (busiest, true));
+      wake_cpu (least);
+    }
+}
+
+/* Makes C, if it is idle and not the running CPU, look at its
+   run queue. */
+  static void
+wake_cpu (struct cpu *c)
+{
+  if (c != cpu_current () && c->thread == c->idle_thread && !c->woken)
+    smp_reschedule (c);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -558,14 +771,17 @@ next_thread_to_run (void)
 thread_schedule_tail (struct thread *prev)
 {
   struct thread *cur = running_thread ();
+  struct cpu *c = cur->cpu;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Mark us as running. */
   cur->status = THREAD_RUNNING;
+  c->thread = cur;
+  c->woken = false;
 
   /* Start new time slice. */
-  thread_ticks = 0;
+  c->thread_ticks = 0;
 
 #ifdef USERPROG
   /* Activate the new address space. */
@@ -603,7 +819,11 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      TRACE (TRACE_SCHEDULE, cur->tid, next->tid, cur->status);
+      next->cpu = cur->cpu;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -95,31 +95,20 @@ struct thread
   uint8_t *stack;                     /* Saved stack pointer. */
   int priority;                       /* Priority. */
   struct list_elem allelem;           /* List element for all threads list. */
+  struct cpu *cpu;                    /* CPU running, or last to run, us. */
 
   /* Shared between thread.c and synch.c. */
   struct list_elem elem;              /* List element. */
   int wakeup;													// For sleep()
   struct list_elem wakeupelem;
 
+  /* Owned by devices/block.c. */
+  struct block_request *block_request; /* Innermost request in progress. */
 
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
-  uint32_t *pagedir;                  /* Page directory. */
-  // list of file descriptor
-  struct list fd_list;
-  // list of child?
-  struct semaphore wait_sema;
-  struct semaphore succ_sema;
-  struct thread* parent;
-  bool is_waiting;
-  bool success_load;
-  tid_t waiting_now;
-  int wait_exit;
-  int exit;
-  void* this_file;
-  struct list child_list;
-  struct list finished_list;
-  struct list_elem child_elem;
+  uint32_t *pagedir;                  /* Page directory, or null. */
+  struct process *process;            /* User process, or null. */
 #endif
 
 
@@ -134,8 +123,11 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+struct cpu;
 void thread_init (void);
 void thread_start (void);
+struct thread *thread_create_idle (struct cpu *);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
 void thread_print_stats (void);
@@ -0,0 +1,249 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <ustar.h>
+#include "devices/block.h"
+#include "devices/timer.h"
+#include "threads/palloc.h"
+#include "threads/smp.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* The ring that tracepoints write into.  A writer reserves a slot
+   by atomically incrementing HEAD, so writers never wait for each
+   other and an interrupt handler that fires during a write simply
+   takes the next slot.  Once the ring is full the oldest records
+   are overwritten.
+
+   There is one ring per CPU, so that writers on different CPUs do
+   not contend for HEAD.  trace_dump() merges them by TSC. */
+struct trace_ring
+  {
+    struct trace_record *records;       /* Array of RECORD_CNT. */
+    uint32_t record_cnt;                /* Power of 2. */
+    uint32_t head;                      /* Events recorded so far. */
+  };
+
+static struct trace_ring rings[CPU_MAX];
+
+unsigned trace_pages;
+bool trace_enabled;
+
+/* Clock readings when tracing started, so that the decoder can
+   convert TSC values into time. */
+static uint64_t start_tsc;
+static int64_t start_ticks;
+
+static bool alloc_ring (unsigned cpu);
+
+/* Allocates the boot CPU's ring and starts tracing, if the
+   "-trace" option asked for it.  Must be called after
+   palloc_init(). */
+void
+trace_init (void)
+{
+  if (trace_pages == 0 || !alloc_ring (0))
+    return;
+
+  start_tsc = timer_cycles ();
+  start_ticks = timer_ticks ();
+  trace_enabled = true;
+}
+
+/* Allocates the ring of CPU number CPU, if tracing is on.  Must
+   be called before the CPU starts.  If this fails, the CPU's
+   events are dropped. */
+void
+trace_init_cpu (unsigned cpu)
+{
+  ASSERT (cpu < CPU_MAX);
+  if (trace_enabled)
+    alloc_ring (cpu);
+}
+
+/* Allocates the ring of CPU number CPU with about trace_pages
+   pages of records.  Returns true if successful. */
+static bool
+alloc_ring (unsigned cpu)
+{
+  struct trace_ring *ring = &rings[cpu];
+  size_t page_cnt = 1;
+
+  /* Round down to a power of 2, so that the record count is one
+     too and slots can be found by masking. */
+  while (page_cnt * 2 <= trace_pages)
+    page_cnt *= 2;
+
+  ring->records = palloc_get_multiple (PAL_ZERO, page_cnt);
+  if (ring->records == NULL)
+    {
+      printf ("trace: can't allocate %zu pages for CPU %u, "
+              "events dropped\n", page_cnt, cpu);
+      return false;
+    }
+  ring->record_cnt = page_cnt * PGSIZE / sizeof *ring->records;
+  ring->head = 0;
+  return true;
+}
+
+/* Records EVENT with arguments A0, A1, and A2.  Use the TRACE
+   macro instead, which skips the call when tracing is off. */
+void
+trace_event (enum trace_event event, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+  unsigned cpu = cpu_current ()->id;
+  struct trace_ring *ring = &rings[cpu];
+  struct trace_record *r;
+  struct thread *t;
+  uint32_t slot;
+
+  if (ring->records == NULL)
+    return;
+  slot = __sync_fetch_and_add (&ring->head, 1);
+  r = &ring->records[slot & (ring->record_cnt - 1)];
+
+  /* The running thread's struct is at the start of the page that
+     holds the stack, as in running_thread().  thread_current()
+     can't be used because it insists on a running thread, which
+     the scheduler doesn't have. */
+  t = pg_round_down (&r);
+
+  r->tsc = timer_cycles ();
+  r->cpu = cpu;
+  r->tid = t->tid;
+  r->args[0] = a0;
+  r->args[1] = a1;
+  r->args[2] = a2;
+  r->reserved = 0;
+  barrier ();
+  r->event = event;
+}
+
+/* Where trace_dump() is in reading one CPU's ring. */
+struct ring_cursor
+  {
+    uint32_t next;              /* Next event number to read. */
+    uint32_t end;               /* Event number to stop at. */
+  };
+
+/* Returns the oldest record not yet read through CURSORS, one
+   per CPU, and advances past it, or returns a null pointer if
+   all are used up. */
+static struct trace_record *
+oldest_record (struct ring_cursor cursors[])
+{
+  struct trace_record *oldest = NULL;
+  unsigned cpu, oldest_cpu = 0;
+
+  for (cpu = 0; cpu < CPU_MAX; cpu++)
+    if (cursors[cpu].next != cursors[cpu].end)
+      {
+        struct trace_ring *ring = &rings[cpu];
+        struct trace_record *r
+          = &ring->records[cursors[cpu].next & (ring->record_cnt - 1)];
+        if (oldest == NULL || r->tsc < oldest->tsc)
+          {
+            oldest = r;
+            oldest_cpu = cpu;
+          }
+      }
+  if (oldest != NULL)
+    cursors[oldest_cpu].next++;
+  return oldest;
+}
+
+/* Writes the rings, oldest record first, to the start of the
+   scratch disk as a ustar file named "trace", followed by an
+   end-of-archive marker, so that "pintos -g trace" can fetch it.
+   Overwrites whatever the scratch disk held, including files
+   written by "append".  Tracing pauses during the dump. */
+void
+trace_dump (void)
+{
+  struct block *scratch;
+  struct trace_header *h;
+  struct ring_cursor cursors[CPU_MAX];
+  uint8_t *sector;
+  uint32_t head = 0, cnt = 0, i;
+  unsigned cpu;
+  size_t size;
+  block_sector_t s = 0;
+  bool was_enabled = trace_enabled;
+
+  if (rings[0].records == NULL)
+    return;
+  scratch = block_get_role (BLOCK_SCRATCH);
+  if (scratch == NULL)
+    {
+      printf ("trace: no scratch disk, trace not saved\n");
+      return;
+    }
+
+  trace_enabled = false;
+  for (cpu = 0; cpu < CPU_MAX; cpu++)
+    {
+      struct trace_ring *ring = &rings[cpu];
+      uint32_t ring_head = ring->head;
+      uint32_t ring_cnt = (ring_head < ring->record_cnt
+                           ? ring_head : ring->record_cnt);
+
+      cursors[cpu].next = ring_head - ring_cnt;
+      cursors[cpu].end = ring_head;
+      head += ring_head;
+      cnt += ring_cnt;
+    }
+  size = BLOCK_SECTOR_SIZE + (size_t) cnt * sizeof (struct trace_record);
+  if (DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE) + 3 > block_size (scratch))
+    {
+      printf ("trace: scratch disk too small for %zu bytes\n", size);
+      trace_enabled = was_enabled;
+      return;
+    }
+
+  sector = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+
+  /* ustar header. */
+  ustar_make_header ("trace", USTAR_REGULAR, size, (char *) sector);
+  block_write (scratch, s++, sector);
+
+  /* Trace header. */
+  memset (sector, 0, BLOCK_SECTOR_SIZE);
+  h = (struct trace_header *) sector;
+  h->magic = TRACE_MAGIC;
+  h->record_size = sizeof (struct trace_record);
+  h->record_cnt = cnt;
+  h->event_cnt = head;
+  h->timer_freq = TIMER_FREQ;
+  h->tsc_khz = timer_cycles_per_sec () / 1000;
+  h->start_tsc = start_tsc;
+  h->start_ticks = start_ticks;
+  h->end_tsc = timer_cycles ();
+  h->end_ticks = timer_ticks ();
+  block_write (scratch, s++, sector);
+
+  /* Records, in order across all CPUs, 16 to a sector. */
+  for (i = 0; i < cnt; )
+    {
+      struct trace_record *r = (struct trace_record *) sector;
+      size_t j;
+
+      memset (sector, 0, BLOCK_SECTOR_SIZE);
+      for (j = 0; j < BLOCK_SECTOR_SIZE / sizeof *r && i < cnt; j++, i++)
+        r[j] = *oldest_record (cursors);
+      block_write (scratch, s++, sector);
+    }
+
+  /* End-of-archive marker. */
+  memset (sector, 0, BLOCK_SECTOR_SIZE);
+  block_write (scratch, s++, sector);
+  block_write (scratch, s++, sector);
+
+  palloc_free_page (sector);
+  printf ("trace: %"PRIu32" of %"PRIu32" events saved to scratch disk\n",
+          cnt, head);
+  trace_enabled = was_enabled;
+}
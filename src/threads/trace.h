@@ -0,0 +1,83 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel event tracing.
+
+   A tracepoint appends a fixed-size binary record to its CPU's
+   ring in memory.  Tracing is off unless the kernel is given the
+   "-trace" option, in which case the rings are dumped to the
+   scratch disk at shutdown, and whenever trace_dump() is called,
+   as a ustar file named "trace".  utils/pintos-trace decodes it.
+
+   Tracepoints take no locks and do not disable interrupts, so
+   they can go anywhere, including interrupt handlers and the
+   scheduler. */
+
+/* Events.  Keep utils/pintos-trace.c in sync. */
+enum trace_event
+  {
+    TRACE_NONE,                 /* Unused slot. */
+    TRACE_SCHEDULE,             /* Switch: prev tid, next tid, prev status. */
+    TRACE_WAKEUP,               /* Unblock: tid, CPU queued on. */
+    TRACE_SYSCALL,              /* System call: number, arg 0, arg 1. */
+    TRACE_SYSCALL_RETURN,       /* Return: number, return value. */
+    TRACE_BLOCK_READ,           /* Read: block type, sector, count. */
+    TRACE_BLOCK_WRITE,          /* Write: block type, sector, count. */
+    TRACE_CACHE_HIT,            /* Cache hit: sector, is write. */
+    TRACE_CACHE_MISS,           /* Cache miss: sector, is write. */
+    TRACE_CACHE_EVICT,          /* Eviction: sector, was dirty. */
+    TRACE_EVENT_CNT
+  };
+
+/* One event, as stored in the ring and in the dump. */
+struct trace_record
+  {
+    uint64_t tsc;               /* timer_cycles(). */
+    uint16_t event;             /* enum trace_event. */
+    uint16_t cpu;               /* CPU that recorded the event. */
+    int32_t tid;                /* Running thread. */
+    uint32_t args[3];           /* Event-specific arguments. */
+    uint32_t reserved;          /* Pads to 32 bytes. */
+  };
+
+/* Header of the dump, in its first sector. */
+#define TRACE_MAGIC 0x43525450  /* "PTRC". */
+struct trace_header
+  {
+    uint32_t magic;             /* TRACE_MAGIC. */
+    uint32_t record_size;       /* sizeof (struct trace_record). */
+    uint32_t record_cnt;        /* Records that follow. */
+    uint32_t event_cnt;         /* Events recorded, including lost ones. */
+    uint32_t timer_freq;        /* Timer ticks per second. */
+    uint32_t tsc_khz;           /* TSC rate, or 0 if not calibrated. */
+    uint64_t start_tsc;         /* TSC at trace_init(). */
+    uint64_t start_ticks;       /* Timer ticks at trace_init(). */
+    uint64_t end_tsc;           /* TSC at the dump. */
+    uint64_t end_ticks;         /* Timer ticks at the dump. */
+  };
+
+/* -trace: enables tracing with this many pages of records. */
+extern unsigned trace_pages;
+
+/* True while tracepoints record. */
+extern bool trace_enabled;
+
+void trace_init (void);
+void trace_init_cpu (unsigned cpu);
+void trace_event (enum trace_event, uint32_t, uint32_t, uint32_t);
+void trace_dump (void);
+
+/* Records EVENT with arguments A0, A1, and A2, if tracing is on. */
+#define TRACE(EVENT, A0, A1, A2)                                        \
+        do                                                              \
+          {                                                             \
+            if (trace_enabled)                                          \
+              trace_event (EVENT, (uint32_t) (A0), (uint32_t) (A1),     \
+                           (uint32_t) (A2));                            \
+          }                                                             \
+        while (0)
+
+#endif /* threads/trace.h */
@@ -2,6 +2,8 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/process.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "userprog/syscall.h"
@@ -11,6 +13,7 @@
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -45,7 +48,8 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug_exception,
+                     "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -91,6 +95,7 @@ kill (struct intr_frame *f)
       printf ("%s: dying due to interrupt %#04x (%s).\n",
               thread_name (), f->vec_no, intr_name (f->vec_no));
       intr_dump_frame (f);
+      process_set_exiting (-1);
       thread_exit (); 
 
     case SEL_KCSEG:
@@ -110,6 +115,25 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.  sysenter does not clear the trap
+   flag, so a user program that sets TF and then makes a system
+   call through sysenter traps in the kernel, before the first
+   instruction of syscall_sysenter.  That trap is not the
+   program's fault: clear TF, as Linux does, and let the system
+   call continue.  The program returns from it with TF clear.
+   Other debug exceptions kill the process like any other
+   exception. */
+static void
+debug_exception (struct intr_frame *f)
+{
+  if (f->cs == SEL_KCSEG && f->eip == syscall_sysenter)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -150,6 +174,12 @@ page_fault (struct intr_frame *f)
   user = (f->error_code & PF_U) != 0;
 
 
+	/* Heap pages are mapped on first touch.  System calls map
+	   the heap pages of their arguments up front, so that the
+	   kernel does not fault on them with a lock held. */
+	if (not_present && process_heap_fault (fault_addr))
+		return;
+
 	if (not_present || (is_kernel_vaddr (fault_addr) && user))
     syscall_exit (-1); 
 
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include "userprog/tss.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/vaddr.h"
 
 /* The Global Descriptor Table (GDT).
@@ -36,21 +37,23 @@ void
 gdt_init (void)
 {
   uint64_t gdtr_operand;
+  unsigned cpu = cpu_current ()->id;
 
-  /* Initialize GDT. */
+  /* Initialize GDT.  Every CPU does this, on the same table, but
+     only the entry for its own TSS differs. */
   gdt[SEL_NULL / sizeof *gdt] = 0;
   gdt[SEL_KCSEG / sizeof *gdt] = make_code_desc (0);
   gdt[SEL_KDSEG / sizeof *gdt] = make_data_desc (0);
   gdt[SEL_UCSEG / sizeof *gdt] = make_code_desc (3);
   gdt[SEL_UDSEG / sizeof *gdt] = make_data_desc (3);
-  gdt[SEL_TSS / sizeof *gdt] = make_tss_desc (tss_get ());
+  gdt[SEL_TSS_CPU (cpu) / sizeof *gdt] = make_tss_desc (tss_get ());
 
   /* Load GDTR, TR.  See [IA32-v3a] 2.4.1 "Global Descriptor
      Table Register (GDTR)", 2.4.4 "Task Register (TR)", and
      6.2.4 "Task Register".  */
   gdtr_operand = make_gdtr_operand (sizeof gdt - 1, gdt);
   asm volatile ("lgdt %0" : : "m" (gdtr_operand));
-  asm volatile ("ltr %w0" : : "q" (SEL_TSS));
+  asm volatile ("ltr %w0" : : "q" (SEL_TSS_CPU (cpu)));
 }
 
 /* System segment or code/data segment? */
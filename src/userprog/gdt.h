@@ -2,14 +2,22 @@
 #define USERPROG_GDT_H
 
 #include "threads/loader.h"
+#include "threads/smp.h"
 
 /* Segment selectors.
-   More selectors are defined by the loader in loader.h. */
+   More selectors are defined by the loader in loader.h.
+   sysenter and sysexit require the user code and data selectors
+   to follow SEL_KCSEG and SEL_KDSEG in this order. */
 #define SEL_UCSEG       0x1B    /* User code selector. */
 #define SEL_UDSEG       0x23    /* User data selector. */
-#define SEL_TSS         0x28    /* Task-state segment. */
-#define SEL_CNT         6       /* Number of segments. */
+#define SEL_TSS         0x28    /* Task-state segment of CPU 0. */
+#define SEL_CNT         (5 + CPU_MAX) /* Number of segments. */
 
+/* Task-state segment of CPU number ID.  Each CPU has its own. */
+#define SEL_TSS_CPU(ID) (SEL_TSS + 8 * (ID))
+
+#ifndef __ASSEMBLER__
 void gdt_init (void);
+#endif
 
 #endif /* userprog/gdt.h */
@@ -0,0 +1,174 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Bytes that a pipe can hold.  Must be a power of 2, so that the
+   byte counters below can wrap around. */
+#define PIPE_SIZE PGSIZE
+
+/* A pipe: a ring buffer with a read end and a write end, each of
+   which may be open in any number of fds.
+
+   read() and write() copy straight between the ring and the
+   user's buffer, so each byte is copied once going in and once
+   coming out, with no kernel buffer in between.  A reader blocks
+   until there is at least one byte or no writer is left; a
+   writer blocks until all of its bytes fit or no reader is
+   left. */
+struct pipe
+  {
+    struct lock lock;                   /* Protects all members. */
+    struct condition not_empty;         /* Data or end of file. */
+    struct condition not_full;          /* Space or no readers. */
+    uint8_t *buf;                       /* PIPE_SIZE bytes. */
+    size_t head;                        /* Bytes ever written. */
+    size_t tail;                        /* Bytes ever read. */
+    unsigned reader_cnt;                /* Open read ends. */
+    unsigned writer_cnt;                /* Open write ends. */
+  };
+
+/* Returns the smaller of A and B. */
+static size_t
+min (size_t a, size_t b)
+{
+  return a < b ? a : b;
+}
+
+/* Creates a pipe with one read end and one write end open, for
+   the caller to hand out.  Returns the pipe, or a null pointer
+   if memory is short. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->buf = palloc_get_page (0);
+  if (p->buf == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  p->head = p->tail = 0;
+  p->reader_cnt = p->writer_cnt = 1;
+  return p;
+}
+
+/* Opens another write end of P if WRITER is true, otherwise
+   another read end. */
+void
+pipe_open (struct pipe *p, bool writer)
+{
+  lock_acquire (&p->lock);
+  if (writer)
+    p->writer_cnt++;
+  else
+    p->reader_cnt++;
+  lock_release (&p->lock);
+}
+
+/* Closes a write end of P if WRITER is true, otherwise a read
+   end.  Closing the last write end gives readers end of file;
+   closing the last read end makes writes fail.  P is freed when
+   both ends are closed. */
+void
+pipe_close (struct pipe *p, bool writer)
+{
+  bool dead;
+
+  lock_acquire (&p->lock);
+  if (writer)
+    {
+      ASSERT (p->writer_cnt > 0);
+      if (--p->writer_cnt == 0)
+        cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->reader_cnt > 0);
+      if (--p->reader_cnt == 0)
+        cond_broadcast (&p->not_full, &p->lock);
+    }
+  dead = p->reader_cnt == 0 && p->writer_cnt == 0;
+  lock_release (&p->lock);
+
+  if (dead)
+    {
+      palloc_free_page (p->buf);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into BUFFER, waiting until at
+   least one byte is there.  Returns the number of bytes read,
+   which is 0 at end of file, that is, when P is empty and has no
+   write end open. */
+int
+pipe_read (struct pipe *p, void *buffer_, size_t size)
+{
+  uint8_t *buffer = buffer_;
+  size_t done = 0;
+
+  lock_acquire (&p->lock);
+  while (size > 0 && p->head == p->tail && p->writer_cnt > 0)
+    cond_wait (&p->not_empty, &p->lock);
+  while (done < size && p->tail != p->head)
+    {
+      size_t ofs = p->tail % PIPE_SIZE;
+      size_t chunk = min (min (size - done, p->head - p->tail),
+                          PIPE_SIZE - ofs);
+
+      memcpy (buffer + done, p->buf + ofs, chunk);
+      p->tail += chunk;
+      done += chunk;
+    }
+  if (done > 0)
+    cond_broadcast (&p->not_full, &p->lock);
+  lock_release (&p->lock);
+
+  return done;
+}
+
+/* Writes the SIZE bytes in BUFFER to P, waiting for room as
+   needed.  Readers are woken as each piece goes in, so that a
+   write larger than the pipe can make progress.  Returns the
+   number of bytes written, which is less than SIZE only if the
+   last read end was closed partway through, or -1 if no read end
+   was open to begin with. */
+int
+pipe_write (struct pipe *p, const void *buffer_, size_t size)
+{
+  const uint8_t *buffer = buffer_;
+  size_t done = 0;
+  int retval;
+
+  lock_acquire (&p->lock);
+  while (done < size && p->reader_cnt > 0)
+    {
+      size_t ofs = p->head % PIPE_SIZE;
+      size_t chunk = min (min (size - done,
+                               PIPE_SIZE - (p->head - p->tail)),
+                          PIPE_SIZE - ofs);
+
+      if (chunk == 0)
+        {
+          cond_wait (&p->not_full, &p->lock);
+          continue;
+        }
+      memcpy (p->buf + ofs, buffer + done, chunk);
+      p->head += chunk;
+      done += chunk;
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  retval = done > 0 || p->reader_cnt > 0 ? (int) done : -1;
+  lock_release (&p->lock);
+
+  return retval;
+}
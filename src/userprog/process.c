@@ -7,6 +7,7 @@
 #include <string.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/shm.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
@@ -15,13 +16,100 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/syscall.h"
 #include "threads/malloc.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_thread NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool install_page (void *upage, void *kpage, bool writable);
+
+/* Handed by process_execute() to start_process().  It lives on
+   the parent's stack, which stays put because the parent waits
+   until the load is done. */
+struct exec_info
+  {
+    char *cmd_line;                     /* Command line, in a page. */
+    struct process *parent;             /* Process calling exec. */
+    struct semaphore loaded;            /* Upped once load is done. */
+    bool success;                       /* Did it load? */
+  };
+
+/* A thread of a user process, kept until it is joined or the
+   process exits. */
+struct user_thread
+  {
+    struct list_elem elem;              /* Element in thread_list. */
+    tid_t tid;                          /* Thread id. */
+    uint8_t *stack;                     /* User stack page, or null. */
+    bool joined;                        /* Has a join begun? */
+    struct semaphore done;              /* Upped when it exits. */
+  };
+
+/* Creates a process whose first thread is the running thread,
+   as a child of PARENT, or with no parent if PARENT is null, and
+   makes the running thread part of it.  Returns the process, or
+   a null pointer if memory is short. */
+static struct process *
+new_process (struct process *parent)
+{
+  struct thread *t = thread_current ();
+  struct process *p = malloc (sizeof *p);
+  struct user_thread *ut = malloc (sizeof *ut);
+  enum intr_level old_level;
+
+  if (p == NULL || ut == NULL)
+    {
+      free (p);
+      free (ut);
+      return NULL;
+    }
+  memset (p, 0, sizeof *p);
+  p->pid = t->tid;
+  p->exit = -1;
+  p->thread_cnt = 1;
+  list_init (&p->thread_list);
+  list_init (&p->fd_list);
+  list_init (&p->shm_list);
+  list_init (&p->child_list);
+  list_init (&p->finished_list);
+
+  ut->tid = t->tid;
+  ut->stack = NULL;
+  ut->joined = false;
+  sema_init (&ut->done, 0);
+  list_push_back (&p->thread_list, &ut->elem);
+
+  p->parent = parent;
+  if (parent != NULL)
+    {
+      old_level = intr_disable ();
+      list_push_back (&parent->child_list, &p->child_elem);
+      intr_set_level (old_level);
+    }
+  t->process = p;
+  return p;
+}
+
+/* Returns the thread with id TID in process P, or a null pointer
+   if it has none that is not yet joined. */
+static struct user_thread *
+find_thread (struct process *p, tid_t tid)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&p->thread_list); e != list_end (&p->thread_list);
+       e = list_next (e))
+    {
+      struct user_thread *ut = list_entry (e, struct user_thread, elem);
+      if (ut->tid == tid)
+        return ut;
+    }
+  return NULL;
+}
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -31,6 +119,7 @@ static bool load (const char *cmdline, void (**eip) (void), void **esp);
 process_execute (const char *file_name) 
 {
   struct thread* cur = thread_current();
+  struct exec_info exec;
   char *fn_copy;
   tid_t tid;
 
@@ -47,20 +136,31 @@ process_execute (const char *file_name)
     return TID_ERROR;
   strlcpy (fn_copy, file_name, PGSIZE);
 
+  // A kernel thread that starts a process needs a struct process of
+  // its own, to wait for the child.
+  if (cur->process == NULL && new_process (NULL) == NULL)
+  {
+    palloc_free_page (fn_copy);
+    return TID_ERROR;
+  }
+
+  exec.cmd_line = fn_copy;
+  exec.parent = cur->process;
+  sema_init (&exec.loaded, 0);
+  exec.success = false;
+
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  tid = thread_create (file_name, PRI_DEFAULT, start_process, &exec);
 
   if (tid == TID_ERROR)
+  {
     palloc_free_page (fn_copy);
-
-  sema_down(&cur->succ_sema);
-  if(!cur->success_load)
-    return -1;
-  // ready for reload
-  else cur->success_load = false;
+    return TID_ERROR;
+  }
 
   // If TID_ERROR do not occur, palloc_free_page perform in start_process.
-  return tid;
+  sema_down (&exec.loaded);
+  return exec.success ? tid : TID_ERROR;
 }
 
 /* A thread function that loads a user process and starts it
@@ -85,10 +185,12 @@ reverse_str(char* str)
 
 
   static void
-start_process (void *file_name_) 
-  // file_name_ is fn_copy in here! do not care about race condition.
+start_process (void *exec_) 
+  // exec_->cmd_line is fn_copy in here! do not care about race condition.
 {
-  char *argvs = file_name_;
+  struct exec_info *exec = exec_;
+  char *argvs = exec->cmd_line;
+  struct process *p;
   char file_name[17], *save_ptr, *token;
   struct intr_frame if_;
   bool success;
@@ -111,8 +213,13 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
-  sema_up(&thread_current()->parent->succ_sema);
+  p = new_process (exec->parent);
+  success = p != NULL && load (file_name, &if_.eip, &if_.esp);
+  // the parent is still waiting, so its fds hold still.
+  if (p != NULL)
+    inherit_std_fd(&exec->parent->fd_list);
+  exec->success = success;
+  sema_up(&exec->loaded);
 
   // TODO: Stack push problem
   // argvs have parameter information.
@@ -120,7 +227,6 @@ start_process (void *file_name_)
   // Note that argv have to be pushed "reverse order".
   // TODO: Child process problem will be treated in here?
   if(success){
-    thread_current()->parent->success_load = true;
     reverse_str(argvs);
     token = strtok_r(argvs, " ", &save_ptr);
 
@@ -163,13 +269,12 @@ start_process (void *file_name_)
     if_.esp -= (sizeof (void(*)(void)));
     memset(if_.esp, 0, sizeof (void(*)(void)));
   }	
-  else 
-    thread_current()->parent->success_load = false;
 
   /* If load failed, quit. */
   palloc_free_page (argvs);
   if (!success){
-    thread_current()->exit = -1;
+    if (p != NULL)
+      p->exit = -1;
     thread_exit ();
   }
 
@@ -179,7 +284,10 @@ start_process (void *file_name_)
      threads/intr-stubs.S).  Because intr_exit takes all of its
      arguments on the stack in the form of a `struct intr_frame',
      we just point the stack pointer (%esp) to our stack frame
-     and jump to it. */
+     and jump to it.  Like any return to user mode, it gives up
+     the kernel lock first, with interrupts off until the iret. */
+  intr_disable ();
+  kernel_lock_release ();
   asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
   NOT_REACHED ();
 }
@@ -191,39 +299,148 @@ start_process (void *file_name_)
    been successfully called for the given TID, returns -1
    immediately, without waiting.
 
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   A child that is still running is found in child_list; it moves
+   its exit status to finished_list as it exits, and ups WAITER
+   if someone is waiting for it. */
   int
 process_wait (tid_t child_tid) 
 {
-  return syscall_wait(child_tid);
+  struct process *p = thread_current ()->process;
+  struct process *child = NULL;
+  struct finished_elem *f = NULL;
+  struct semaphore done;
+  struct list_elem *e;
+  enum intr_level old_level;
+  int status = -1;
+
+  if (p == NULL)
+    return -1;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&p->child_list); e != list_end (&p->child_list);
+       e = list_next (e))
+    if (list_entry (e, struct process, child_elem)->pid == child_tid)
+    {
+      child = list_entry (e, struct process, child_elem);
+      break;
+    }
+  if (child != NULL)
+  {
+    // only one thread may wait for a given child
+    if (child->waiter != NULL)
+    {
+      intr_set_level (old_level);
+      return -1;
+    }
+    sema_init (&done, 0);
+    child->waiter = &done;
+    sema_down (&done);
+  }
+  for (e = list_begin (&p->finished_list); e != list_end (&p->finished_list);
+       e = list_next (e))
+    if (list_entry (e, struct finished_elem, elem)->tid == child_tid)
+    {
+      f = list_entry (e, struct finished_elem, elem);
+      list_remove (&f->elem);
+      status = f->status;
+      break;
+    }
+  intr_set_level (old_level);
+
+  free (f);
+  return status;
 }
 
-/* Free the current process's resources. */
+/* Frees the current thread's part of its process, and the whole
+   process if it is the last thread. */
   void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
-  struct finished_elem* f;
+  struct process *p = cur->process;
+  struct finished_elem* f = NULL;
+  struct user_thread *ut;
   struct list_elem* pos, *next;
+  enum intr_level old_level;
   uint32_t *pd;
 
-
-  if(!list_empty(&cur->finished_list)){
-    for(pos = list_begin(&cur->finished_list) ; 
-        pos != list_end(&cur->finished_list) ; pos = next){
-      f = list_entry(pos, struct finished_elem, elem);
-      next = pos->next;
-      free(f);
+  if (p == NULL)
+    return;
+
+  /* Other threads give back their stacks and go, leaving the
+     process to the last one.  Once such a thread drops the count,
+     the last thread may free its user_thread, the page directory
+     and P at any time, so it does everything else first and drops
+     the count last.  Interrupts stay off from the test to the
+     decrement, so that no other thread of the process runs in
+     between and two threads cannot both see themselves as last,
+     or neither. */
+  ut = find_thread (p, cur->tid);
+  if (ut != NULL && ut->stack != NULL)
+  {
+    void *kpage = pagedir_get_page (cur->pagedir, ut->stack);
+    pagedir_clear_page (cur->pagedir, ut->stack);
+    palloc_free_page (kpage);
+    ut->stack = NULL;
+  }
+  old_level = intr_disable ();
+  if (p->thread_cnt > 1)
+  {
+    if (ut != NULL)
+      sema_up (&ut->done);
+    cur->pagedir = NULL;
+    pagedir_activate (NULL);
+    cur->process = NULL;
+    p->thread_cnt--;
+    intr_set_level (old_level);
+    return;
+  }
+  p->thread_cnt--;
+  intr_set_level (old_level);
+
+  /* Shared frames must leave the page directory before
+     pagedir_destroy() frees everything in it.  Do it before waking
+     our parent, too, so that a segment we held the last reference
+     to is gone by the time wait() returns. */
+  shm_exit ();
+
+  /* Children outlive us without a parent; our parent gets our exit
+     status. */
+  if (p->parent != NULL)
+    f = malloc (sizeof *f);
+  old_level = intr_disable ();
+  for (pos = list_begin (&p->child_list); pos != list_end (&p->child_list);
+       pos = list_next (pos))
+    list_entry (pos, struct process, child_elem)->parent = NULL;
+  if (p->parent != NULL)
+  {
+    list_remove (&p->child_elem);
+    if (f != NULL)
+    {
+      f->tid = p->pid;
+      f->status = p->exit;
+      list_push_back (&p->parent->finished_list, &f->elem);
     }
+    if (p->waiter != NULL)
+      sema_up (p->waiter);
+  }
+  intr_set_level (old_level);
+
+  for (pos = list_begin (&p->finished_list);
+       pos != list_end (&p->finished_list); pos = next)
+  {
+    next = list_next (pos);
+    free (list_entry (pos, struct finished_elem, elem));
   }
-  close_all_fd(&cur->fd_list);
-  if(cur->parent && cur->parent->is_waiting && cur->parent->waiting_now == cur->tid){
-    cur->parent->wait_exit = cur->exit; // status giving.
-    sema_up(&cur->parent->wait_sema);
+  for (pos = list_begin (&p->thread_list);
+       pos != list_end (&p->thread_list); pos = next)
+  {
+    next = list_next (pos);
+    free (list_entry (pos, struct user_thread, elem));
   }
-  if(cur->this_file)
-    file_close((struct file*)cur->this_file);
+  close_all_fd(&p->fd_list);
+  if(p->exec_file)
+    file_close(p->exec_file);
 
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
@@ -241,6 +458,8 @@ process_exit (void)
     pagedir_activate (NULL);
     pagedir_destroy (pd);
   }
+  cur->process = NULL;
+  free (p);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -361,7 +580,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
   // TODO: what will be happening if two or more thread open this executable?	
   // If problem, How to resolve this case?
   file_deny_write(file);
-  t->this_file = file;
+  t->process->exec_file = file;
 
 
   /* Read and verify executable header. */
@@ -429,6 +648,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
           if (!load_segment (file, file_page, (void *) mem_page,
                 read_bytes, zero_bytes, writable))
             goto done;
+          // heap starts at the page after the highest segment
+          if ((uint8_t *) mem_page + read_bytes + zero_bytes > t->process->heap_start)
+            t->process->heap_start = (uint8_t *) mem_page + read_bytes + zero_bytes;
         }
         else
           goto done;
@@ -436,6 +658,8 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
   }
 
+  t->process->heap_break = t->process->heap_start;
+
   /* Set up stack. */
   if (!setup_stack (esp))
     goto done;
@@ -599,3 +823,250 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
       && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+
+/* User stacks of threads other than a process's first, whose
+   stack is the page just below PHYS_BASE, go below it, in the
+   megabyte above SHM_END.  Each is one page, with an unmapped
+   guard page above it. */
+#define THREAD_STACK_CNT ((size_t) ((uint8_t *) PHYS_BASE - SHM_END) \
+                          / (2 * PGSIZE) - 1)
+
+/* Handed by process_thread_create() to start_thread(), on the
+   creating thread's stack, which waits until the new thread is
+   ready to enter user mode. */
+struct thread_info
+  {
+    struct process *process;            /* Process to join. */
+    uint32_t *pagedir;                  /* Its page directory. */
+    void (*start) (void);               /* User code to run. */
+    void *func, *aux;                   /* Arguments to START. */
+    struct semaphore started;           /* Upped once started. */
+    bool success;                       /* Did it start? */
+  };
+
+/* Starts a new thread in the current process.  In user mode it
+   begins at START, on a stack of its own, as if called as
+   START (FUNC, AUX).  Returns the new thread's id, or TID_ERROR
+   if it cannot be started. */
+  tid_t
+process_thread_create (void (*start) (void), void *func, void *aux)
+{
+  struct thread *cur = thread_current ();
+  struct thread_info info;
+  tid_t tid;
+
+  info.process = cur->process;
+  info.pagedir = cur->pagedir;
+  info.start = start;
+  info.func = func;
+  info.aux = aux;
+  sema_init (&info.started, 0);
+  info.success = false;
+
+  tid = thread_create (cur->name, PRI_DEFAULT, start_thread, &info);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+  sema_down (&info.started);
+  return info.success ? tid : TID_ERROR;
+}
+
+/* A thread function that sets up a thread made by
+   process_thread_create() and enters user mode. */
+  static void
+start_thread (void *info_)
+{
+  struct thread_info *info = info_;
+  struct thread *t = thread_current ();
+  struct process *p = info->process;
+  struct user_thread *ut = malloc (sizeof *ut);
+  struct intr_frame if_;
+  uint8_t *kpage = NULL, *upage = NULL;
+  uint32_t *top;
+  enum intr_level old_level;
+  size_t i;
+
+  /* Join the process, so that process_exit() undoes the rest. */
+  t->process = p;
+  t->pagedir = info->pagedir;
+  old_level = intr_disable ();
+  p->thread_cnt++;
+  intr_set_level (old_level);
+  process_activate ();
+  if (ut == NULL || p->exiting)
+    goto fail;
+  ut->tid = t->tid;
+  ut->stack = NULL;
+  ut->joined = false;
+  sema_init (&ut->done, 0);
+
+  /* Map the first free stack slot. */
+  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    goto fail;
+  for (i = 1; i <= THREAD_STACK_CNT && ut->stack == NULL; i++)
+  {
+    upage = (uint8_t *) PHYS_BASE - (2 * i + 1) * PGSIZE;
+    if (install_page (upage, kpage, true))
+      ut->stack = upage;
+  }
+  if (ut->stack == NULL)
+  {
+    palloc_free_page (kpage);
+    goto fail;
+  }
+
+  /* Only now may the thread be joined.  Before, the fail path
+     frees UT, which must not be on the list then. */
+  list_push_back (&p->thread_list, &ut->elem);
+
+  /* Arguments and a null return address for START. */
+  top = (uint32_t *) (kpage + PGSIZE);
+  top[-1] = (uint32_t) info->aux;
+  top[-2] = (uint32_t) info->func;
+  top[-3] = 0;
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = info->start;
+  if_.esp = upage + PGSIZE - 3 * sizeof *top;
+  info->success = true;
+  sema_up (&info->started);
+
+  /* Enter user mode as start_process() does. */
+  intr_disable ();
+  kernel_lock_release ();
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+
+ fail:
+  free (ut);
+  sema_up (&info->started);
+  thread_exit ();
+}
+
+/* Waits for thread TID of the current process to exit.  Returns
+   TID, or -1 if TID is the caller, is not in the process, or has
+   already been joined. */
+  int
+process_thread_join (tid_t tid)
+{
+  struct process *p = thread_current ()->process;
+  struct user_thread *ut = find_thread (p, tid);
+
+  if (ut == NULL || ut->joined || tid == thread_current ()->tid)
+    return -1;
+  ut->joined = true;
+  sema_down (&ut->done);
+  list_remove (&ut->elem);
+  free (ut);
+  return tid;
+}
+
+/* Marks the current process as exiting with STATUS.  Its other
+   threads exit on their way back to user mode; any running on
+   another CPU is interrupted to hurry it there.  Returns false,
+   changing nothing, if the process is already exiting. */
+  bool
+process_set_exiting (int status)
+{
+  struct process *p = thread_current ()->process;
+  enum intr_level old_level;
+  unsigned i;
+
+  if (p == NULL || p->exiting)
+    return false;
+  p->exiting = true;
+  p->exit = status;
+
+  old_level = intr_disable ();
+  for (i = 0; i < cpu_cnt; i++)
+    if (&cpus[i] != cpu_current () && cpus[i].started
+        && cpus[i].thread->process == p)
+      smp_reschedule (&cpus[i]);
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Returns true if the running thread is part of a process that
+   is exiting, so that it should exit instead of returning to
+   user mode. */
+  bool
+process_exiting (void)
+{
+  struct process *p = thread_current ()->process;
+  return p != NULL && p->exiting;
+}
+
+/* Moves the current process's program break by INCREMENT bytes,
+   which may be negative.  Returns the previous break, or
+   (void *) -1 if the heap cannot grow or shrink that far; it
+   may not grow into the shared memory window (see shm.h).
+   Growing maps no memory: heap pages are allocated by
+   process_heap_fault() when first touched.  Shrinking frees the
+   pages that lie wholly above the new break. */
+  void *
+process_sbrk (intptr_t increment)
+{
+  struct thread *t = thread_current ();
+  struct process *p = t->process;
+  uint8_t *old_break = p->heap_break;
+  uint8_t *new_break = old_break + increment;
+  uint8_t *upage;
+
+  if (increment > 0
+      ? (new_break < old_break
+         || new_break > SHM_BASE)
+      : (new_break > old_break || new_break < p->heap_start))
+    return (void *) -1;
+
+  for (upage = pg_round_up (new_break); upage < old_break; upage += PGSIZE)
+  {
+    void *kpage = pagedir_get_page (t->pagedir, upage);
+    if (kpage != NULL)
+    {
+      pagedir_clear_page (t->pagedir, upage);
+      palloc_free_page (kpage);
+    }
+  }
+  p->heap_break = new_break;
+  return old_break;
+}
+
+/* Returns true if UADDR lies in the current process's heap. */
+  bool
+process_heap_contains (const void *uaddr)
+{
+  struct process *p = thread_current ()->process;
+  return p != NULL
+    && (const uint8_t *) uaddr >= p->heap_start
+    && (const uint8_t *) uaddr < p->heap_break;
+}
+
+/* Maps a zeroed page at FAULT_ADDR if it lies in the current
+   process's heap and has not been touched yet.  Returns true if
+   the faulting access can be retried. */
+  bool
+process_heap_fault (void *fault_addr)
+{
+  struct thread *t = thread_current ();
+  uint8_t *kpage;
+
+  if (t->pagedir == NULL || !process_heap_contains (fault_addr))
+    return false;
+
+  /* Another thread may have faulted on the same page first. */
+  if (pagedir_get_page (t->pagedir, fault_addr) != NULL)
+    return true;
+
+  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL)
+    return false;
+  if (!install_page (pg_round_down (fault_addr), kpage, true))
+  {
+    palloc_free_page (kpage);
+    return false;
+  }
+  return true;
+}
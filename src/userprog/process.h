@@ -1,11 +1,53 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <list.h>
 #include "threads/thread.h"
 
+/* A user process: the state that its threads share.
+
+   process_execute() starts a process with one thread, whose tid
+   is the process's pid; process_thread_create() adds more.  They
+   all run on the same page directory.  A thread that calls
+   exit() marks the process as exiting, and the others exit the
+   next time they are about to return to user mode, which for one
+   asleep in the kernel is when it wakes up.  The last thread to
+   exit frees the process. */
+struct process
+  {
+    tid_t pid;                          /* Process id. */
+    int exit;                           /* Exit status. */
+    bool exiting;                       /* Has exit() been called? */
+    unsigned thread_cnt;                /* Threads not yet exited. */
+    struct list thread_list;            /* Threads not yet joined. */
+
+    /* Resources. */
+    struct list fd_list;                /* Open fds, see syscall.c. */
+    struct list shm_list;               /* Shared memory, see shm.c. */
+    struct file *exec_file;             /* Executable, denied writes. */
+    uint8_t *heap_start;                /* Start of sbrk() heap. */
+    uint8_t *heap_break;                /* Current program break. */
+
+    /* Parent and children.  Changed with interrupts off. */
+    struct process *parent;             /* Null once the parent exits. */
+    struct list_elem child_elem;        /* Element in parent's child_list. */
+    struct semaphore *waiter;           /* Upped at exit, if waited for. */
+    struct list child_list;             /* Children still running. */
+    struct list finished_list;          /* Exit statuses not yet waited for. */
+  };
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+tid_t process_thread_create (void (*start) (void), void *func, void *aux);
+int process_thread_join (tid_t);
+bool process_set_exiting (int status);
+bool process_exiting (void);
+
+void *process_sbrk (intptr_t increment);
+bool process_heap_contains (const void *uaddr);
+bool process_heap_fault (void *fault_addr);
+
 #endif /* userprog/process.h */
@@ -0,0 +1,299 @@
+#include "userprog/shm.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
+
+/* Shared memory segments.
+
+   A segment is a named run of zeroed pages that any process may
+   open by name and map into its address space.  Every mapping
+   has the same frames behind it, so what one process stores, the
+   others see at once, without a trip through the file system.
+
+   Each process that has a segment open holds one reference to
+   it, through a struct shm_mapping in its shm_list.  The
+   reference goes away when the process unmaps the segment or
+   exits, and the last one frees the segment and its frames. */
+struct shm
+  {
+    struct list_elem elem;              /* Element in `segments'. */
+    int id;                             /* Identifier. */
+    char name[SHM_NAME_MAX + 1];        /* Name. */
+    size_t page_cnt;                    /* Size in pages. */
+    void **pages;                       /* Frames, as kernel addresses. */
+    unsigned ref_cnt;                   /* Processes that have it open. */
+  };
+
+/* A segment that a process has open. */
+struct shm_mapping
+  {
+    struct list_elem elem;              /* Element in shm_list. */
+    struct shm *shm;                    /* The segment. */
+    uint8_t *upage;                     /* Where mapped, or null. */
+  };
+
+/* All segments, and the lock that protects the list, ref_cnt, and
+   next_id.  A segment's other members do not change once it is
+   created. */
+static struct list segments;
+static struct lock shm_lock;
+static int next_id;
+
+static struct shm *create (const char *name, size_t page_cnt);
+static void destroy (struct shm *);
+
+/* Initializes shared memory. */
+void
+shm_init (void)
+{
+  list_init (&segments);
+  lock_init (&shm_lock);
+}
+
+/* Opens the segment called NAME in the current process, first
+   creating it with SIZE bytes if there is none.  Opening a
+   segment that the process already has open opens nothing new.
+   Returns the segment's identifier, or -1 if NAME is too long,
+   or the segment is smaller than SIZE, or memory is short. */
+int
+shm_get (const char *name, size_t size)
+{
+  struct process *p = thread_current ()->process;
+  size_t page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  struct shm_mapping *m;
+  struct list_elem *e;
+  struct shm *s = NULL;
+  int id = -1;
+
+  if (strnlen (name, SHM_NAME_MAX + 1) > SHM_NAME_MAX
+      || page_cnt > SHM_WINDOW / PGSIZE)
+    return -1;
+  m = malloc (sizeof *m);
+  if (m == NULL)
+    return -1;
+
+  lock_acquire (&shm_lock);
+  for (e = list_begin (&segments); e != list_end (&segments);
+       e = list_next (e))
+    if (!strcmp (list_entry (e, struct shm, elem)->name, name))
+      {
+        s = list_entry (e, struct shm, elem);
+        break;
+      }
+  if (s == NULL && page_cnt > 0)
+    s = create (name, page_cnt);
+  if (s != NULL && s->page_cnt >= page_cnt)
+    {
+      id = s->id;
+      for (e = list_begin (&p->shm_list); e != list_end (&p->shm_list);
+           e = list_next (e))
+        if (list_entry (e, struct shm_mapping, elem)->shm == s)
+          break;
+      if (e == list_end (&p->shm_list))
+        {
+          s->ref_cnt++;
+          m->shm = s;
+          m->upage = NULL;
+          list_push_back (&p->shm_list, &m->elem);
+          m = NULL;
+        }
+    }
+  lock_release (&shm_lock);
+
+  free (m);
+  return id;
+}
+
+/* Returns the current process's mapping for the segment whose
+   identifier is ID, if it has that segment open and ID is not
+   -1; or the mapping at user address UPAGE, if ID is -1.
+   Returns a null pointer if there is no such mapping. */
+static struct shm_mapping *
+find_mapping (int id, const void *upage)
+{
+  struct process *p = thread_current ()->process;
+  struct list_elem *e;
+
+  for (e = list_begin (&p->shm_list); e != list_end (&p->shm_list);
+       e = list_next (e))
+    {
+      struct shm_mapping *m = list_entry (e, struct shm_mapping, elem);
+      if (id != -1 ? m->shm->id == id : m->upage == upage)
+        return m;
+    }
+  return NULL;
+}
+
+/* Returns the lowest user address in the shared memory window
+   of PD where PAGE_CNT pages in a row are free, or a null pointer
+   if there is none. */
+static uint8_t *
+find_window (uint32_t *pd, size_t page_cnt)
+{
+  uint8_t *start, *upage;
+
+  for (start = SHM_BASE; start + page_cnt * PGSIZE <= SHM_END;
+       start = upage + PGSIZE)
+    {
+      for (upage = start; upage < start + page_cnt * PGSIZE;
+           upage += PGSIZE)
+        if (pagedir_get_page (pd, upage) != NULL)
+          break;
+      if (upage == start + page_cnt * PGSIZE)
+        return start;
+    }
+  return NULL;
+}
+
+/* Unmaps the first PAGE_CNT pages of M from the current
+   process's page directory. */
+static void
+unmap_pages (struct shm_mapping *m, size_t page_cnt)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  size_t i;
+
+  for (i = 0; i < page_cnt; i++)
+    pagedir_clear_page (pd, m->upage + i * PGSIZE);
+}
+
+/* Maps the segment whose identifier is ID, which the current
+   process must have open, into its shared memory window, if it
+   is not mapped already.  Returns the user address where it is
+   mapped, or a null pointer if the process does not have it
+   open or there is no room. */
+void *
+shm_attach (int id)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  struct shm_mapping *m;
+  struct shm *s;
+  size_t i;
+
+  if (id == -1 || (m = find_mapping (id, NULL)) == NULL)
+    return NULL;
+  if (m->upage != NULL)
+    return m->upage;
+
+  s = m->shm;
+  m->upage = find_window (pd, s->page_cnt);
+  if (m->upage == NULL)
+    return NULL;
+  for (i = 0; i < s->page_cnt; i++)
+    if (!pagedir_set_page (pd, m->upage + i * PGSIZE, s->pages[i], true))
+      {
+        unmap_pages (m, i);
+        m->upage = NULL;
+        return NULL;
+      }
+  return m->upage;
+}
+
+/* Unmaps M, if it is mapped, closes its segment in the current
+   process, and frees M. */
+static void
+release (struct shm_mapping *m)
+{
+  struct shm *s = m->shm;
+  bool last;
+
+  if (m->upage != NULL)
+    unmap_pages (m, s->page_cnt);
+  list_remove (&m->elem);
+  free (m);
+
+  lock_acquire (&shm_lock);
+  last = --s->ref_cnt == 0;
+  if (last)
+    list_remove (&s->elem);
+  lock_release (&shm_lock);
+
+  if (last)
+    destroy (s);
+}
+
+/* Unmaps the segment mapped at user address UPAGE in the current
+   process and closes it.  Returns false if no segment is mapped
+   there. */
+bool
+shm_detach (void *upage)
+{
+  struct shm_mapping *m = upage != NULL ? find_mapping (-1, upage) : NULL;
+
+  if (m == NULL)
+    return false;
+  release (m);
+  return true;
+}
+
+/* Closes every segment that the current process has open.  Must
+   be called before its page directory is destroyed, since
+   pagedir_destroy() would free the shared frames too. */
+void
+shm_exit (void)
+{
+  struct process *p = thread_current ()->process;
+
+  while (!list_empty (&p->shm_list))
+    release (list_entry (list_front (&p->shm_list),
+                         struct shm_mapping, elem));
+}
+
+/* Creates a segment called NAME of PAGE_CNT zeroed pages and
+   adds it to `segments', with no references.  Returns the
+   segment, or a null pointer if memory is short.  Must be called
+   with shm_lock held. */
+static struct shm *
+create (const char *name, size_t page_cnt)
+{
+  struct shm *s = malloc (sizeof *s);
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&shm_lock));
+
+  if (s == NULL)
+    return NULL;
+  s->pages = malloc (page_cnt * sizeof *s->pages);
+  if (s->pages == NULL)
+    {
+      free (s);
+      return NULL;
+    }
+  for (i = 0; i < page_cnt; i++)
+    {
+      s->pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (s->pages[i] == NULL)
+        {
+          s->page_cnt = i;
+          destroy (s);
+          return NULL;
+        }
+    }
+
+  strlcpy (s->name, name, sizeof s->name);
+  s->id = next_id++;
+  s->page_cnt = page_cnt;
+  s->ref_cnt = 0;
+  list_push_back (&segments, &s->elem);
+  return s;
+}
+
+/* Frees segment S and its frames.  S must not be in
+   `segments'. */
+static void
+destroy (struct shm *s)
+{
+  size_t i;
+
+  for (i = 0; i < s->page_cnt; i++)
+    palloc_free_page (s->pages[i]);
+  free (s->pages);
+  free (s);
+}
@@ -0,0 +1,25 @@
+#ifndef USERPROG_SHM_H
+#define USERPROG_SHM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "threads/vaddr.h"
+
+/* Longest name of a shared memory segment. */
+#define SHM_NAME_MAX 14
+
+/* Shared memory segments are mapped at user virtual addresses
+   from SHM_BASE up to SHM_END, which lie between the heap, which
+   may not grow past SHM_BASE, and the megabyte left for the
+   stack. */
+#define SHM_WINDOW (64 * 1024 * 1024)
+#define SHM_END ((uint8_t *) PHYS_BASE - 1024 * 1024)
+#define SHM_BASE (SHM_END - SHM_WINDOW)
+
+void shm_init (void);
+int shm_get (const char *name, size_t size);
+void *shm_attach (int id);
+bool shm_detach (void *upage);
+void shm_exit (void);
+
+#endif /* userprog/shm.h */
@@ -1,7 +1,9 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/smp.h"
 #include "threads/thread.h"
 #include "threads/synch.h"
 
@@ -14,95 +16,410 @@
 #include "lib/user/syscall.h"
 #include "devices/shutdown.h"
 #include "userprog/process.h"
+#include "userprog/pipe.h"
+#include "userprog/shm.h"
 #include "devices/input.h"
-
-#define SYSCALL_NTH_ARG(f, n, type) (*((type *)((f)->esp + (n) * 4)))
+#include "devices/timer.h"
+#include "devices/block.h"
+#include "filesys/cache.h"
+#include "threads/trace.h"
 
 #define USERASSERT( COND ) { if ( !(COND) ) syscall_exit(-1); } 
 
 #define CHECK_VALID_FD(fd) USERASSERT(file_of_fd(fd))
 
-#define CHECK_VALID_WRITE_FD(fd) USERASSERT(file_of_fd(fd) || fd == STDOUT_FILENO)
-
-#define CHECK_VALID_READ_FD(fd) USERASSERT(file_of_fd(fd) || fd == STDIN_FILENO)
-
 #define USER_BASE_ADDR 0x08048000
 
 // note that vaddr must not be func(args)
-#define CHECK_VALID_USERADDR(vaddr) USERASSERT((is_user_vaddr(vaddr) && USER_BASE_ADDR < (vaddr)) && pagedir_get_page(thread_current()->pagedir, vaddr) != NULL )
+// heap pages not touched yet are mapped here, so that the kernel never
+// faults on them later, perhaps while holding filesys_lock.
+#define CHECK_VALID_USERADDR(vaddr) USERASSERT((is_user_vaddr(vaddr) && USER_BASE_ADDR < (uintptr_t) (vaddr)) && (pagedir_get_page(thread_current()->pagedir, vaddr) != NULL || process_heap_fault(vaddr)))
 
 
 
 static void syscall_handler (struct intr_frame *);
 
+// Most arguments any system call takes.
+#define SYSCALL_MAX_ARGS 3
+
+// Bit in a ptr_mask for argument N (0-based).
+#define PTR_ARG(n) (1u << (n))
+
+// Every system call goes through a wrapper of this type, which
+// unpacks ARGS into the arguments of the syscall_ function.
+typedef uint32_t syscall_func (const uint32_t *args);
+
+// A system call.
+struct syscall
+{
+  syscall_func *handler;   // wrapper, or NULL if not implemented
+  int argc;                // number of arguments
+  unsigned ptr_mask;       // PTR_ARG bits of user pointer arguments
+  const char *name;        // for syscall_print_stats()
+};
+
+  static uint32_t
+sys_halt (const uint32_t *args UNUSED)
+{
+  syscall_halt();
+}
+
+  static uint32_t
+sys_exit (const uint32_t *args)
+{
+  syscall_exit((int) args[0]);
+}
+
+  static uint32_t
+sys_exec (const uint32_t *args)
+{
+  return syscall_exec((const char *) args[0]);
+}
+
+  static uint32_t
+sys_wait (const uint32_t *args)
+{
+  return syscall_wait((pid_t) args[0]);
+}
+
+  static uint32_t
+sys_create (const uint32_t *args)
+{
+  return syscall_create((const char *) args[0], args[1]);
+}
+
+  static uint32_t
+sys_remove (const uint32_t *args)
+{
+  return syscall_remove((const char *) args[0]);
+}
+
+  static uint32_t
+sys_open (const uint32_t *args)
+{
+  return syscall_open((const char *) args[0]);
+}
+
+  static uint32_t
+sys_filesize (const uint32_t *args)
+{
+  return syscall_filesize((int) args[0]);
+}
+
+  static uint32_t
+sys_read (const uint32_t *args)
+{
+  return syscall_read((int) args[0], (void *) args[1], args[2]);
+}
+
+  static uint32_t
+sys_write (const uint32_t *args)
+{
+  return syscall_write((int) args[0], (const void *) args[1], args[2]);
+}
+
+  static uint32_t
+sys_seek (const uint32_t *args)
+{
+  syscall_seek((int) args[0], args[1]);
+  return 0;
+}
+
+  static uint32_t
+sys_tell (const uint32_t *args)
+{
+  return syscall_tell((int) args[0]);
+}
+
+  static uint32_t
+sys_close (const uint32_t *args)
+{
+  syscall_close((int) args[0]);
+  return 0;
+}
+
+  static uint32_t
+sys_chdir (const uint32_t *args)
+{
+  return syscall_chdir((const char *) args[0]);
+}
+
+  static uint32_t
+sys_mkdir (const uint32_t *args)
+{
+  return syscall_mkdir((const char *) args[0]);
+}
+
+  static uint32_t
+sys_readdir (const uint32_t *args)
+{
+  return syscall_readdir((int) args[0], (char *) args[1]);
+}
+
+  static uint32_t
+sys_isdir (const uint32_t *args)
+{
+  return syscall_isdir((int) args[0]);
+}
+
+  static uint32_t
+sys_inumber (const uint32_t *args)
+{
+  return syscall_inumber((int) args[0]);
+}
+
+  static uint32_t
+sys_ticks (const uint32_t *args UNUSED)
+{
+  return syscall_ticks();
+}
+
+  static uint32_t
+sys_blockstat (const uint32_t *args)
+{
+  return syscall_blockstat((int) args[0], (struct blockstat *) args[1]);
+}
+
+  static uint32_t
+sys_time_ns (const uint32_t *args)
+{
+  syscall_time_ns((uint64_t *) args[0]);
+  return 0;
+}
+
+  static uint32_t
+sys_cachestat (const uint32_t *args)
+{
+  return syscall_cachestat((struct cachestat *) args[0]);
+}
+
+  static uint32_t
+sys_sbrk (const uint32_t *args)
+{
+  return (uint32_t) syscall_sbrk((intptr_t) args[0]);
+}
+
+  static uint32_t
+sys_pipe (const uint32_t *args)
+{
+  return syscall_pipe((int *) args[0]);
+}
+
+  static uint32_t
+sys_dup (const uint32_t *args)
+{
+  return syscall_dup((int) args[0]);
+}
+
+  static uint32_t
+sys_dup2 (const uint32_t *args)
+{
+  return syscall_dup2((int) args[0], (int) args[1]);
+}
+
+  static uint32_t
+sys_shm_open (const uint32_t *args)
+{
+  return syscall_shm_open((const char *) args[0], args[1]);
+}
+
+  static uint32_t
+sys_shm_map (const uint32_t *args)
+{
+  return (uint32_t) syscall_shm_map((int) args[0]);
+}
+
+  static uint32_t
+sys_shm_unmap (const uint32_t *args)
+{
+  return syscall_shm_unmap((void *) args[0]);
+}
+
+  static uint32_t
+sys_thread_create (const uint32_t *args)
+{
+  return syscall_thread_create((void *) args[0], (void *) args[1],
+                               (void *) args[2]);
+}
+
+  static uint32_t
+sys_thread_exit (const uint32_t *args UNUSED)
+{
+  syscall_thread_exit();
+}
+
+  static uint32_t
+sys_thread_join (const uint32_t *args)
+{
+  return syscall_thread_join((int) args[0]);
+}
+
+  static uint32_t
+sys_thread_yield (const uint32_t *args UNUSED)
+{
+  syscall_thread_yield();
+  return 0;
+}
+
+// Indexed by SYS_* number.  MMAP and MUNMAP have no entry: NO VM.
+static const struct syscall syscall_table[] =
+{
+  [SYS_HALT]      = {sys_halt,      0, 0,          "halt"},
+  [SYS_EXIT]      = {sys_exit,      1, 0,          "exit"},
+  [SYS_EXEC]      = {sys_exec,      1, PTR_ARG(0), "exec"},
+  [SYS_WAIT]      = {sys_wait,      1, 0,          "wait"},
+  [SYS_CREATE]    = {sys_create,    2, PTR_ARG(0), "create"},
+  [SYS_REMOVE]    = {sys_remove,    1, PTR_ARG(0), "remove"},
+  [SYS_OPEN]      = {sys_open,      1, PTR_ARG(0), "open"},
+  [SYS_FILESIZE]  = {sys_filesize,  1, 0,          "filesize"},
+  [SYS_READ]      = {sys_read,      3, PTR_ARG(1), "read"},
+  [SYS_WRITE]     = {sys_write,     3, PTR_ARG(1), "write"},
+  [SYS_SEEK]      = {sys_seek,      2, 0,          "seek"},
+  [SYS_TELL]      = {sys_tell,      1, 0,          "tell"},
+  [SYS_CLOSE]     = {sys_close,     1, 0,          "close"},
+  [SYS_CHDIR]     = {sys_chdir,     1, PTR_ARG(0), "chdir"},
+  [SYS_MKDIR]     = {sys_mkdir,     1, PTR_ARG(0), "mkdir"},
+  [SYS_READDIR]   = {sys_readdir,   2, PTR_ARG(1), "readdir"},
+  [SYS_ISDIR]     = {sys_isdir,     1, 0,          "isdir"},
+  [SYS_INUMBER]   = {sys_inumber,   1, 0,          "inumber"},
+  [SYS_TICKS]     = {sys_ticks,     0, 0,          "ticks"},
+  [SYS_BLOCKSTAT] = {sys_blockstat, 2, PTR_ARG(1), "blockstat"},
+  [SYS_TIME_NS]   = {sys_time_ns,   1, PTR_ARG(0), "time_ns"},
+  [SYS_CACHESTAT] = {sys_cachestat, 1, PTR_ARG(0), "cachestat"},
+  [SYS_SBRK]      = {sys_sbrk,      1, 0,          "sbrk"},
+  [SYS_PIPE]      = {sys_pipe,      1, PTR_ARG(0), "pipe"},
+  [SYS_DUP]       = {sys_dup,       1, 0,          "dup"},
+  [SYS_DUP2]      = {sys_dup2,      2, 0,          "dup2"},
+  [SYS_SHM_OPEN]  = {sys_shm_open,  2, PTR_ARG(0), "shm_open"},
+  [SYS_SHM_MAP]   = {sys_shm_map,   1, 0,          "shm_map"},
+  [SYS_SHM_UNMAP] = {sys_shm_unmap, 1, 0,          "shm_unmap"},
+  [SYS_THREAD_CREATE] = {sys_thread_create, 3, 0,    "thread_create"},
+  [SYS_THREAD_EXIT]   = {sys_thread_exit,   0, 0,    "thread_exit"},
+  [SYS_THREAD_JOIN]   = {sys_thread_join,   1, 0,    "thread_join"},
+  [SYS_THREAD_YIELD]  = {sys_thread_yield,  0, 0,    "thread_yield"},
+};
+
+#define SYSCALL_CNT (sizeof syscall_table / sizeof *syscall_table)
+
+// calls made to each system call, for syscall_print_stats()
+static unsigned long long syscall_cnt[SYSCALL_CNT];
+
+static const struct syscall *syscall_lookup (uint32_t number);
+static uint32_t syscall_dispatch (uint32_t number, const struct syscall *,
+                                  const uint32_t *args);
+
 // lock used by allocate_fd()
 static struct lock fd_lock;
 
-  struct file*
-file_of_fd(int fd)
+// Returns the current thread's fd_elem for FD, or NULL if FD has none.
+  static struct fd_elem*
+fd_lookup(int fd)
 {
   struct thread* cur = thread_current();
   struct list_elem* pos;
   struct fd_elem* pos_fd;
 
-  if(list_empty(&cur->fd_list))
-    return NULL;
-
-  for(pos = list_begin (&cur->fd_list) ; 
-      pos != list_end (&cur->fd_list) ; pos = pos->next){
+  for(pos = list_begin (&cur->process->fd_list) ; 
+      pos != list_end (&cur->process->fd_list) ; pos = pos->next){
     pos_fd = list_entry(pos, struct fd_elem, elem);
     if(pos_fd->fd == fd)
-      return pos_fd->this_file;
+      return pos_fd;
   }
   return NULL;
 }
 
+// Returns what FD, whose fd_elem is E (or NULL), refers to.
+// Kills the process if FD is not open.
+  static enum fd_type
+fd_type_of(int fd, struct fd_elem* e)
+{
+  if(e != NULL)
+    return e->type;
+  USERASSERT(fd == STDIN_FILENO || fd == STDOUT_FILENO);
+  return fd == STDIN_FILENO ? FD_CONSOLE_IN : FD_CONSOLE_OUT;
+}
+
+// Returns a new fd_elem numbered FD that refers to the same console
+// or pipe end as type TYPE and pipe P, taking a reference to the pipe
+// end.  Returns NULL if memory is short.
+  static struct fd_elem*
+fd_share(int fd, enum fd_type type, struct pipe* p)
+{
+  struct fd_elem* e;
+
+  ASSERT(type != FD_FILE);
+  e = malloc(sizeof *e);
+  if(e == NULL)
+    return NULL;
+  e->fd = fd;
+  e->type = type;
+  e->this_file = NULL;
+  e->pipe = p;
+  if(p != NULL)
+    pipe_open(p, type == FD_PIPE_WRITE);
+  return e;
+}
+
+// Closes whatever E refers to, and removes and frees E.
+  static void
+fd_release(struct fd_elem* e)
+{
+  if(e->type == FD_FILE){
+    lock_acquire(&filesys_lock);
+    file_close(e->this_file); // it has file_allow_write in it's content
+    lock_release(&filesys_lock);
+  }
+  else if(e->type == FD_PIPE_READ || e->type == FD_PIPE_WRITE)
+    pipe_close(e->pipe, e->type == FD_PIPE_WRITE);
+  list_remove(&e->elem);
+  free(e);
+}
+
+// Returns FD's file, or NULL if FD is not an open file.
+  struct file*
+file_of_fd(int fd)
+{
+  struct fd_elem* e = fd_lookup(fd);
+  return e != NULL ? e->this_file : NULL;
+}
+
 // Check current thread have fd in it's fd list.
 
   bool
 close_with_fd(int fd)
 {
-  struct thread* cur = thread_current();
-  struct list_elem* pos;
-  struct fd_elem* pos_fd;
-
-  if(list_empty(&cur->fd_list)) return false;
+  struct fd_elem* e = fd_lookup(fd);
 
-  for(pos = list_begin (&cur->fd_list) ; 
-      pos != list_end (&cur->fd_list) ; pos = pos->next){
-    pos_fd = list_entry(pos, struct fd_elem, elem);
-    if(pos_fd->fd == fd){
-      lock_acquire(&filesys_lock);
-      file_close(pos_fd->this_file); // it has file_allow_write in it's content
-      lock_release(&filesys_lock);
-      list_remove(pos);
-      free(pos_fd);
-      return true;
-    }
-  }
-  return false;
+  if(e == NULL) return false;
+  fd_release(e);
+  return true;
 }
 
   void
 close_all_fd(struct list* fd_list)
 {
-  struct list_elem* pos, *next;
-  struct fd_elem* pos_fd;
+  while(!list_empty(fd_list))
+    fd_release(list_entry(list_front(fd_list), struct fd_elem, elem));
+}
 
-  if(list_empty(fd_list)) return;
+// Gives the current thread the stdin and stdout of the parent whose
+// fd_list is PARENT_FD_LIST, so that a pipeline's stages are joined
+// by pipes.  Called while the parent waits in process_execute().
+  void
+inherit_std_fd(struct list* parent_fd_list)
+{
+  struct list_elem* pos;
+  struct fd_elem* pos_fd, *e;
 
-  for(pos = list_begin (fd_list) ; 
-      pos != list_end (fd_list) ; pos = next){
+  for(pos = list_begin (parent_fd_list) ; 
+      pos != list_end (parent_fd_list) ; pos = pos->next){
     pos_fd = list_entry(pos, struct fd_elem, elem);
-    next = pos->next;
-
-    lock_acquire(&filesys_lock);
-    file_close(pos_fd->this_file); // it has file_allow_write in it's content
-    lock_release(&filesys_lock);
-    list_remove(pos);
-    free(pos_fd);
+    if(pos_fd->fd != STDIN_FILENO && pos_fd->fd != STDOUT_FILENO)
+      continue;
+    e = fd_share(pos_fd->fd, pos_fd->type, pos_fd->pipe);
+    if(e != NULL)
+      list_push_back(&thread_current()->process->fd_list, &e->elem);
   }
-  list_init(fd_list);
 }
 
   static int
@@ -121,109 +438,113 @@ allocate_fd(void)
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  // sysenter is set up by tss_init().
   lock_init(&fd_lock);
   lock_init(&filesys_lock);
+  shm_init();
 }
 
+// int $0x30 entry: number and arguments are on the user stack.
+// The whole argument block is validated once and copied in.
   static void
 syscall_handler (struct intr_frame *f) 
 {
+  uint32_t *esp = f->esp;
+  uint32_t args[SYSCALL_MAX_ARGS];
+  const struct syscall *sc;
+
+  // the number itself must lie in mapped user memory
+  CHECK_VALID_USERADDR(esp);
+  CHECK_VALID_USERADDR((uint8_t *) esp + 3);
+
+  sc = syscall_lookup(esp[0]);
+  if(sc == NULL)
+    return;
 
-  // have to check f is valid (128MB)
-  CHECK_VALID_USERADDR(f->esp);
-
-  //	sysno = *(int*)(f->esp);
-  //	ASSERT(SYS_HALT <= sysno && sysno <= SYS_INUMBER);
-
-
-  //	if(sysno == 9)
-  //		printf("%s : [[[[[[[%d]]]]]]], f->esp = %p [fd %d] [void* %p] [size %d]\n", thread_current()->name, sysno, f->esp, SYSCALL_NTH_ARG(f, 5, int), SYSCALL_NTH_ARG(f, 6, void*), SYSCALL_NTH_ARG(f, 7, int));
-  switch(SYSCALL_NTH_ARG(f, 0, int)){
-    case SYS_HALT:
-      syscall_halt();
-      break;		// NOT_REACHED
-    case SYS_EXIT:
-      USERASSERT(is_user_vaddr(f->esp+4));
-      syscall_exit(SYSCALL_NTH_ARG(f, 1, int));
-      break;
-    case SYS_EXEC:                   /* Start another process. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      f->eax = syscall_exec(SYSCALL_NTH_ARG(f, 1, char*));
-      break;
-    case SYS_WAIT:                   /* Wait for a child process to die. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      f->eax = syscall_wait(SYSCALL_NTH_ARG(f, 1, pid_t));
-      break;
-    case SYS_CREATE:                 /* Create a file. */
-      USERASSERT(is_user_vaddr(f->esp + 8));
-      f->eax = syscall_create(SYSCALL_NTH_ARG(f, 1, char*), SYSCALL_NTH_ARG(f, 2, unsigned));
-      break;
-    case SYS_REMOVE:                 /* Delete a file. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      f->eax = syscall_remove(SYSCALL_NTH_ARG(f, 1, char*));
-      break;
-    case SYS_OPEN:                   /* Open a file. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      f->eax = syscall_open(SYSCALL_NTH_ARG(f, 1, char*));
-      break;
-    case SYS_FILESIZE:               /* Obtain a file's size. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      f->eax = syscall_filesize(SYSCALL_NTH_ARG(f, 1, int));
-      break;
-    case SYS_READ:                   /* Read from a file. */		
-      USERASSERT(is_user_vaddr(f->esp + 12));
-      CHECK_VALID_USERADDR(SYSCALL_NTH_ARG(f, 2, void*));
-      f->eax = syscall_read(SYSCALL_NTH_ARG(f, 1, int), SYSCALL_NTH_ARG(f, 2, void*), SYSCALL_NTH_ARG(f, 3, unsigned));
-      break;
-    case SYS_WRITE:                  /* Write to a file. */
-      // check buffer is in valid space	
-      USERASSERT(is_user_vaddr(f->esp + 12));
-      CHECK_VALID_USERADDR(SYSCALL_NTH_ARG(f, 2, void*));
-      f->eax = syscall_write(SYSCALL_NTH_ARG(f, 1, int), SYSCALL_NTH_ARG(f, 2, void*), SYSCALL_NTH_ARG(f, 3, unsigned));
-      break;
-    case SYS_SEEK:                   /* Change position in a file. */
-      USERASSERT(is_user_vaddr(f->esp + 8));
-      syscall_seek(SYSCALL_NTH_ARG(f, 1, int), SYSCALL_NTH_ARG(f, 2, unsigned));
-      break;
-    case SYS_TELL:                  /* Report current position in a file. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      syscall_tell(SYSCALL_NTH_ARG(f, 1, int));
-      break;
-    case SYS_CLOSE:                  /* Close a file. */
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      syscall_close(SYSCALL_NTH_ARG(f, 1, int));
-      break;
-      // NO VM
-    case SYS_MMAP:
-    case SYS_MUNMAP:
-      break;
-    case SYS_CHDIR:
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      CHECK_VALID_USERADDR(SYSCALL_NTH_ARG(f, 1, char*));
-      syscall_chdir(SYSCALL_NTH_ARG(f, 1, char*));
-      break;
-    case SYS_MKDIR:
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      CHECK_VALID_USERADDR(SYSCALL_NTH_ARG(f, 1, char*));
-      syscall_mkdir(SYSCALL_NTH_ARG(f, 1, char*));
-      break;
-    case SYS_READDIR:
-      USERASSERT(is_user_vaddr(f->esp + 8));
-      CHECK_VALID_USERADDR(SYSCALL_NTH_ARG(f, 2, char*));
-      syscall_readdir(SYSCALL_NTH_ARG(f, 1, int), SYSCALL_NTH_ARG(f, 2, char*));
-      break;
-    case SYS_ISDIR: 
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      syscall_isdir(SYSCALL_NTH_ARG(f, 1, int));
-      break;
-    case SYS_INUMBER: 
-      USERASSERT(is_user_vaddr(f->esp + 4));
-      syscall_inumber(SYSCALL_NTH_ARG(f, 1, int));
-      break;
-    default:
-      printf ("Unknown System-Call");
-      break;
+  // arguments 1...argc, checked at their last byte
+  CHECK_VALID_USERADDR((uint8_t *) (esp + 1 + sc->argc) - 1);
+  memcpy(args, esp + 1, sc->argc * sizeof *args);
+
+  f->eax = syscall_dispatch(esp[0], sc, args);
+}
+
+// sysenter entry, called from syscall_sysenter with the number and
+// arguments that arrived in eax, ebx, esi, and edi.  The arguments
+// never touch the user stack, so there is nothing to copy.
+// sysenter bypasses intr_handler(), so the kernel lock is taken and
+// given back here; interrupts stay off from the release to sysexit.
+  uint32_t
+syscall_fast_handler (uint32_t number, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+  uint32_t args[SYSCALL_MAX_ARGS];
+  const struct syscall *sc;
+  uint32_t retval = (uint32_t) -1;
+
+  kernel_lock_acquire();
+  sc = syscall_lookup(number);
+  if(sc != NULL){
+    args[0] = arg0;
+    args[1] = arg1;
+    args[2] = arg2;
+    retval = syscall_dispatch(number, sc, args);
   }
+
+  // another thread may have called exit() meanwhile
+  if(process_exiting())
+    thread_exit();
+  intr_disable();
+  kernel_lock_release();
+  return retval;
+}
+
+// Returns the table entry for system call NUMBER, or NULL if there
+// is no such call.
+  static const struct syscall *
+syscall_lookup (uint32_t number)
+{
+  if(number >= SYSCALL_CNT || syscall_table[number].handler == NULL){
+    printf ("Unknown System-Call");
+    return NULL;
+  }
+  return &syscall_table[number];
+}
+
+// Carries out system call NUMBER, described by SC, with arguments
+// ARGS, which are already in kernel memory.  Returns the value for eax.
+  static uint32_t
+syscall_dispatch (uint32_t number, const struct syscall *sc, const uint32_t *args)
+{
+  uint32_t retval;
+  int i;
+
+  // user pointers must point into mapped user memory
+  for(i = 0; i < sc->argc; i++)
+    if(sc->ptr_mask & PTR_ARG(i))
+      CHECK_VALID_USERADDR((void *) args[i]);
+
+  syscall_cnt[number]++;
+  TRACE(TRACE_SYSCALL, number, args[0], args[1]);
+  retval = sc->handler(args);
+  TRACE(TRACE_SYSCALL_RETURN, number, retval, 0);
+  return retval;
+}
+
+// Prints the number of times each system call was made.
+  void
+syscall_print_stats (void)
+{
+  unsigned long long total = 0;
+  unsigned i;
+
+  for(i = 0; i < SYSCALL_CNT; i++)
+    total += syscall_cnt[i];
+  if(total == 0)
+    return;
+
+  printf ("Syscalls: %llu calls\n", total);
+  for(i = 0; i < SYSCALL_CNT; i++)
+    if(syscall_cnt[i] != 0)
+      printf ("  %-10s %llu\n", syscall_table[i].name, syscall_cnt[i]);
 }
 
   void 
@@ -236,17 +557,9 @@ syscall_halt (void)
   void 
 syscall_exit (int status)
 {
-  struct thread* cur = thread_current();	
-  struct finished_elem* f;
-  cur->exit = status;
-  if(cur->parent){
-    list_remove(&cur->child_elem);
-    f = (struct finished_elem*) malloc(sizeof(struct finished_elem)); // free at paren die
-    f->tid = cur->tid;
-    f->status = cur->exit;
-    list_push_back(&cur->parent->finished_list, &f->elem);
-  }
-  printf ("%s: exit(%d)\n", cur->name, cur->exit);
+  // only the first thread to exit sets the status, and says so
+  if(process_set_exiting(status))
+    printf ("%s: exit(%d)\n", thread_current()->name, status);
   thread_exit();
 }
 
@@ -263,57 +576,7 @@ pid_t syscall_exec (const char *file)
 
 int syscall_wait (pid_t t)
 {
-  bool find_succ = false, find_succ2 = false;
-  struct thread* cur = thread_current();
-  struct list_elem* pos;
-  struct thread* child;
-  struct finished_elem* finished;
-  // check t is in child list.
-  if(cur->is_waiting || (list_empty(&cur->child_list) && list_empty(&cur->finished_list)))
-    return -1;	
-
-  if(!list_empty(&cur->child_list)){
-    for(pos = list_begin(&cur->child_list);
-	pos != list_end(&cur->child_list) ;
-	pos = pos->next){
-      child = list_entry(pos, struct thread, child_elem);
-      if(t == child->tid){
-	find_succ = true;
-	break;
-      }
-    }
-  }
-  if(!find_succ && !list_empty(&cur->finished_list)){
-    for(pos = list_begin(&cur->finished_list);
-	pos != list_end(&cur->finished_list) ;
-	pos = pos->next){
-      finished = list_entry(pos, struct finished_elem, elem);
-      if(t == finished->tid){
-	find_succ2 = true;
-	break;
-      }
-    }
-  }
-  if(!find_succ && !find_succ2)
-    return -1;
-
-  if(find_succ){
-    cur->waiting_now = child->tid;
-    cur->is_waiting = true;
-    // sema_down and wait
-    sema_down(&cur->wait_sema);
-
-    cur->waiting_now = -1;
-    cur->is_waiting = false;
-    // reset
-  }
-  else{
-    cur->wait_exit = finished->status;
-    list_remove(&finished->elem);
-    free(finished);
-  }
-
-  return cur->wait_exit;
+  return process_wait(t);
 }
 
 
@@ -362,8 +625,10 @@ syscall_open (const char *file)
   // Only fd owner could act with fd.
   fdelem =  malloc(sizeof (struct fd_elem));
   fdelem->fd = allocate_fd();
+  fdelem->type = FD_FILE;
   fdelem->this_file = f;
-  list_push_back(&thread_current()->fd_list, &fdelem->elem);
+  fdelem->pipe = NULL;
+  list_push_back(&thread_current()->process->fd_list, &fdelem->elem);
 
   return fdelem->fd;
 }
@@ -382,40 +647,95 @@ syscall_filesize (int fd)
 }
 
 
+// Kills the process unless every byte of BUFFER[0...LENGTH-1] is in
+// mapped user memory, mapping heap pages that were not touched yet.
+// Files and pipes copy with a lock held, so a bad buffer must be
+// caught before, not by a page fault partway through.
+  static void
+check_user_buffer(const void* buffer, unsigned length)
+{
+  const uint8_t* pos = buffer;
+  const uint8_t* last = pos + length - 1;
+
+  if(length == 0)
+    return;
+  USERASSERT(last >= pos);
+  for(; pos <= last; pos = (const uint8_t*) pg_round_down(pos) + PGSIZE)
+    CHECK_VALID_USERADDR((void*) pos);
+  CHECK_VALID_USERADDR((void*) last);
+}
+
+// Copies the null-terminated user string SRC into the SIZE-byte
+// buffer DST, killing the process if any byte of it up to the null
+// terminator is not in mapped user memory.  Returns false if SRC
+// does not fit, so that kernel code never reads it in place, where
+// a fault could strike with a lock held.
+  static bool
+copy_user_string(char* dst, const char* src, size_t size)
+{
+  const uint8_t* pos = (const uint8_t*) src;
+  size_t i;
+
+  for(i = 0; i < size; i++, pos++){
+    if(i == 0 || pg_ofs(pos) == 0)
+      CHECK_VALID_USERADDR((void*) pos);
+    if((dst[i] = *pos) == '\0')
+      return true;
+  }
+  return false;
+}
+
   int 
 syscall_read (int fd, void *buffer, unsigned length)
 {
+  struct fd_elem* e = fd_lookup(fd);
   int t;
   uint8_t temp;
   int i = 0;
-  CHECK_VALID_READ_FD(fd);
-  if(fd == STDIN_FILENO){
+
+  check_user_buffer(buffer, length);
+  switch(fd_type_of(fd, e)){
+  case FD_CONSOLE_IN:
     while(length--){
       temp = input_getc();
       ((uint8_t*)buffer)[i++] = temp;
     }
     return i;
+  case FD_PIPE_READ:
+    return pipe_read(e->pipe, buffer, length);
+  case FD_FILE:
+    lock_acquire(&filesys_lock);
+    t = file_read(e->this_file, buffer, length);
+    lock_release(&filesys_lock);
+    return t;
+  default:
+    // console output or the write end of a pipe
+    syscall_exit(-1);
   }
-  lock_acquire(&filesys_lock);
-  t = file_read(file_of_fd(fd), buffer, length);
-  lock_release(&filesys_lock);
-  return t;
 }
 
   int 
 syscall_write (int fd, const void *buffer, unsigned length)
 {
+  struct fd_elem* e = fd_lookup(fd);
   int t;
-  CHECK_VALID_WRITE_FD(fd);
-  if(fd == STDOUT_FILENO){
+
+  check_user_buffer(buffer, length);
+  switch(fd_type_of(fd, e)){
+  case FD_CONSOLE_OUT:
     putbuf(buffer, length);
     return length;
+  case FD_PIPE_WRITE:
+    return pipe_write(e->pipe, buffer, length);
+  case FD_FILE:
+    lock_acquire(&filesys_lock);
+    t = file_write(e->this_file, buffer, length);
+    lock_release(&filesys_lock);
+    return t;
+  default:
+    // the keyboard or the read end of a pipe
+    syscall_exit(-1);
   }
-  lock_acquire(&filesys_lock);
-  t = file_write(file_of_fd(fd), buffer, length);
-  lock_release(&filesys_lock);
-//printf ("write_t: %d\n",t);
-  return t;
 }
 
   void 
@@ -443,38 +763,244 @@ syscall_tell (int fd)
   void 
 syscall_close (int fd)
 {
-  CHECK_VALID_FD(fd);
   USERASSERT(close_with_fd(fd));
 }
 
 
 
 bool 
-syscall_chdir(const char* dir)
+syscall_chdir(const char* dir UNUSED)
 {
   return true;
 }
 
 bool
-syscall_mkdir(const char* dir)
+syscall_mkdir(const char* dir UNUSED)
 {
   return true;
 }
 
 bool
-syscall_readdir(int fd, char* name)
+syscall_readdir(int fd UNUSED, char* name UNUSED)
 {
   return true;
 }
 
 bool 
-syscall_isdir(int fd)
+syscall_isdir(int fd UNUSED)
 {
   return true;
 }
 
 int 
-syscall_inumber(int fd)
+syscall_inumber(int fd UNUSED)
 {
   return -1;
 }
+
+int
+syscall_ticks(void)
+{
+  return timer_ticks();
+}
+
+// copies one direction of B's statistics out to the user's *IO
+  static void
+copy_io_stats(struct block* b, bool write, struct blockstat_io* io)
+{
+  struct block_io_stats stats;
+  int i;
+
+  block_get_io_stats(b, write, &stats);
+  io->requests = stats.requests;
+  io->sectors = stats.sectors;
+  io->sequential = stats.sequential;
+  io->queue_ns = stats.queue_ns;
+  io->service_ns = stats.service_ns;
+  for(i = 0; i < BLOCKSTAT_BUCKETS; i++)
+    io->latency[i] = i < BLOCK_LATENCY_BUCKETS ? stats.latency[i] : 0;
+}
+
+bool
+syscall_blockstat(int role, struct blockstat* st)
+{
+  struct block* b;
+
+  // both ends of *st must be mapped
+  CHECK_VALID_USERADDR((void*) st);
+  CHECK_VALID_USERADDR((void*) (st + 1) - 1);
+  if(role < 0 || role >= BLOCK_ROLE_CNT || !(b = block_get_role(role)))
+    return false;
+  block_get_stats(b, &st->read_cnt, &st->write_cnt);
+  copy_io_stats(b, false, &st->read);
+  copy_io_stats(b, true, &st->write);
+  return true;
+}
+
+void
+syscall_time_ns(uint64_t* ns)
+{
+  CHECK_VALID_USERADDR((void*) ns);
+  CHECK_VALID_USERADDR((void*) (ns + 1) - 1);
+  *ns = timer_ns();
+}
+
+bool
+syscall_cachestat(struct cachestat* st)
+{
+  struct cache_stats stats;
+
+  // both ends of *st must be mapped
+  CHECK_VALID_USERADDR((void*) st);
+  CHECK_VALID_USERADDR((void*) (st + 1) - 1);
+  cache_get_stats(&stats);
+  st->hits = stats.hits;
+  st->misses = stats.misses;
+  st->evictions = stats.evictions;
+  st->dirty_evictions = stats.dirty_evictions;
+  st->writebacks = stats.writebacks;
+  st->readaheads = stats.readaheads;
+  st->readahead_hits = stats.readahead_hits;
+  st->readahead_wasted = stats.readahead_wasted;
+  st->entries = stats.entries;
+  st->dirty = stats.dirty;
+  return true;
+}
+
+void*
+syscall_sbrk(intptr_t increment)
+{
+  return process_sbrk(increment);
+}
+
+int
+syscall_pipe(int* fds)
+{
+  struct thread* cur = thread_current();
+  struct pipe* p;
+  struct fd_elem* r, *w;
+
+  // both ints of fds[] must be mapped
+  CHECK_VALID_USERADDR((void*) (fds + 2) - 1);
+
+  p = pipe_create();
+  if(p == NULL)
+    return -1;
+  r = malloc(sizeof *r);
+  w = malloc(sizeof *w);
+  if(r == NULL || w == NULL){
+    free(r);
+    free(w);
+    pipe_close(p, false);
+    pipe_close(p, true);
+    return -1;
+  }
+
+  // pipe_create() opened one end of each kind, for these two
+  r->fd = allocate_fd();
+  r->type = FD_PIPE_READ;
+  r->this_file = NULL;
+  r->pipe = p;
+  w->fd = allocate_fd();
+  w->type = FD_PIPE_WRITE;
+  w->this_file = NULL;
+  w->pipe = p;
+  list_push_back(&cur->process->fd_list, &r->elem);
+  list_push_back(&cur->process->fd_list, &w->elem);
+
+  fds[0] = r->fd;
+  fds[1] = w->fd;
+  return 0;
+}
+
+// A file has its own position, which a copy could not share, so
+// only the console and pipe ends can be duplicated.
+int
+syscall_dup(int oldfd)
+{
+  struct fd_elem* old = fd_lookup(oldfd);
+  enum fd_type type = fd_type_of(oldfd, old);
+  struct fd_elem* e;
+
+  if(type == FD_FILE)
+    return -1;
+  e = fd_share(allocate_fd(), type, old != NULL ? old->pipe : NULL);
+  if(e == NULL)
+    return -1;
+  list_push_back(&thread_current()->process->fd_list, &e->elem);
+  return e->fd;
+}
+
+// NEWFD must be stdin or stdout: other fds come from allocate_fd()
+// alone, which keeps them unique.
+int
+syscall_dup2(int oldfd, int newfd)
+{
+  struct fd_elem* old = fd_lookup(oldfd);
+  enum fd_type type = fd_type_of(oldfd, old);
+  struct fd_elem* e;
+
+  if(type == FD_FILE || (newfd != STDIN_FILENO && newfd != STDOUT_FILENO))
+    return -1;
+  if(oldfd == newfd)
+    return newfd;
+  e = fd_share(newfd, type, old != NULL ? old->pipe : NULL);
+  if(e == NULL)
+    return -1;
+  close_with_fd(newfd);
+  list_push_back(&thread_current()->process->fd_list, &e->elem);
+  return newfd;
+}
+
+int
+syscall_shm_open(const char* name, unsigned size)
+{
+  char kname[SHM_NAME_MAX + 1];
+
+  USERASSERT(name);
+  if(!copy_user_string(kname, name, sizeof kname))
+    return -1;
+  return shm_get(kname, size);
+}
+
+void*
+syscall_shm_map(int id)
+{
+  return shm_attach(id);
+}
+
+bool
+syscall_shm_unmap(void* addr)
+{
+  return shm_detach(addr);
+}
+
+// Starts a thread in the current process at user address START,
+// which is called as START (FUNC, AUX).
+int
+syscall_thread_create(void* start, void* func, void* aux)
+{
+  USERASSERT(is_user_vaddr(start));
+  return process_thread_create((void (*) (void)) start, func, aux);
+}
+
+// Ends the calling thread, and its process too if it is the last one.
+void
+syscall_thread_exit(void)
+{
+  thread_exit();
+}
+
+int
+syscall_thread_join(int tid)
+{
+  return process_thread_join(tid);
+}
+
+// Gives up the CPU, so that a thread spinning on a user lock lets
+// its holder run.
+void
+syscall_thread_yield(void)
+{
+  thread_yield();
+}
@@ -6,11 +6,28 @@
 #include "lib/kernel/list.h"
 
 void syscall_init (void);
+void syscall_sysenter (void);
+uint32_t syscall_fast_handler (uint32_t number, uint32_t arg0,
+                               uint32_t arg1, uint32_t arg2);
+void syscall_print_stats (void);
 
+// what an fd refers to
+enum fd_type
+{
+	FD_FILE,        // this_file
+	FD_CONSOLE_IN,  // the keyboard, as fd 0 does by default
+	FD_CONSOLE_OUT, // the console, as fd 1 does by default
+	FD_PIPE_READ,   // read end of pipe
+	FD_PIPE_WRITE,  // write end of pipe
+};
+
+// Fds 0 and 1 have no fd_elem until dup2() gives them one.
 struct fd_elem
 {
 	int fd;
-	struct file* this_file;
+	enum fd_type type;
+	struct file* this_file; // FD_FILE only, else NULL
+	struct pipe* pipe;      // FD_PIPE_READ and FD_PIPE_WRITE only
 	struct list_elem elem;
 };
 
@@ -29,6 +46,8 @@ bool close_with_fd(int fd);
 
 void close_all_fd(struct list* fd_list);
 
+void inherit_std_fd(struct list* parent_fd_list);
+
 
 
 // To discriminate this with ../lib/user/syscall.c, add syscall_ prefix to system call.
@@ -51,6 +70,21 @@ bool syscall_mkdir(const char* dir);
 bool syscall_readdir(int fd, char* name);
 bool syscall_isdir(int fd);
 int syscall_inumber(int fd);
+int syscall_ticks(void);
+bool syscall_blockstat(int role, struct blockstat* st);
+void syscall_time_ns(uint64_t* ns);
+bool syscall_cachestat(struct cachestat* st);
+void* syscall_sbrk(intptr_t increment);
+int syscall_pipe(int* fds);
+int syscall_dup(int oldfd);
+int syscall_dup2(int oldfd, int newfd);
+int syscall_shm_open(const char* name, unsigned size);
+void* syscall_shm_map(int id);
+bool syscall_shm_unmap(void* addr);
+int syscall_thread_create(void* start, void* func, void* aux);
+void syscall_thread_exit(void) NO_RETURN;
+int syscall_thread_join(int tid);
+void syscall_thread_yield(void);
 
 
 
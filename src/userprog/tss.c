@@ -2,8 +2,11 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
+#include "threads/smp.h"
 #include "threads/vaddr.h"
 
 /* The Task-State Segment (TSS).
@@ -72,35 +75,60 @@ struct tss
     uint16_t trace, bitmap;
   };
 
-/* Kernel TSS. */
-static struct tss *tss;
+/* True if system calls may enter through sysenter. */
+static bool sysenter_enabled;
 
-/* Initializes the kernel TSS. */
+/* Kernel TSS. */
+/* Initializes the running CPU's TSS.  Each CPU has its own,
+   because each has its own ring 0 stack pointer. */
 void
 tss_init (void) 
 {
+  struct tss *tss;
+
   /* Our TSS is never used in a call gate or task gate, so only a
      few fields of it are ever referenced, and those are the only
      ones we initialize. */
-  tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  tss = cpu_current ()->tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
+
+  /* Enable the sysenter fast system call path, if the CPU has
+     it.  sysenter does not consult the TSS, so tss_update()
+     also points the sysenter stack MSR at the current thread's
+     kernel stack.  A debug exception can arrive before the
+     first instruction of syscall_sysenter (see
+     debug_exception()), so that stack must already be the
+     thread's: a one-word stack that held only the kernel stack
+     pointer would be overrun.  The MSRs are per CPU, like the
+     TSS. */
+  if (cpu_has (CPUID_SEP | CPUID_MSR))
+    {
+      sysenter_enabled = true;
+      wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+      wrmsr (MSR_SYSENTER_EIP, (uint32_t) syscall_sysenter);
+    }
   tss_update ();
 }
 
-/* Returns the kernel TSS. */
+/* Returns the running CPU's TSS. */
 struct tss *
 tss_get (void) 
 {
+  struct tss *tss = cpu_current ()->tss;
   ASSERT (tss != NULL);
   return tss;
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
-   of the thread stack. */
+/* Sets the ring 0 stack pointer in the running CPU's TSS, and
+   the sysenter stack pointer, to point to the end of the thread
+   stack. */
 void
 tss_update (void) 
 {
-  ASSERT (tss != NULL);
-  tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+  uint8_t *esp0 = (uint8_t *) thread_current () + PGSIZE;
+
+  tss_get ()->esp0 = esp0;
+  if (sysenter_enabled)
+    wrmsr (MSR_SYSENTER_ESP, (uint32_t) esp0);
 }
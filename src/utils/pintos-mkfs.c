@@ -0,0 +1,381 @@
+/* Builds a Pintos file system image on the host.
+
+   The image is a raw file system partition, suitable for
+   "pintos --filesys=IMAGE" or "pintos-mkdisk --filesys=IMAGE".
+   It is laid out exactly as the kernel's do_format() followed by
+   "extract" would leave it, except that each file's data sectors
+   form one contiguous extent, and it takes milliseconds instead
+   of a boot.
+
+   The structures below mirror filesys/inode.c,
+   filesys/directory.c, filesys/filesys.h and lib/kernel/bitmap.c
+   and must be kept in sync with them. */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLOCK_SECTOR_SIZE 512
+typedef uint32_t block_sector_t;
+
+/* filesys/filesys.h. */
+#define FREE_MAP_SECTOR 0
+#define ROOT_DIR_SECTOR 1
+#define DEDUP_SECTOR 2
+
+/* filesys/inode.c. */
+#define INODE_MAGIC 0x494e4f44
+#define NUM_OF_DIRECTS 10
+#define NUM_OF_INDIRECTS 10
+#define PTRS_PER_SECTOR 128
+#define NO_SECTOR ((block_sector_t) -1)
+
+struct inode_disk
+  {
+    block_sector_t start;
+    int32_t length;
+    uint32_t magic;
+    uint32_t unused[104];
+    block_sector_t d_blocks[NUM_OF_DIRECTS];
+    block_sector_t ind_blocks[NUM_OF_INDIRECTS];
+    block_sector_t d_ind_blocks;
+  };
+
+/* filesys/directory.c. */
+#define NAME_MAX 14
+#define ROOT_DIR_ENTRIES 16
+
+struct dir_entry
+  {
+    block_sector_t inode_sector;
+    char name[NAME_MAX + 1];
+    bool in_use;
+  };
+
+/* A file to put into the image. */
+struct file
+  {
+    const char *src;                    /* Host file name. */
+    char name[NAME_MAX + 1];            /* Name in the root directory. */
+    block_sector_t inode_sector;        /* Where its inode went. */
+  };
+
+static uint8_t *image;                  /* Image being built. */
+static block_sector_t image_sectors;    /* Size of image in sectors. */
+static block_sector_t next_free;        /* Allocation cursor. */
+
+static void
+fail (const char *msg, ...)
+     __attribute__ ((noreturn))
+     __attribute__ ((format (printf, 1, 2)));
+
+/* Prints MSG, formatting as with printf(), plus an error
+   message based on errno if it is nonzero, and exits. */
+static void
+fail (const char *msg, ...)
+{
+  va_list args;
+
+  va_start (args, msg);
+  fprintf (stderr, "pintos-mkfs: ");
+  vfprintf (stderr, msg, args);
+  va_end (args);
+
+  if (errno != 0)
+    fprintf (stderr, ": %s", strerror (errno));
+  putc ('\n', stderr);
+  exit (EXIT_FAILURE);
+}
+
+/* Returns a pointer to SECTOR in the image. */
+static void *
+sector_ptr (block_sector_t sector)
+{
+  return image + (size_t) sector * BLOCK_SECTOR_SIZE;
+}
+
+/* Allocates CNT consecutive sectors and returns the first.
+   Sectors are handed out in order, so everything allocated in
+   one call, and everything allocated in a row, is contiguous. */
+static block_sector_t
+allocate (block_sector_t cnt)
+{
+  block_sector_t sector = next_free;
+  if (cnt > image_sectors - next_free)
+    {
+      errno = 0;
+      fail ("image too small (%u sectors)", (unsigned) image_sectors);
+    }
+  next_free += cnt;
+  return sector;
+}
+
+/* Returns the number of sectors needed to hold SIZE bytes. */
+static block_sector_t
+bytes_to_sectors (uint64_t size)
+{
+  return (size + BLOCK_SECTOR_SIZE - 1) / BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the number of indirect and doubly indirect sectors
+   needed to map DATA_CNT data sectors. */
+static block_sector_t
+index_sectors (block_sector_t data_cnt)
+{
+  block_sector_t cnt = 0;
+
+  if (data_cnt > NUM_OF_DIRECTS)
+    {
+      block_sector_t ind = data_cnt - NUM_OF_DIRECTS;
+      block_sector_t ind_max = NUM_OF_INDIRECTS * PTRS_PER_SECTOR;
+      if (ind > ind_max)
+        {
+          cnt += NUM_OF_INDIRECTS + 1;
+          cnt += (ind - ind_max + PTRS_PER_SECTOR - 1) / PTRS_PER_SECTOR;
+        }
+      else
+        cnt += (ind + PTRS_PER_SECTOR - 1) / PTRS_PER_SECTOR;
+    }
+  return cnt;
+}
+
+/* Fills NUM block pointers at BLOCKS with NO_SECTOR, as
+   init_blocks() in filesys/inode.c does. */
+static void
+init_blocks (block_sector_t *blocks, int num)
+{
+  int i;
+  for (i = 0; i < num; i++)
+    blocks[i] = NO_SECTOR;
+}
+
+/* Writes an inode at INODE_SECTOR for a file of LENGTH bytes
+   whose data sectors are DATA, DATA + 1, ...  Index sectors are
+   taken from INDEX, INDEX + 1, ... */
+static void
+write_inode (block_sector_t inode_sector, int32_t length,
+             block_sector_t data, block_sector_t index)
+{
+  struct inode_disk *id = sector_ptr (inode_sector);
+  block_sector_t data_cnt = bytes_to_sectors (length);
+  block_sector_t *ind = NULL, *d_ind = NULL;
+  block_sector_t i;
+
+  memset (id, 0, sizeof *id);
+  id->length = length;
+  id->magic = INODE_MAGIC;
+  init_blocks (id->d_blocks, NUM_OF_DIRECTS);
+  init_blocks (id->ind_blocks, NUM_OF_INDIRECTS);
+  id->d_ind_blocks = NO_SECTOR;
+
+  for (i = 0; i < data_cnt; i++)
+    {
+      block_sector_t sec = data + i;
+
+      if (i < NUM_OF_DIRECTS)
+        id->d_blocks[i] = sec;
+      else
+        {
+          block_sector_t j = i - NUM_OF_DIRECTS;
+          block_sector_t ind_max = NUM_OF_INDIRECTS * PTRS_PER_SECTOR;
+
+          if (j % PTRS_PER_SECTOR == 0)
+            {
+              /* Start a new indirect block. */
+              block_sector_t ind_sector = index++;
+              ind = sector_ptr (ind_sector);
+              init_blocks (ind, PTRS_PER_SECTOR);
+              if (j < ind_max)
+                id->ind_blocks[j / PTRS_PER_SECTOR] = ind_sector;
+              else
+                {
+                  if (j == ind_max)
+                    {
+                      id->d_ind_blocks = index++;
+                      d_ind = sector_ptr (id->d_ind_blocks);
+                      init_blocks (d_ind, PTRS_PER_SECTOR);
+                    }
+                  d_ind[(j - ind_max) / PTRS_PER_SECTOR] = ind_sector;
+                }
+            }
+          ind[j % PTRS_PER_SECTOR] = sec;
+        }
+    }
+}
+
+/* Creates a file of SIZE bytes with its inode at INODE_SECTOR
+   and returns a pointer to its (zeroed, contiguous) data. */
+static uint8_t *
+create_file (block_sector_t inode_sector, uint64_t size)
+{
+  block_sector_t data_cnt, data;
+
+  if (size > INT32_MAX)
+    {
+      errno = EFBIG;
+      fail ("file of %llu bytes", (unsigned long long) size);
+    }
+  data_cnt = bytes_to_sectors (size);
+  data = allocate (data_cnt);
+  write_inode (inode_sector, size, data, allocate (index_sectors (data_cnt)));
+  return sector_ptr (data);
+}
+
+/* Reads host file SRC into a new file whose inode is at
+   INODE_SECTOR. */
+static void
+put_file (const char *src, block_sector_t inode_sector)
+{
+  struct stat st;
+  uint8_t *data;
+  FILE *f;
+
+  f = fopen (src, "rb");
+  if (f == NULL || fstat (fileno (f), &st) < 0)
+    fail ("%s", src);
+  data = create_file (inode_sector, st.st_size);
+  if (fread (data, 1, st.st_size, f) != (size_t) st.st_size)
+    fail ("%s: read failed", src);
+  fclose (f);
+}
+
+/* Marks sectors 0 through next_free - 1 in use in the free map
+   file whose inode is FREE_MAP_SECTOR.  Must be called after
+   every other allocation, but with the free map's own sectors
+   already reserved. */
+static void
+write_free_map (uint32_t *bits)
+{
+  block_sector_t i;
+
+  for (i = 0; i < next_free; i++)
+    bits[i / 32] |= (uint32_t) 1 << (i % 32);
+}
+
+static void
+usage (void)
+{
+  fprintf (stderr,
+           "pintos-mkfs: builds a Pintos file system partition image\n"
+           "usage: pintos-mkfs [-s MB] IMAGE [FILE[:NAME]...]\n"
+           "  -s MB    size of the partition in MB (default: 2)\n"
+           "  FILE     host file to copy into the root directory,\n"
+           "           under NAME if given, else its base name\n"
+           "Use the image with \"pintos --filesys=IMAGE\".\n");
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  struct file *files;
+  struct dir_entry *dir;
+  uint32_t *free_map;
+  const char *image_fn;
+  double size_mb = 2.0;
+  uint32_t free_map_bytes;
+  size_t dir_entries;
+  int file_cnt;
+  int opt, i;
+  FILE *out;
+
+  while ((opt = getopt (argc, argv, "s:h")) != -1)
+    if (opt == 's')
+      size_mb = strtod (optarg, NULL);
+    else
+      usage ();
+  if (optind >= argc || size_mb <= 0)
+    usage ();
+  image_fn = argv[optind++];
+  if (sizeof (struct inode_disk) != BLOCK_SECTOR_SIZE
+      || sizeof (struct dir_entry) != 20)
+    {
+      errno = 0;
+      fail ("on-disk structures do not match the kernel's");
+    }
+  file_cnt = argc - optind;
+
+  image_sectors = size_mb * 1024 * 1024 / BLOCK_SECTOR_SIZE;
+  if (image_sectors <= DEDUP_SECTOR)
+    usage ();
+  image = calloc (image_sectors, BLOCK_SECTOR_SIZE);
+  files = calloc (file_cnt + 1, sizeof *files);
+  if (image == NULL || files == NULL)
+    fail ("out of memory");
+
+  /* Parse file arguments. */
+  for (i = 0; i < file_cnt; i++)
+    {
+      char *arg = argv[optind + i];
+      char *colon = strrchr (arg, ':');
+      const char *name;
+
+      if (colon != NULL)
+        {
+          *colon = '\0';
+          name = colon + 1;
+        }
+      else
+        {
+          const char *slash = strrchr (arg, '/');
+          name = slash != NULL ? slash + 1 : arg;
+        }
+      if (*name == '\0' || strlen (name) > NAME_MAX)
+        {
+          errno = 0;
+          fail ("%s: name must be 1 to %d characters", name, NAME_MAX);
+        }
+      files[i].src = arg;
+      strcpy (files[i].name, name);
+    }
+
+  /* Fixed inode sectors, then the system files' data, then one
+     inode and one extent per file, as in do_format(). */
+  next_free = DEDUP_SECTOR + 1;
+  free_map_bytes = (image_sectors + 31) / 32 * 4;
+  free_map = (uint32_t *) create_file (FREE_MAP_SECTOR, free_map_bytes);
+  memset (create_file (DEDUP_SECTOR, sizeof (uint32_t)), 0,
+          sizeof (uint32_t));
+  dir_entries = file_cnt > ROOT_DIR_ENTRIES ? file_cnt : ROOT_DIR_ENTRIES;
+  dir = (struct dir_entry *) create_file (ROOT_DIR_SECTOR,
+                                          dir_entries * sizeof *dir);
+
+  for (i = 0; i < file_cnt; i++)
+    {
+      int j;
+
+      for (j = 0; j < i; j++)
+        if (!strcmp (files[j].name, files[i].name))
+          {
+            errno = 0;
+            fail ("%s: duplicate name", files[i].name);
+          }
+      files[i].inode_sector = allocate (1);
+      put_file (files[i].src, files[i].inode_sector);
+
+      dir[i].inode_sector = files[i].inode_sector;
+      strcpy (dir[i].name, files[i].name);
+      dir[i].in_use = true;
+    }
+
+  write_free_map (free_map);
+
+  /* Write the image in one go. */
+  out = fopen (image_fn, "wb");
+  if (out == NULL)
+    fail ("%s", image_fn);
+  if (fwrite (image, BLOCK_SECTOR_SIZE, image_sectors, out) != image_sectors
+      || fclose (out) != 0)
+    fail ("%s: write failed", image_fn);
+
+  printf ("%s: %u sectors, %d files, %u sectors free\n", image_fn,
+          (unsigned) image_sectors, file_cnt,
+          (unsigned) (image_sectors - next_free));
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+/* Decodes a kernel event trace.
+
+   Run the kernel with "-trace" and fetch the trace with
+   "pintos -g trace ...", then "pintos-trace trace" prints one
+   line per event, oldest first.  "-s" prints only a count of each
+   event.  A raw scratch disk image is accepted too.
+
+   The structures below mirror threads/trace.h and must be kept
+   in sync with it. */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECTOR_SIZE 512
+#define TRACE_MAGIC 0x43525450
+
+struct trace_record
+  {
+    uint64_t tsc;
+    uint16_t event;
+    uint16_t cpu;
+    int32_t tid;
+    uint32_t args[3];
+    uint32_t reserved;
+  };
+
+struct trace_header
+  {
+    uint32_t magic;
+    uint32_t record_size;
+    uint32_t record_cnt;
+    uint32_t event_cnt;
+    uint32_t timer_freq;
+    uint32_t tsc_khz;
+    uint64_t start_tsc;
+    uint64_t start_ticks;
+    uint64_t end_tsc;
+    uint64_t end_ticks;
+  };
+
+/* Event names and argument formats, indexed by enum trace_event. */
+static const struct
+  {
+    const char *name;
+    const char *args;
+  }
+events[] =
+  {
+    {"none", ""},
+    {"schedule", "prev=%u next=%u prev_status=%u"},
+    {"wakeup", "tid=%u cpu=%u"},
+    {"syscall", "nr=%u arg0=%#x arg1=%#x"},
+    {"syscall-return", "nr=%u ret=%d"},
+    {"block-read", "type=%u sector=%u cnt=%u"},
+    {"block-write", "type=%u sector=%u cnt=%u"},
+    {"cache-hit", "sector=%u write=%u"},
+    {"cache-miss", "sector=%u write=%u"},
+    {"cache-evict", "sector=%u dirty=%u"},
+  };
+#define EVENT_CNT (sizeof events / sizeof *events)
+
+static void
+usage (void)
+{
+  fprintf (stderr, "usage: pintos-trace [-s] FILE\n"
+           "Decodes a trace saved by a kernel run with -trace.\n"
+           "  -s   Print only the number of each kind of event.\n");
+  exit (EXIT_FAILURE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static unsigned long counts[EVENT_CNT + 1];
+  unsigned char sector[SECTOR_SIZE];
+  struct trace_header h;
+  struct trace_record r;
+  bool summary = false;
+  double cycles_per_us = 0.0;
+  uint32_t i;
+  FILE *file;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "s")) != -1)
+    if (opt == 's')
+      summary = true;
+    else
+      usage ();
+  if (optind != argc - 1)
+    usage ();
+
+  file = fopen (argv[optind], "rb");
+  if (file == NULL)
+    {
+      perror (argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  /* Skip the ustar header of a raw scratch disk. */
+  if (fread (sector, SECTOR_SIZE, 1, file) != 1)
+    {
+      fprintf (stderr, "%s: too short for a trace\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+  if (!memcmp (sector + 257, "ustar", 5)
+      && fread (sector, SECTOR_SIZE, 1, file) != 1)
+    {
+      fprintf (stderr, "%s: too short for a trace\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+  memcpy (&h, sector, sizeof h);
+  if (h.magic != TRACE_MAGIC || h.record_size != sizeof r)
+    {
+      fprintf (stderr, "%s: not a Pintos trace\n", argv[optind]);
+      return EXIT_FAILURE;
+    }
+
+  if (h.tsc_khz > 0)
+    cycles_per_us = h.tsc_khz / 1000.0;
+  else if (h.end_ticks > h.start_ticks && h.timer_freq > 0)
+    cycles_per_us = ((double) (h.end_tsc - h.start_tsc)
+                     / ((double) (h.end_ticks - h.start_ticks)
+                        * 1e6 / h.timer_freq));
+  printf ("%u events, %u saved", h.event_cnt, h.record_cnt);
+  if (cycles_per_us > 0.0)
+    printf (", %.1f MHz TSC", cycles_per_us);
+  printf ("\n");
+
+  for (i = 0; i < h.record_cnt; i++)
+    {
+      if (fread (&r, sizeof r, 1, file) != 1)
+        {
+          fprintf (stderr, "%s: truncated after %u records\n",
+                   argv[optind], i);
+          break;
+        }
+      counts[r.event < EVENT_CNT ? r.event : EVENT_CNT]++;
+      if (summary)
+        continue;
+
+      if (cycles_per_us > 0.0)
+        printf ("%12.3f", (r.tsc - h.start_tsc) / cycles_per_us);
+      else
+        printf ("%12llu", (unsigned long long) (r.tsc - h.start_tsc));
+      printf (" cpu%u tid %-3d ", r.cpu, r.tid);
+      if (r.event < EVENT_CNT)
+        {
+          printf ("%-15s ", events[r.event].name);
+          printf (events[r.event].args, r.args[0], r.args[1], r.args[2]);
+        }
+      else
+        printf ("event-%-9u %#x %#x %#x", r.event,
+                r.args[0], r.args[1], r.args[2]);
+      printf ("\n");
+    }
+
+  if (summary)
+    for (i = 0; i <= EVENT_CNT; i++)
+      if (counts[i] != 0)
+        printf ("%-15s %lu\n", i < EVENT_CNT ? events[i].name : "unknown",
+                counts[i]);
+
+  fclose (file);
+  return EXIT_SUCCESS;
+}